@@ -0,0 +1,106 @@
+//
+// Created by charm on 19/10/26.
+//
+
+#include "AssetPreloader.h"
+#include "MeshAsset.h"
+#include <ros/ros.h>
+
+
+// -----------------------------------------------------------------------------
+AssetPreloader::~AssetPreloader() {
+
+    Cancel();
+    for (auto &retired : retired_workers)
+        retired.first.join();
+}
+
+// -----------------------------------------------------------------------------
+void AssetPreloader::Start(const std::vector<MeshAssetRequest> &requests) {
+
+    Cancel();
+
+    job = std::make_shared<Job>();
+    job->n_requests = requests.size();
+    job->done = requests.empty();
+
+    if(!job->done)
+        worker = boost::thread(&AssetPreloader::Run, job, requests);
+}
+
+// -----------------------------------------------------------------------------
+void AssetPreloader::Cancel() {
+
+    if(job) {
+        job->cancel = true;
+        job->done = true;
+    }
+    RetireWorker();
+}
+
+// -----------------------------------------------------------------------------
+void AssetPreloader::RetireWorker() {
+
+    if(worker.joinable()) {
+        worker.interrupt();
+        retired_workers.emplace_back(std::move(worker), job);
+    }
+
+    auto it = retired_workers.begin();
+    while (it != retired_workers.end()) {
+        if(it->second->finished) {
+            it->first.join();
+            it = retired_workers.erase(it);
+        } else
+            ++it;
+    }
+}
+
+// -----------------------------------------------------------------------------
+float AssetPreloader::GetProgress() const {
+
+    if(!job || job->n_requests == 0)
+        return 1.f;
+    return float(job->n_processed) / float(job->n_requests);
+}
+
+// -----------------------------------------------------------------------------
+void AssetPreloader::Run(std::shared_ptr<Job> job,
+                         std::vector<MeshAssetRequest> requests) {
+
+    ros::Time start = ros::Time::now();
+    bool completed = false;
+
+    try {
+        for (const auto &request : requests) {
+
+            if(job->cancel)
+                break;
+
+            try {
+                std::shared_ptr<const MeshAsset> asset =
+                        MeshAsset::Load(request.file_name);
+                for (int l = 1; l < MeshAsset::N_LODS && !job->cancel; ++l)
+                    asset->GetLOD(l);
+
+                if(request.physics && !job->cancel)
+                    MeshAsset::LoadDecomposed(request.file_name);
+            } catch(const std::exception& e) {
+                ROS_WARN_STREAM("Could not preload " << request.file_name
+                                << ": " << e.what());
+            }
+
+            job->n_processed++;
+            boost::this_thread::interruption_point();
+        }
+        completed = !job->cancel;
+    } catch(const boost::thread_interrupted &) {
+    }
+
+    if(completed) {
+        ROS_DEBUG("Preloaded %lu meshes in %.1f s", requests.size(),
+                  (ros::Time::now() - start).toSec());
+        job->done = true;
+    }
+    job->finished = true;
+}
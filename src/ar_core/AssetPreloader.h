@@ -0,0 +1,87 @@
+//
+// Created by charm on 19/10/26.
+//
+
+#ifndef ATAR_ASSETPRELOADER_H
+#define ATAR_ASSETPRELOADER_H
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <boost/thread/thread.hpp>
+#include "MeshAsset.h"
+
+/**
+ * \class AssetPreloader
+ * \brief Loads the MeshAssets of a task in a background thread.
+ *
+ * Parsing the obj files, building the convex hulls and decimating the
+ * levels of detail is what makes the construction of a task slow. The
+ * preloader does this work in its own thread and leaves the results in the
+ * MeshAsset cache, so that when the task is then constructed on the render
+ * thread its SimObjects find their meshes ready and only the actors and
+ * the bodies are created. The render loop keeps running the current task
+ * meanwhile and polls IsDone and GetProgress.
+ *
+ * A failed load is only reported: the task will throw when it tries the
+ * same file and the error is handled where tasks are started.
+ *
+ * Start and Cancel never wait for the worker, since a convex decomposition
+ * can take seconds. The old worker is told to stop after its current asset
+ * and is retired; retired workers are joined once they are over, and all
+ * of them in the destructor.
+ */
+class AssetPreloader {
+public:
+
+    AssetPreloader() = default;
+
+    ~AssetPreloader();
+
+    // Cancels the previous requests if any and starts loading these ones.
+    void Start(const std::vector<MeshAssetRequest> &requests);
+
+    // Stops after the asset being loaded, without waiting for it. What was
+    // already loaded stays in the cache.
+    void Cancel();
+
+    bool IsDone() const { return !job || job->done; };
+
+    // Fraction of the requests that has been processed, in [0, 1]
+    float GetProgress() const;
+
+private:
+
+    // The state of one Start, shared with its worker so that a retired
+    // worker does not touch the progress of the next one.
+    struct Job {
+        std::atomic<bool>       cancel{false};
+        std::atomic<bool>       done{false};
+        // set by the worker when it returns
+        std::atomic<bool>       finished{false};
+        std::atomic<size_t>     n_processed{0};
+        size_t                  n_requests = 0;
+    };
+
+    static void Run(std::shared_ptr<Job> job,
+                    std::vector<MeshAssetRequest> requests);
+
+    // Moves the worker to the retired ones and joins those that are over
+    void RetireWorker();
+
+    AssetPreloader(const AssetPreloader &);  // Purposefully not implemented.
+
+    void operator=(const AssetPreloader &);  // Purposefully not implemented.
+
+private:
+
+    boost::thread               worker;
+    std::shared_ptr<Job>        job;
+    std::vector<std::pair<boost::thread, std::shared_ptr<Job> > >
+                                retired_workers;
+};
+
+
+#endif //ATAR_ASSETPRELOADER_H
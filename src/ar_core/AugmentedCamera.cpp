@@ -6,6 +6,7 @@
 #include "IntrinsicCalibrationCharuco.h"
 #include <pwd.h>
 #include <custom_conversions/Conversions.h>
+#include <std_msgs/Float32MultiArray.h>
 
 //#include <sys/stat.h>
 
@@ -25,6 +26,20 @@ AugmentedCamera::AugmentedCamera(image_transport::ImageTransport *it,
     // correct for remap
     img_topic=n.resolveName(img_topic,/*remap = */true);
 
+    // is the camera half of a side by side or top bottom stereo frame?
+    int stereo_half = -1;
+    std::string stereo_topic;
+    if(n.getParam("stereo_image_topic", stereo_topic)) {
+        std::string stereo_cam_names[2];
+        n.param<std::string>("stereo_left_cam_name", stereo_cam_names[0], "");
+        n.param<std::string>("stereo_right_cam_name", stereo_cam_names[1], "");
+        for (int half = 0; half < 2; ++half)
+            if(cam_name == stereo_cam_names[half])
+                stereo_half = half;
+        if(stereo_half >= 0)
+            img_topic = n.resolveName(stereo_topic,/*remap = */true);
+    }
+
     // Read board parameters which we might need to use either for intrinsic
     // or extrinsic calibration
     // board_params comprises: [dictionary_id, board_w, board_h,
@@ -87,6 +102,11 @@ AugmentedCamera::AugmentedCamera(image_transport::ImageTransport *it,
                                 "is needed for intrinsic calibration. board_param="
                                 "[dictionary_id, board_w, board_h, "
                                 "square_length_in_meters, marker_length_in_meters]");
+            if(stereo_half >= 0)
+                throw std::runtime_error(
+                        "The intrinsic calibration needs the images of the "
+                                "camera alone. Calibrate the cameras of the "
+                                "stereo frame separately.");
 
             {
                 IntrinsicCalibrationCharuco IC(img_topic, board_params);
@@ -103,7 +123,27 @@ AugmentedCamera::AugmentedCamera(image_transport::ImageTransport *it,
     }
 
     // --------------------Images
-    sub_image = it->subscribe(img_topic, 1, &AugmentedCamera::ImageCallback, this);
+    if(stereo_half >= 0) {
+        std::string stereo_layout;
+        n.param<std::string>("stereo_layout", stereo_layout, "side_by_side");
+        stereo_subscriber = StereoFrameSubscriber::Get(
+                it, img_topic, StereoFrameSubscriber::LayoutFromName(
+                        stereo_layout));
+        stereo_subscriber->AddCamera(this, stereo_half);
+    }
+    else if(n.param<std::string>("image_transport", "raw") == "compressed") {
+        // subscribe to the compressed topic directly, image_transport would
+        // decode on this thread
+        decode_stream = ImageDecodePool::Get().CreateStream();
+        sub_compressed_image = n.subscribe(
+                img_topic + "/compressed", 2,
+                &AugmentedCamera::CompressedImageCallback, this);
+        pub_decode_stats = n.advertise<std_msgs::Float32MultiArray>(
+                "/"+cam_name+"/decode_stats", 1);
+        last_decode_stats_time = ros::Time::now();
+    }
+    else
+        sub_image = it->subscribe(img_topic, 1, &AugmentedCamera::ImageCallback, this);
 
 
     // ------------------------------------------
@@ -154,15 +194,33 @@ AugmentedCamera::AugmentedCamera(image_transport::ImageTransport *it,
                                                         board_params[3],
                                                         board_params[4],
                                                         dictionary);
+        detector_params = cv::aruco::DetectorParameters::create();
+        detector_params->doCornerRefinement = true;
+
+        pub_estimated_pose = n.advertise<geometry_msgs::PoseStamped>(
+                "/"+cam_name+"/estimated_world_to_camera_transform", 1);
+
+        pose_thread = boost::thread(&AugmentedCamera::PoseEstimationThread,
+                                    this);
     }
 }
 
+//------------------------------------------------------------------------------
+AugmentedCamera::~AugmentedCamera() {
+    if(stereo_subscriber)
+        stereo_subscriber->RemoveCamera(this);
+    pose_thread.interrupt();
+    pose_thread.join();
+}
+
 //------------------------------------------------------------------------------
 void AugmentedCamera::ImageCallback(const sensor_msgs::ImageConstPtr &msg) {
     try
     {
-        image = cv_bridge::toCvCopy(msg, "rgb8")->image;
-        new_image= true;
+        cv::Mat new_frame = cv_bridge::toCvCopy(msg, "rgb8")->image;
+        SetImage(new_frame, cv::Rect(cv::Point(0, 0), new_frame.size()),
+                 msg->header.stamp.isZero() ? ros::Time::now()
+                                            : msg->header.stamp);
     }
     catch (cv_bridge::Exception& e)
     {
@@ -170,6 +228,62 @@ void AugmentedCamera::ImageCallback(const sensor_msgs::ImageConstPtr &msg) {
     }
 }
 
+//------------------------------------------------------------------------------
+void AugmentedCamera::CompressedImageCallback(
+        const sensor_msgs::CompressedImageConstPtr &msg) {
+    ImageDecodePool::Get().Submit(decode_stream, msg);
+}
+
+//------------------------------------------------------------------------------
+void AugmentedCamera::PollDecodedFrame() {
+
+    if(!decode_stream)
+        return;
+
+    cv::Mat decoded;
+    ros::Time stamp;
+    if(decode_stream->GetNewFrame(decoded, stamp))
+        SetImage(decoded, cv::Rect(cv::Point(0, 0), decoded.size()), stamp);
+
+    if(ros::Time::now() - last_decode_stats_time > ros::Duration(1.0))
+        PublishDecodeStats();
+}
+
+//------------------------------------------------------------------------------
+void AugmentedCamera::PublishDecodeStats() {
+
+    const ros::Time now = ros::Time::now();
+    const double period = (now - last_decode_stats_time).toSec();
+    last_decode_stats_time = now;
+
+    ImageDecodePool::DecodeStats stats = decode_stream->GetStats();
+    std_msgs::Float32MultiArray msg;
+    msg.data = {float(stats.mean_decode_ms), float(stats.max_decode_ms),
+                float(stats.decoded / period), float(stats.dropped / period)};
+    pub_decode_stats.publish(msg);
+}
+
+//------------------------------------------------------------------------------
+void AugmentedCamera::SetImage(const cv::Mat &new_frame, const cv::Rect &rect,
+                               const ros::Time &stamp) {
+
+    received_frame = new_frame;
+    image_rect = rect;
+    image = received_frame(rect);
+    image_stamp = stamp;
+    new_image= true;
+
+    // hand the frame to the pose thread. Each message gets a new buffer
+    // and the image is never modified, so it is shared, not copied. A
+    // frame that was not processed yet is dropped.
+    if(!is_pose_from_subscriber) {
+        boost::lock_guard<boost::mutex> lock(frame_mutex);
+        pending_frame = image;
+        pending_frame_stamp = image_stamp;
+        frame_condition.notify_one();
+    }
+}
+
 //------------------------------------------------------------------------------
 void AugmentedCamera::PoseCallback(const geometry_msgs::PoseStampedConstPtr &msg) {
     new_pose_from_sub = true;
@@ -222,6 +336,7 @@ cv::Mat AugmentedCamera::LockAndGetImage() {
     while(ros::ok() && image.empty()) {
         ros::spinOnce();
         loop_rate.sleep();
+        PollDecodedFrame();
 
         ROS_WARN_STREAM_ONCE("Waiting 5s for images on "+ img_topic);
 
@@ -234,7 +349,18 @@ cv::Mat AugmentedCamera::LockAndGetImage() {
     return image;
 }
 
+cv::Mat AugmentedCamera::GetImage() {
+    PollDecodedFrame();
+    return image;
+}
+
+cv::Mat AugmentedCamera::GetFrame() {
+    PollDecodedFrame();
+    return received_frame;
+}
+
 bool AugmentedCamera::IsImageNew() {
+    PollDecodedFrame();
     if(new_image) {
         new_image = false;
         return true;
@@ -245,16 +371,21 @@ bool AugmentedCamera::IsImageNew() {
 
 bool AugmentedCamera::GetNewWorldToCamTr(KDL::Frame &pose) {
 
+    // hands the decoded frames to the pose thread
+    PollDecodedFrame();
+
     // if pose comes from the subscriber
     if(new_pose_from_sub){
         pose = world_to_cam_tr;
         new_pose_from_sub = false;
         return true;
     }
-    else if(!is_pose_from_subscriber && !image.empty() ){
-        cv::Mat img;
-        image.copyTo(img);
-        if(DetectCharucoBoardPose(world_to_cam_tr, img)) {
+    else if(!is_pose_from_subscriber){
+        // the last estimation of the pose thread, if not read yet
+        EstimatedPose estimated = estimated_pose.Load();
+        if(estimated.count != last_read_pose_count) {
+            last_read_pose_count = estimated.count;
+            world_to_cam_tr = estimated.pose;
             pose = world_to_cam_tr;
             return true;
         }
@@ -263,21 +394,88 @@ bool AugmentedCamera::GetNewWorldToCamTr(KDL::Frame &pose) {
     return false;
 }
 
-bool AugmentedCamera::DetectCharucoBoardPose(KDL::Frame &pose, cv::Mat image) {
+//------------------------------------------------------------------------------
+void AugmentedCamera::PoseEstimationThread() {
+
+    geometry_msgs::PoseStamped pose_msg;
+    pose_msg.header.frame_id = "/world";
+
+    try {
+        while (ros::ok()) {
+
+            cv::Mat frame;
+            ros::Time frame_stamp;
+            {
+                boost::unique_lock<boost::mutex> lock(frame_mutex);
+                while (pending_frame.empty())
+                    frame_condition.wait(lock);
+                frame = pending_frame;
+                frame_stamp = pending_frame_stamp;
+                pending_frame = cv::Mat();
+                camera_matrix.copyTo(pose_camera_matrix);
+                camera_distortion.copyTo(pose_camera_distortion);
+            }
+
+            KDL::Frame pose;
+            if(!DetectCharucoBoardPose(pose, frame))
+                continue;
+
+            estimated_pose.Modify([&pose, &frame_stamp](EstimatedPose &e){
+                e.pose = pose;
+                e.stamp = frame_stamp;
+                e.count++;
+            });
+
+            tf::poseKDLToMsg(pose, pose_msg.pose);
+            pose_msg.header.stamp = frame_stamp;
+            pub_estimated_pose.publish(pose_msg);
+        }
+    } catch(const boost::thread_interrupted &) { }
+}
+
+//------------------------------------------------------------------------------
+bool AugmentedCamera::DetectCharucoBoardPose(KDL::Frame &pose,
+                                             const cv::Mat &image) {
+
+    // above this width the search region is downscaled for the marker
+    // detection
+    const int max_search_width = 640;
+    // margin added around the board, as a fraction of its size, to find it
+    // in the next frame
+    const double roi_margin = 0.5;
 
     std::vector<int> marker_ids, charuco_ids;
     std::vector<std::vector<cv::Point2f> > marker_corners, rejected_markers;
     std::vector<cv::Point2f> charuco_corners;
 
+    cv::cvtColor(image, gray_image, cv::COLOR_RGB2GRAY);
+    const cv::Rect full_image(0, 0, gray_image.cols, gray_image.rows);
 
-    cv::Ptr<cv::aruco::DetectorParameters> detector_params =
-            cv::aruco::DetectorParameters::create();
-    detector_params->doCornerRefinement = true;
+    // search around the board if it was found in the last frame
+    cv::Rect roi = board_tracked ? (board_roi & full_image) : full_image;
+    if(roi.area() == 0)
+        roi = full_image;
+
+    double scale = 1.0;
+    if(roi.width > max_search_width) {
+        scale = double(max_search_width) / roi.width;
+        cv::resize(gray_image(roi), search_image, cv::Size(), scale, scale,
+                   cv::INTER_AREA);
+    }
+    else
+        search_image = gray_image(roi);
 
     // detect markers
-    cv::aruco::detectMarkers(image, dictionary, marker_corners,
+    cv::aruco::detectMarkers(search_image, dictionary, marker_corners,
                              marker_ids, detector_params, rejected_markers);
 
+    // back to the coordinates of the full image
+    for (auto &corners : marker_corners)
+        for (auto &p : corners) {
+            p.x = float(p.x / scale + roi.x);
+            p.y = float(p.y / scale + roi.y);
+        }
+
     //    // refind strategy to detect more markers
     //    if (refindStrategy)
     //        aruco::refineDetectedMarkers(image, board, markerCorners,
@@ -289,18 +487,22 @@ bool AugmentedCamera::DetectCharucoBoardPose(KDL::Frame &pose, cv::Mat image) {
     if (!marker_ids.empty())
         interpolatedCorners =
                 cv::aruco::interpolateCornersCharuco(marker_corners,
-                                                     marker_ids, image,
+                                                     marker_ids, gray_image,
                                                      charuco_board,
                                                      charuco_corners,
-                                                     charuco_ids, camera_matrix,
-                                                     camera_distortion);
+                                                     charuco_ids,
+                                                     pose_camera_matrix,
+                                                     pose_camera_distortion);
 
     // estimate charuco board pose
     CV_Assert((charuco_corners.size() ==charuco_ids.size()));
 
     // need, at least, 4 corners
-    if(charuco_ids.size() < 4)
+    if(charuco_ids.size() < 4) {
+        // search the whole image next time
+        board_tracked = false;
         return false;
+    }
 
     std::vector< cv::Point3f > objPoints;
     objPoints.reserve(charuco_ids.size());
@@ -313,11 +515,24 @@ bool AugmentedCamera::DetectCharucoBoardPose(KDL::Frame &pose, cv::Mat image) {
     }
 
     // points need to be in different lines, check if detected points are enough
-    cv::Vec3d rvec, tvec;
-    solvePnP(objPoints, charuco_corners, camera_matrix, camera_distortion,
-             rvec, tvec);
+    // the last pose is a good initial guess when the board is tracked
+    solvePnP(objPoints, charuco_corners, pose_camera_matrix,
+             pose_camera_distortion, board_rvec, board_tvec,
+             /*useExtrinsicGuess=*/board_tracked);
+
+    conversions::RvecTvecToKDLFrame(board_rvec, board_tvec, pose);
+
+    // region to search in the next frame
+    std::vector<cv::Point2f> board_points(charuco_corners);
+    for (const auto &corners : marker_corners)
+        board_points.insert(board_points.end(), corners.begin(), corners.end());
+    cv::Rect board = cv::boundingRect(board_points);
+    const int dx = int(roi_margin * board.width);
+    const int dy = int(roi_margin * board.height);
+    board_roi = cv::Rect(board.x - dx, board.y - dy, board.width + 2 * dx,
+                         board.height + 2 * dy);
+    board_tracked = true;
 
-    conversions::RvecTvecToKDLFrame(rvec, tvec, pose);
     return true;
 }
 
@@ -331,7 +546,9 @@ void
 AugmentedCamera::CamInfoCallback(const sensor_msgs::CameraInfoConstPtr &msg) {
     
 //    camera_matrix = cv::Mat_<double>(3,3, &msg->K[0]);
-    
+
+    // the pose thread copies the intrinsics with the frames
+    boost::lock_guard<boost::mutex> lock(frame_mutex);
     camera_matrix.at<double>(0, 0) = msg->K[0]; // fx
     camera_matrix.at<double>(1, 1) = msg->K[4]; // fy
     camera_matrix.at<double>(0, 2)= msg->K[2];  //cx
@@ -13,16 +13,53 @@
 #include <geometry_msgs/PoseStamped.h>
 #include <sensor_msgs/CameraInfo.h>
 #include <opencv2/aruco/charuco.hpp>
-
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include "SeqLock.h"
+#include "StereoFrameSubscriber.h"
+#include "ImageDecodePool.h"
+
+// When the pose of the camera is not given as a parameter or on a topic it
+// is estimated from a charuco board. The estimation runs in its own thread
+// on the frames received by ImageCallback, so the render loop only picks up
+// the last result in GetNewWorldToCamTr. Once the board is found, the next
+// frames are searched only around it (with a margin) and solvePnP starts
+// from the previous pose. Large search regions are downscaled for the
+// marker detection, the charuco corners are then refined at full
+// resolution. The estimated poses are also published on
+// /<cam_name>/estimated_world_to_camera_transform, stamped with the capture
+// time of their image.
+//
+// The images of the two cameras of a stereo pair can also come in a single
+// side by side or top bottom frame, on the stereo_image_topic parameter
+// (with stereo_layout, stereo_left_cam_name and stereo_right_cam_name). The
+// two cameras then share one StereoFrameSubscriber and their image is a
+// view on their half of the shared frame.
+//
+// With the compressed image_transport (image_transport parameter) the
+// messages are not decoded on the callback thread but by the
+// ImageDecodePool, and the decoded frames are picked up by IsImageNew. The
+// decoding times are published on /<cam_name>/decode_stats.
 class AugmentedCamera {
 public:
 
     explicit AugmentedCamera(image_transport::ImageTransport *it=NULL,
              std::string cam_name="");
 
+    ~AugmentedCamera();
+
     // callbacks
     void ImageCallback(const sensor_msgs::ImageConstPtr &msg);
 
+    void CompressedImageCallback(
+            const sensor_msgs::CompressedImageConstPtr &msg);
+
+    // New image of the camera: the rect part of frame. Frames are not
+    // modified after this, so the image is not copied.
+    void SetImage(const cv::Mat &frame, const cv::Rect &rect,
+                  const ros::Time &stamp);
+
     void PoseCallback(const geometry_msgs::PoseStampedConstPtr &msg);
 
     void CamInfoCallback(const sensor_msgs::CameraInfoConstPtr &msg);
@@ -42,6 +79,13 @@ public:
     // calculate the pose.
     KDL::Frame GetWorldToCamTr(){return world_to_cam_tr;};
 
+    // true if the pose is estimated from the charuco board, i.e. it is
+    // neither a parameter nor published on a topic
+    bool IsPoseEstimated(){return !is_pose_from_subscriber;};
+
+    // capture time of the image the last charuco pose was estimated from
+    ros::Time GetWorldToCamTrStamp(){return estimated_pose.Load().stamp;};
+
     bool IsImageNew();
 
     // Tt is important to copy the image to prevent seg fault due to
@@ -50,29 +94,90 @@ public:
 
     cv::Mat LockAndGetImage();
 
-    cv::Mat GetImage(){return image;};
+    // With the compressed transport all the accessors of the image and the
+    // pose first take the last frame decoded by the pool.
+    cv::Mat GetImage();
+
+    // The whole received frame and the rectangle of the image in it. The
+    // same as the image unless the camera is half of a stereo frame.
+    cv::Mat GetFrame();
+
+    cv::Rect GetImageRect(){return image_rect;};
+
+    // capture time of the last received image (header stamp, or the
+    // arrival time if the publisher does not fill the stamp)
+    ros::Time GetImageStamp(){return image_stamp;};
 
 private:
 
     bool ReadIntrinsicsFromFile(std::string file_path);
 
-    bool DetectCharucoBoardPose(KDL::Frame &pose, cv::Mat image);
+    void PoseEstimationThread();
+
+    // takes the last frame decoded by the pool, if any
+    void PollDecodedFrame();
+
+    void PublishDecodeStats();
+
+    bool DetectCharucoBoardPose(KDL::Frame &pose, const cv::Mat &image);
 
 private:
+
+    struct EstimatedPose {
+        KDL::Frame      pose;
+        ros::Time       stamp;
+        // incremented at each new estimation
+        uint32_t        count;
+    };
+
     std::string                 img_topic;
     cv::Mat                     image;
+    cv::Mat                     received_frame;
+    cv::Rect                    image_rect;
+    ros::Time                   image_stamp;
     bool                        new_image = false;
     bool                        new_pose_from_sub = false;
     KDL::Frame                  world_to_cam_tr;
     bool                        is_pose_from_subscriber =true;
 
+    // written by CamInfoCallback under frame_mutex once the pose thread
+    // runs
     cv::Mat                     camera_matrix= cv::Mat::zeros(3, 3, CV_64F);
     cv::Mat                     camera_distortion= cv::Mat::zeros(1, 5, CV_64F);
 
     // pose estimation
     cv::Ptr<cv::aruco::CharucoBoard>   charuco_board;
     cv::Ptr<cv::aruco::Dictionary> dictionary;
+    cv::Ptr<cv::aruco::DetectorParameters> detector_params;
+    SeqLock<EstimatedPose>      estimated_pose;
+    uint32_t                    last_read_pose_count = 0;
+    ros::Publisher              pub_estimated_pose;
+
+    // frame handed from ImageCallback to the pose thread
+    boost::thread               pose_thread;
+    boost::mutex                frame_mutex;
+    boost::condition_variable   frame_condition;
+    cv::Mat                     pending_frame;
+    ros::Time                   pending_frame_stamp;
+
+    // tracking state of the pose thread
+    bool                        board_tracked = false;
+    cv::Rect                    board_roi;
+    cv::Vec3d                   board_rvec, board_tvec;
+    cv::Mat                     gray_image, search_image;
+    // copies of the intrinsics taken with each frame
+    cv::Mat                     pose_camera_matrix, pose_camera_distortion;
+
     image_transport::Subscriber sub_image;
+    std::shared_ptr<StereoFrameSubscriber> stereo_subscriber;
+
+    // compressed images decoded by the pool
+    ros::Subscriber             sub_compressed_image;
+    std::shared_ptr<ImageDecodePool::Stream> decode_stream;
+    // [mean decode time (ms), max decode time (ms), decoded frames per
+    // second, dropped frames per second]
+    ros::Publisher              pub_decode_stats;
+    ros::Time                   last_decode_stats_time;
     ros::Subscriber             sub_pose;
     ros::Subscriber             sub_camera_info;
 };
@@ -11,6 +11,7 @@
 #include <vtkActor.h>
 #include <kdl/frames.hpp>
 #include "VTKConversions.h"
+#include "TaskArena.h"
 
 #define B_DIM_SCALE 100.0f
 //==============================================================================
@@ -20,7 +21,9 @@
     This class simplifies the graphics and dynamic objects synchronization.
     \details
 	If the dynamic object moves the setWorldTransform will be called by
-    bullet and we set the pose of the vtk actor.
+    bullet and we keep the pose. It is copied to the user matrix of the vtk
+    actor (one matrix per object, updated in place) once per rendered frame
+    by the PoseSyncBuffer of the task, and not at every substep.
     If the object is kinematic (e.g. a tool)the getWorldTransform method
     is called at every loop, and the pose of the object must be set
     externally using the setKinematicPos method.
@@ -38,27 +41,38 @@
 class BulletVTKMotionState : public btMotionState{
 
 protected:
-    vtkSmartPointer<vtkActor>   actor_;
-    btTransform                 bt_pose_;
-    KDL::Frame                  frame;
+    vtkSmartPointer<vtkActor>       actor_;
+    // the user matrix of the actor. It is allocated once and updated in place
+    vtkSmartPointer<vtkMatrix4x4>   matrix_;
+    btTransform                     bt_pose_;
+    // bt_pose_ has changed since it was last copied to the actor
+    bool                            dirty_;
 
 public:
+    // allocated in the arena of the task (see TaskArena)
+    static void * operator new(size_t size) { return TaskArena::Allocate(size); }
+
+    static void operator delete(void *ptr) { TaskArena::Free(ptr); }
+
     BulletVTKMotionState(const KDL::Frame &pose,
                          vtkSmartPointer<vtkActor> actor)
-            : actor_(actor){
-
-        btTransform init_transform;
-        init_transform.setIdentity();
-        init_transform.setOrigin(btVector3(float(B_DIM_SCALE*pose.p[0]),
-                                           float(B_DIM_SCALE*pose.p[1]),
-                                           float(B_DIM_SCALE*pose.p[2]) ));
-        double qx, qy,qz, qw;
-        pose.M.GetQuaternion(qx, qy,qz, qw);
-        init_transform.setRotation(btQuaternion((float)qx, (float)qy,
-                                                (float)qz, (float)qw ));
-        bt_pose_ = init_transform;
+            : actor_(actor),
+              matrix_(vtkSmartPointer<vtkMatrix4x4>::New()),
+              dirty_(true){
+
+        bt_pose_ = KDLFrameToBtTransform(pose);
+        actor_->SetUserMatrix(matrix_);
+        SyncActorMatrix();
     }
 
+    // -------------------------------------------------------------------------
+    //! The pose has changed since it was last copied to the actor
+    bool IsDirty() const { return dirty_; }
+
+    void ClearDirty() { dirty_ = false; }
+
+    const btTransform & GetBtTransform() const { return bt_pose_; }
+
     // -------------------------------------------------------------------------
     //! called by bullet at initialization for all objects and if kinematic
     //! object it is called at each loop
@@ -69,22 +83,16 @@ public:
 
     // -------------------------------------------------------------------------
     //! called by user to get the pose of the object
-    KDL::Frame getKDLFrame() {
-        return frame;
+    KDL::Frame getKDLFrame() const {
+        return btTransformToKDLFrame(bt_pose_);
     }
 
     // -------------------------------------------------------------------------
-    //! Called by bullet to set the pose of dynamic objects
+    //! Called by bullet to set the pose of dynamic objects. This happens at
+    //! every substep, so the actor is only updated once per frame.
     void setWorldTransform(const btTransform &worldTrans) override {
-
-        // bullet
         bt_pose_ = worldTrans;
-        frame = btTransformToKDLFrame(bt_pose_);
-
-        // VTK
-        vtkSmartPointer<vtkMatrix4x4> v_m =vtkSmartPointer<vtkMatrix4x4>::New();
-        VTKConversions::KDLFrameToVTKMatrix(frame, v_m);
-        actor_->SetUserMatrix(v_m);
+        dirty_ = true;
     }
 
     // -------------------------------------------------------------------------
@@ -94,16 +102,42 @@ public:
         // Bullet side
         bt_pose_ = KDLFrameToBtTransform(in);
 
-        // VTK side
-        frame = in;
-        vtkSmartPointer<vtkMatrix4x4> v_m =vtkSmartPointer<vtkMatrix4x4>::New();
-        VTKConversions::KDLFrameToVTKMatrix(in, v_m);
-        actor_->SetUserMatrix(v_m);
+        // VTK side. Kinematic poses are set once per frame after the physics
+        // step, so the actor is updated right away.
+        dirty_ = true;
+        SyncActorMatrix();
+    }
+
+    // -------------------------------------------------------------------------
+    //! Writes a row-major rotation and a position (not scaled) to the
+    //! matrix of the actor
+    void SetActorMatrix(const float *rotation, const float *position) {
+        for (int i = 0; i < 3; ++i) {
+            for (int j = 0; j < 3; ++j)
+                matrix_->Element[i][j] = rotation[3 * i + j];
+            matrix_->Element[i][3] = position[i];
+        }
+        matrix_->Modified();
+    }
+
+private:
+
+    //! Copies bt_pose_ to the actor right away
+    void SyncActorMatrix() {
+        float rotation[9], position[3];
+        const btMatrix3x3 &basis = bt_pose_.getBasis();
+        for (int i = 0; i < 3; ++i) {
+            for (int j = 0; j < 3; ++j)
+                rotation[3 * i + j] = float(basis[i][j]);
+            position[i] = float(bt_pose_.getOrigin()[i] / B_DIM_SCALE);
+        }
+        SetActorMatrix(rotation, position);
+        dirty_ = false;
     }
 
 private:
 
-    btTransform KDLFrameToBtTransform(const KDL::Frame &in){
+    static btTransform KDLFrameToBtTransform(const KDL::Frame &in){
         btTransform transform;
         transform.setIdentity();
         transform.setOrigin(btVector3(btScalar(B_DIM_SCALE*in.p[0]),
@@ -117,7 +151,7 @@ private:
         return transform;
     }
 
-    KDL::Frame btTransformToKDLFrame(btTransform in){
+    static KDL::Frame btTransformToKDLFrame(const btTransform &in){
         btQuaternion rot = in.getRotation();
         btVector3 pos = in.getOrigin();
 
@@ -20,6 +20,7 @@ enum {
     CE_PAUSE_TASK = 10,
     CE_RESET_TASK = 11,
     CE_RESET_ACQUISITION = 12,
+    CE_CANCEL_TASK_LOADING = 13,
 
     CE_CALIB_ARM1 = 20,
     CE_CALIB_ARM2 = 21,
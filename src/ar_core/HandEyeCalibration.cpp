@@ -0,0 +1,331 @@
+//
+// Created by charm on 19/10/26.
+//
+
+#include "HandEyeCalibration.h"
+#include <image_transport/image_transport.h>
+#include <custom_conversions/Conversions.h>
+#include <kdl/frames_io.hpp>
+#include <iomanip>
+#include <cmath>
+#include <algorithm>
+
+// -----------------------------------------------------------------------------
+static Eigen::Isometry3d KDLFrameToEigen(const KDL::Frame &in) {
+
+    Eigen::Isometry3d out = Eigen::Isometry3d::Identity();
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++)
+            out.linear()(i, j) = in.M(i, j);
+        out.translation()(i) = in.p[i];
+    }
+    return out;
+}
+
+// -----------------------------------------------------------------------------
+static KDL::Frame EigenToKDLFrame(const Eigen::Isometry3d &in) {
+
+    const Eigen::Matrix3d &R = in.linear();
+    return KDL::Frame(KDL::Rotation(R(0, 0), R(0, 1), R(0, 2),
+                                    R(1, 0), R(1, 1), R(1, 2),
+                                    R(2, 0), R(2, 1), R(2, 2)),
+                      KDL::Vector(in.translation()(0), in.translation()(1),
+                                  in.translation()(2)));
+}
+
+
+// -----------------------------------------------------------------------------
+HandEyeCalibration::HandEyeCalibration(Manipulator *manip)
+        :manipulator(manip)
+{
+
+    ros::NodeHandle n("~");
+
+    it =  new image_transport::ImageTransport(n);
+
+    std::string cam_name;
+    n.getParam("cam_0_name", cam_name);
+
+    ar_camera = new AugmentedCamera( it, cam_name);
+
+    // get the intrinsics
+    ar_camera->GetIntrinsicMatrices(cam_matrix, cam_distortation);
+
+    n.param<double>("hand_eye_min_sample_rotation", min_sample_rotation,
+                    min_sample_rotation);
+    n.param<double>("hand_eye_min_sample_translation", min_sample_translation,
+                    min_sample_translation);
+    n.param<int>("hand_eye_max_samples", max_samples, max_samples);
+    n.param<int>("hand_eye_min_samples", min_samples, min_samples);
+    // the solver needs at least 3 poses
+    min_samples = std::max(3, min_samples);
+}
+
+// -----------------------------------------------------------------------------
+HandEyeCalibration::~HandEyeCalibration() {
+
+    StopSolver();
+    delete ar_camera;
+    delete it;
+}
+
+// -----------------------------------------------------------------------------
+bool HandEyeCalibration::DoCalibration(KDL::Frame &result) {
+
+    if(!ar_camera->IsPoseEstimated()) {
+        ROS_ERROR("The hand-eye calibration needs the board pose estimated "
+                          "by the camera. Remove the parameter or topic of "
+                          "the camera pose.");
+        return false;
+    }
+
+    solver_thread = boost::thread(&HandEyeCalibration::SolverThread, this);
+
+    const std::string window_name = "Hand-eye calibration";
+    bool exit = false;
+    cv::Mat image;
+    ros::Rate rate(30);
+
+    while(ros::ok() && !exit) {
+
+        // takes the new frame, which also hands it to the pose thread
+        const bool new_image = ar_camera->IsImageNew();
+
+        // the board poses are estimated in the camera's pose thread
+        KDL::Frame board_pose;
+        if(ar_camera->GetNewWorldToCamTr(board_pose)) {
+            last_board_pose = board_pose;
+            last_board_pose_time = ros::Time::now();
+            if(state == COLLECTING) {
+                pending_board_pose = board_pose;
+                pending_board_stamp = ar_camera->GetWorldToCamTrStamp();
+                has_pending_board_pose = true;
+            }
+        }
+        if(has_pending_board_pose)
+            TryAddSample();
+
+        // get the manipulator pose
+        KDL::Frame manip_pose_loc;
+        manipulator->GetPoseLocal(manip_pose_loc);
+
+        if(new_image) {
+            cv::cvtColor(ar_camera->GetImage(), image, cv::COLOR_RGB2BGR);
+            PutDrawings(image, manip_pose_loc);
+            cv::imshow(window_name, image);
+        }
+
+        auto key = (char) cv::waitKey(1);
+
+        if (key == 27)
+            exit = true;
+
+        bool solved;
+        {
+            boost::lock_guard<boost::mutex> lock(solver_mutex);
+            solved = has_solution;
+        }
+        if (key == 'f' && state == COLLECTING && solved) {
+            StopSolver();
+            // final solution with all the samples
+            if(hand_eye::Solve(arm_poses, board_poses, solution)) {
+                ROS_INFO_STREAM("-- Camera pose in the arm frame calculated "
+                                        "from " << solution.n_samples
+                                << " samples: \n"
+                                << EigenToKDLFrame(solution.X) << std::endl
+                                << "rms residuals: "
+                                << solution.rms_translation * 1000.0 << " mm, "
+                                << solution.rms_rotation * 180.0 / M_PI
+                                << " deg");
+                state = PLACING_BOARD;
+            }
+            else
+                solver_thread = boost::thread(
+                        &HandEyeCalibration::SolverThread, this);
+        }
+
+        if (key == 'w' && state == PLACING_BOARD) {
+            if(ros::Time::now() - last_board_pose_time < ros::Duration(0.5)) {
+                world_to_cam_tr = last_board_pose;
+                world_to_arm_tr = EigenToKDLFrame(solution.X)
+                                  * world_to_cam_tr;
+                ROS_INFO_STREAM(
+                        std::string("-- World To PSM Transformation Calculated: \n")
+                                << world_to_arm_tr << std::endl);
+                state = DONE;
+            }
+            else
+                ROS_WARN("The board is not seen by the camera.");
+        }
+
+        ros::spinOnce();
+        rate.sleep();
+    }
+
+    StopSolver();
+    cvDestroyWindow(window_name.c_str());
+
+    if(state == DONE){
+        result = world_to_arm_tr;
+        return true;
+    }
+    return false;
+}
+
+// -----------------------------------------------------------------------------
+void HandEyeCalibration::TryAddSample() {
+
+    // the manipulator poses of the capture time of the image may not have
+    // arrived yet
+    KDL::Frame arm_pose;
+    if(!manipulator->GetPoseLocalAt(pending_board_stamp, arm_pose)) {
+        if(ros::Time::now() - pending_board_stamp > ros::Duration(0.5))
+            has_pending_board_pose = false;
+        return;
+    }
+    has_pending_board_pose = false;
+
+    if((int)arm_poses.size() >= max_samples)
+        return;
+
+    // samples close to one already kept add little to the solution
+    const Eigen::Isometry3d A = KDLFrameToEigen(arm_pose);
+    for (const auto &kept : arm_poses)
+        if(hand_eye::RotationAngle(kept.linear(), A.linear())
+           < min_sample_rotation
+           && (kept.translation() - A.translation()).norm()
+              < min_sample_translation)
+            return;
+
+    {
+        boost::lock_guard<boost::mutex> lock(solver_mutex);
+        arm_poses.push_back(A);
+        board_poses.push_back(KDLFrameToEigen(pending_board_pose));
+    }
+    solver_condition.notify_one();
+}
+
+// -----------------------------------------------------------------------------
+void HandEyeCalibration::SolverThread() {
+
+    size_t solved_samples = 0;
+
+    try {
+        while (true) {
+
+            hand_eye::PoseVector A, B;
+            {
+                boost::unique_lock<boost::mutex> lock(solver_mutex);
+                while (arm_poses.size() == solved_samples
+                       || (int)arm_poses.size() < min_samples)
+                    solver_condition.wait(lock);
+                A = arm_poses;
+                B = board_poses;
+            }
+            solved_samples = A.size();
+
+            // a few ms for a hundred samples
+            hand_eye::Solution new_solution;
+            if(!hand_eye::Solve(A, B, new_solution))
+                continue;
+
+            {
+                boost::lock_guard<boost::mutex> lock(solver_mutex);
+                solution = new_solution;
+                has_solution = true;
+            }
+            boost::this_thread::interruption_point();
+        }
+    } catch(const boost::thread_interrupted &) { }
+}
+
+// -----------------------------------------------------------------------------
+void HandEyeCalibration::StopSolver() {
+
+    if(!solver_thread.joinable())
+        return;
+    solver_thread.interrupt();
+    solver_thread.join();
+}
+
+// -----------------------------------------------------------------------------
+void HandEyeCalibration::PutDrawings(cv::Mat img,
+                                     const KDL::Frame &manip_pose_loc) {
+
+    std::string instructions;
+    std::stringstream state_msg;
+
+    hand_eye::Solution current;
+    bool solved;
+    size_t n_samples;
+    {
+        boost::lock_guard<boost::mutex> lock(solver_mutex);
+        current = solution;
+        solved = has_solution;
+        n_samples = arm_poses.size();
+    }
+
+    if(state == COLLECTING) {
+        instructions = "Move the arm with the board on the tool, rotating it "
+                "about different axes. Press 'f' to finish, 'Esc' to exit";
+
+        state_msg << "Samples: " << n_samples;
+        if(solved) {
+            state_msg << std::fixed << std::setprecision(2)
+                      << "  rms residuals: "
+                      << current.rms_translation * 1000.0 << " mm, "
+                      << current.rms_rotation * 180.0 / M_PI << " deg ("
+                      << current.n_samples << " samples)";
+
+            // where the current solution expects the board
+            const Eigen::Isometry3d board_in_cam = current.X.inverse()
+                    * KDLFrameToEigen(manip_pose_loc) * current.Y;
+            DrawFrame(img, EigenToKDLFrame(board_in_cam), 0.02);
+        }
+    }
+    else if(state == PLACING_BOARD) {
+        instructions = "Put the board back at its place in the world and "
+                "press 'w'. Press 'Esc' to exit";
+    }
+    else {
+        instructions = "Calibration finished. Press 'Esc' to exit";
+
+        // ---------------------- draw the tool tip frame ----------------------
+        DrawFrame(img, world_to_cam_tr * world_to_arm_tr.Inverse()
+                       * manip_pose_loc, 0.01);
+
+        // draw the coordinate frame of the board
+        DrawFrame(img, world_to_cam_tr, 0.02);
+    }
+
+    // draw the instructions
+    cv::putText(img, instructions, cv::Point(10, 20),
+                cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(255, 50, 0), 2);
+    cv::putText(img, state_msg.str(), cv::Point(10, 40),
+                cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(255, 50, 0), 2);
+}
+
+// -----------------------------------------------------------------------------
+void HandEyeCalibration::DrawFrame(cv::Mat img,
+                                   const KDL::Frame &frame_in_cam,
+                                   float length) {
+
+    cv::Vec3d rvec, tvec;
+    conversions::KDLFrameToRvectvec(frame_in_cam, rvec, tvec);
+
+    std::vector<cv::Point3f> axisPoints {
+            cv::Point3f(0.f, 0.f, 0.f),
+            cv::Point3f(length, 0.f, 0.f),
+            cv::Point3f(0.f, length, 0.f),
+            cv::Point3f(0.f, 0.f, length),
+    };
+
+    std::vector<cv::Point2f> imagePoints;
+    cv::projectPoints(axisPoints, rvec, tvec, cam_matrix,
+                      cam_distortation, imagePoints);
+
+    // draw axis lines
+    cv::line(img, imagePoints[0], imagePoints[1], cv::Scalar(0, 0, 200), 2, CV_AA);
+    cv::line(img, imagePoints[0], imagePoints[2], cv::Scalar(0, 200, 0), 2, CV_AA);
+    cv::line(img, imagePoints[0], imagePoints[3], cv::Scalar(200, 0, 0), 2, CV_AA);
+}
@@ -0,0 +1,113 @@
+//
+// Created by charm on 19/10/26.
+//
+
+#ifndef ATAR_HANDEYECALIBRATION_H
+#define ATAR_HANDEYECALIBRATION_H
+
+#include <opencv2/opencv.hpp>
+#include <Eigen/Dense>
+#include <Eigen/Geometry>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include "Manipulator.h"
+#include "AugmentedCamera.h"
+#include "src/arm_to_world_calibration/HandEyeSolver.h"
+
+/**
+ * \class HandEyeCalibration
+ * \brief Manipulator to world calibration from free motion of the arm,
+ * instead of touching points (see ManipulatorToWorldCalibration).
+ *
+ * The charuco board is held by the tool and the operator moves the arm
+ * around in front of the (fixed) camera. Each board pose estimated by the
+ * camera is paired with the manipulator pose interpolated at the capture
+ * time of its image, and the pairs that are far enough from the ones
+ * already kept are added to the samples. A background thread solves the
+ * hand-eye problem (hand_eye::Solve) each time samples are added and the
+ * window shows the residuals of the last solution.
+ *
+ * This gives the pose of the camera in the arm base frame. Once done, the
+ * board is put back at its place in the world and its pose closes the chain
+ * from the world to the arm base.
+ *
+ * The camera pose must be estimated from the board, so there must be no
+ * camera pose parameter or topic.
+ */
+class HandEyeCalibration {
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    explicit HandEyeCalibration(Manipulator *manip);
+
+    ~HandEyeCalibration();
+
+    // result is the world to arm transformation, as in
+    // ManipulatorToWorldCalibration
+    bool DoCalibration(KDL::Frame &result);
+
+private:
+
+    // Pairs the pending board pose with the manipulator pose, once the
+    // manipulator poses cover its stamp
+    void TryAddSample();
+
+    void SolverThread();
+
+    void StopSolver();
+
+    void PutDrawings(cv::Mat img, const KDL::Frame &manip_pose_loc);
+
+    void DrawFrame(cv::Mat img, const KDL::Frame &frame_in_cam,
+                   float length);
+
+private:
+
+    enum State {
+        COLLECTING,
+        PLACING_BOARD,
+        DONE
+    };
+
+    AugmentedCamera * ar_camera;
+    Manipulator * manipulator;
+    image_transport::ImageTransport *it;
+
+    cv::Mat cam_matrix;
+    cv::Mat cam_distortation;
+
+    State state = COLLECTING;
+
+    // board pose waiting for the manipulator poses of its time
+    bool has_pending_board_pose = false;
+    KDL::Frame pending_board_pose;
+    ros::Time pending_board_stamp;
+    // last board pose and when it was received
+    KDL::Frame last_board_pose;
+    ros::Time last_board_pose_time;
+
+    // a sample is kept if it is rotated or moved by this much from all the
+    // others
+    double min_sample_rotation = 0.09;
+    double min_sample_translation = 0.01;
+    int max_samples = 150;
+    // samples before the first solution
+    int min_samples = 10;
+
+    // samples, appended under solver_mutex
+    hand_eye::PoseVector arm_poses;
+    hand_eye::PoseVector board_poses;
+
+    boost::thread solver_thread;
+    boost::mutex solver_mutex;
+    boost::condition_variable solver_condition;
+    bool has_solution = false;
+    hand_eye::Solution solution;
+
+    KDL::Frame world_to_arm_tr;
+    KDL::Frame world_to_cam_tr;
+};
+
+
+#endif //ATAR_HANDEYECALIBRATION_H
@@ -0,0 +1,127 @@
+//
+// Created by charm on 19/10/26.
+//
+
+#include "HapticsScheduler.h"
+#include <boost/thread/thread.hpp>
+#include <geometry_msgs/PoseStamped.h>
+#include <kdl_conversions/kdl_msg.h>
+
+
+// -----------------------------------------------------------------------------
+HapticsScheduler::HapticsScheduler(const double rate_hz)
+        :
+        rate_hz(rate_hz)
+{ }
+
+// -----------------------------------------------------------------------------
+int HapticsScheduler::AddArm(Manipulator *manipulator,
+                             const std::string &desired_pose_topic,
+                             std::shared_ptr<VirtualFixture> fixture,
+                             const unsigned int soft_start_ticks) {
+
+    std::unique_ptr<Arm> arm(new Arm);
+    arm->manipulator = manipulator;
+    arm->fixture = std::move(fixture);
+    arm->soft_start_ticks = soft_start_ticks;
+    arm->pub_desired = n.advertise<geometry_msgs::PoseStamped>(
+            desired_pose_topic, 1);
+    ROS_INFO("Will publish on %s", desired_pose_topic.c_str());
+
+    arms.push_back(std::move(arm));
+    return int(arms.size()) - 1;
+}
+
+// -----------------------------------------------------------------------------
+void HapticsScheduler::SetControlledFrame(const int arm,
+                                          const KDL::Frame &tool_to_controlled) {
+    arms[arm]->settings.Modify([&tool_to_controlled](ArmSettings &s){
+        s.tool_to_controlled = tool_to_controlled; });
+}
+
+// -----------------------------------------------------------------------------
+void HapticsScheduler::SetEngaged(const int arm, const bool engaged) {
+    arms[arm]->settings.Modify([engaged](ArmSettings &s){
+        s.engaged = engaged; });
+}
+
+// -----------------------------------------------------------------------------
+HapticsArmOutput HapticsScheduler::GetLastOutput(const int arm) {
+    return arms[arm]->output.Load();
+}
+
+// -----------------------------------------------------------------------------
+void HapticsScheduler::Run() {
+
+    ros::Rate loop_rate(rate_hz);
+    ROS_INFO("The desired poses will be updated at %.0f Hz", rate_hz);
+
+    while (ros::ok())
+    {
+        Tick();
+
+        if(tick_callback)
+            tick_callback();
+
+        ros::spinOnce();
+        loop_rate.sleep();
+        boost::this_thread::interruption_point();
+    }
+}
+
+// -----------------------------------------------------------------------------
+void HapticsScheduler::Tick() {
+
+    geometry_msgs::PoseStamped pose_msg;
+    pose_msg.header.frame_id = "/slave_frame";
+
+    for (auto &arm : arms) {
+
+        const ManipulatorState state = arm->manipulator->GetState();
+        const ArmSettings settings = arm->settings.Load();
+
+        HapticsArmOutput out;
+        out.engaged = settings.engaged;
+        out.gripper_angle = state.gripper_angle;
+        out.tool_current = state.pose_world;
+        out.tool_desired = state.pose_world;
+        out.controlled_current = state.pose_world * settings.tool_to_controlled;
+        out.controlled_desired = out.controlled_current;
+
+        // restart the soft start when the arm gets engaged
+        if(settings.engaged && !arm->engaged_last)
+            arm->soft_start_counter = 0;
+        arm->engaged_last = settings.engaged;
+
+        if(settings.engaged && arm->fixture) {
+
+            out.fixture_active = arm->fixture->GetDesiredPose(
+                    out.controlled_current, out.controlled_desired);
+
+            double soft_start = 1.0;
+            if(arm->soft_start_counter < arm->soft_start_ticks) {
+                soft_start = double(arm->soft_start_counter)
+                             / double(arm->soft_start_ticks);
+                arm->soft_start_counter++;
+            }
+
+            // add the displacement that would take the controlled frame
+            // to its desired pose to the current pose of the tool
+            KDL::Vector delta_p = out.controlled_desired.p
+                                  - out.controlled_current.p;
+            KDL::Rotation delta_M = out.controlled_desired.M
+                                    * out.controlled_current.M.Inverse();
+
+            out.tool_desired.p = soft_start * delta_p + out.tool_current.p;
+            out.tool_desired.M = delta_M * out.tool_current.M;
+        }
+
+        arm->output.Store(out);
+
+        // publish in the local frame of the manipulator
+        tf::poseKDLToMsg(arm->manipulator->GetWorldToLocalTr()
+                         * out.tool_desired, pose_msg.pose);
+        pose_msg.header.stamp = ros::Time::now();
+        arm->pub_desired.publish(pose_msg);
+    }
+}
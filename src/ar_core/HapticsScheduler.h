@@ -0,0 +1,109 @@
+//
+// Created by charm on 19/10/26.
+//
+
+#ifndef ATAR_HAPTICSSCHEDULER_H
+#define ATAR_HAPTICSSCHEDULER_H
+
+#include <ros/ros.h>
+#include <kdl/frames.hpp>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "Manipulator.h"
+#include "VirtualFixtures.h"
+#include "SeqLock.h"
+
+/**
+ * \class HapticsScheduler
+ * \brief Runs the virtual fixtures of all the arms of a task in one
+ * haptics loop.
+ *
+ * At each tick and for each arm it reads a snapshot of the manipulator,
+ * finds the pose of the controlled frame (the tool itself, or an object
+ * rigidly attached to it like a grasped ring), evaluates the fixture of the
+ * arm on it and publishes the resulting desired tool pose in the local
+ * frame of the manipulator. The displacement that takes the controlled
+ * frame to its desired pose is added to the current pose of the tool:
+ *      tool_desired.p = tool_current.p + soft_start * delta.p
+ *      tool_desired.M = delta.M * tool_current.M
+ * When an arm is not engaged its current pose is published as the desired
+ * one.
+ *
+ * Soft start: engaging a fixture would cause a sudden high wrench. To
+ * prevent this the position displacement is ramped up linearly over
+ * soft_start_ticks ticks every time an arm becomes engaged.
+ *
+ * SetEngaged and SetControlledFrame can be called from any thread (e.g.
+ * the graphics thread that detects grasps). Run blocks, so call it from the
+ * HapticsThread of the task; it also spins ros.
+ */
+
+// Result of the last tick for one arm
+struct HapticsArmOutput {
+    bool        engaged = false;
+    bool        fixture_active = false;
+    KDL::Frame  tool_current;
+    KDL::Frame  tool_desired;
+    KDL::Frame  controlled_current;
+    KDL::Frame  controlled_desired;
+    double      gripper_angle = 0.0;
+};
+
+
+class HapticsScheduler {
+public:
+
+    explicit HapticsScheduler(double rate_hz = 500.0);
+
+    // Adds an arm and returns its index. fixture can be shared between
+    // arms only if they are evaluated in this scheduler.
+    int AddArm(Manipulator *manipulator,
+               const std::string &desired_pose_topic,
+               std::shared_ptr<VirtualFixture> fixture,
+               unsigned int soft_start_ticks = 200);
+
+    // The fixture acts on tool_pose * tool_to_controlled
+    void SetControlledFrame(int arm, const KDL::Frame &tool_to_controlled);
+
+    // The fixture is applied only when the arm is engaged.
+    void SetEngaged(int arm, bool engaged);
+
+    HapticsArmOutput GetLastOutput(int arm);
+
+    // Called at the end of every tick, in the haptics thread. Can be used
+    // for task specific things (errors, lower rate publishing...)
+    void SetTickCallback(std::function<void()> cb){tick_callback = cb;};
+
+    // Runs the loop until ros shuts down or the thread is interrupted
+    void Run();
+
+private:
+    void Tick();
+
+private:
+
+    struct ArmSettings {
+        KDL::Frame  tool_to_controlled;
+        bool        engaged = false;
+    };
+
+    struct Arm {
+        Manipulator *                       manipulator;
+        std::shared_ptr<VirtualFixture>     fixture;
+        ros::Publisher                      pub_desired;
+        unsigned int                        soft_start_ticks;
+        unsigned int                        soft_start_counter = 0;
+        bool                                engaged_last = false;
+        SeqLock<ArmSettings>                settings;
+        SeqLock<HapticsArmOutput>           output;
+    };
+
+    double                                  rate_hz;
+    ros::NodeHandle                         n;
+    std::vector<std::unique_ptr<Arm> >      arms;
+    std::function<void()>                   tick_callback;
+};
+
+
+#endif //ATAR_HAPTICSSCHEDULER_H
@@ -0,0 +1,227 @@
+//
+// Created by charm on 19/10/26.
+//
+
+#include "ImageDecodePool.h"
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+#include <boost/bind.hpp>
+#include <algorithm>
+#include <chrono>
+#ifdef WITH_TURBOJPEG
+#include <turbojpeg.h>
+#endif
+
+// frames of a stream that can be decoded or held at the same time
+static const size_t MAX_BUFFERS_PER_STREAM = 6;
+
+// -----------------------------------------------------------------------------
+bool ImageDecodePool::Stream::GetNewFrame(cv::Mat &frame, ros::Time &stamp) {
+
+    boost::lock_guard<boost::mutex> lock(mutex);
+    if(!has_ready_frame)
+        return false;
+
+    frame = ready_frame;
+    stamp = ready_stamp;
+    // the pool must not keep a reference, or the buffer is never reused
+    ready_frame = cv::Mat();
+    has_ready_frame = false;
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+ImageDecodePool::DecodeStats ImageDecodePool::Stream::GetStats() {
+
+    boost::lock_guard<boost::mutex> lock(mutex);
+    DecodeStats out = stats;
+    if(stats.decoded > 0)
+        out.mean_decode_ms = decode_ms_sum / stats.decoded;
+    stats = DecodeStats();
+    decode_ms_sum = 0.0;
+    return out;
+}
+
+// -----------------------------------------------------------------------------
+cv::Mat ImageDecodePool::Stream::AcquireBuffer(const int width,
+                                               const int height) {
+
+    boost::lock_guard<boost::mutex> lock(mutex);
+
+    // a buffer only referenced by the stream is free. Copying it out under
+    // the lock raises its count, so no other thread can take it.
+    for (auto &buffer : buffers)
+        if(buffer.u->refcount == 1) {
+            buffer.create(height, width, CV_8UC3);
+            return buffer;
+        }
+
+    cv::Mat buffer(height, width, CV_8UC3);
+    if(buffers.size() < MAX_BUFFERS_PER_STREAM)
+        buffers.push_back(buffer);
+    return buffer;
+}
+
+// -----------------------------------------------------------------------------
+void ImageDecodePool::Stream::SetDecodedFrame(const cv::Mat &frame,
+                                              const ros::Time &stamp,
+                                              const double decode_ms) {
+
+    boost::lock_guard<boost::mutex> lock(mutex);
+
+    stats.decoded++;
+    decode_ms_sum += decode_ms;
+    stats.max_decode_ms = std::max(stats.max_decode_ms, decode_ms);
+
+    if(stamp < newest_stamp) {
+        stats.dropped++;
+        return;
+    }
+    if(has_ready_frame)
+        stats.dropped++;
+
+    ready_frame = frame;
+    ready_stamp = stamp;
+    newest_stamp = stamp;
+    has_ready_frame = true;
+}
+
+// -----------------------------------------------------------------------------
+void ImageDecodePool::Stream::CountDropped() {
+    boost::lock_guard<boost::mutex> lock(mutex);
+    stats.dropped++;
+}
+
+// -----------------------------------------------------------------------------
+ImageDecodePool &ImageDecodePool::Get() {
+
+    static int num_threads =
+            ros::NodeHandle("~").param<int>("decode_threads", 2);
+    static ImageDecodePool pool(num_threads);
+    return pool;
+}
+
+// -----------------------------------------------------------------------------
+ImageDecodePool::ImageDecodePool(const int num_threads) {
+
+    for (int i = 0; i < std::max(num_threads, 1); ++i)
+        threads.create_thread(boost::bind(&ImageDecodePool::WorkerThread,
+                                          this));
+    ROS_INFO("Decoding the compressed images with %d thread(s)%s.",
+             std::max(num_threads, 1),
+#ifdef WITH_TURBOJPEG
+             " and libjpeg-turbo"
+#else
+             ""
+#endif
+    );
+}
+
+// -----------------------------------------------------------------------------
+ImageDecodePool::~ImageDecodePool() {
+    threads.interrupt_all();
+    threads.join_all();
+}
+
+// -----------------------------------------------------------------------------
+std::shared_ptr<ImageDecodePool::Stream> ImageDecodePool::CreateStream() {
+    return std::make_shared<Stream>();
+}
+
+// -----------------------------------------------------------------------------
+void ImageDecodePool::Submit(const std::shared_ptr<Stream> &stream,
+                             const sensor_msgs::CompressedImageConstPtr &msg) {
+
+    {
+        boost::lock_guard<boost::mutex> lock(mutex);
+        // a message of the stream that is still waiting is replaced: there
+        // is no point in decoding a frame that will never be shown
+        auto waiting = std::find_if(jobs.begin(), jobs.end(),
+                                    [&stream](const Job &job) {
+                                        return job.stream == stream;
+                                    });
+        if(waiting != jobs.end()) {
+            waiting->msg = msg;
+            stream->CountDropped();
+            return;
+        }
+        jobs.push_back(Job{stream, msg});
+    }
+    condition.notify_one();
+}
+
+// -----------------------------------------------------------------------------
+void ImageDecodePool::WorkerThread() {
+
+    void *turbojpeg_handle = nullptr;
+#ifdef WITH_TURBOJPEG
+    turbojpeg_handle = tjInitDecompress();
+#endif
+
+    try {
+        while (true) {
+
+            Job job;
+            {
+                boost::unique_lock<boost::mutex> lock(mutex);
+                while (jobs.empty())
+                    condition.wait(lock);
+                job = jobs.front();
+                jobs.pop_front();
+            }
+
+            const ros::Time stamp = job.msg->header.stamp.isZero()
+                                    ? ros::Time::now()
+                                    : job.msg->header.stamp;
+            auto start = std::chrono::steady_clock::now();
+            cv::Mat frame;
+            if(!Decode(turbojpeg_handle, *job.msg, *job.stream, frame))
+                continue;
+            std::chrono::duration<double, std::milli> decode_time =
+                    std::chrono::steady_clock::now() - start;
+
+            job.stream->SetDecodedFrame(frame, stamp, decode_time.count());
+        }
+    } catch(const boost::thread_interrupted &) { }
+
+#ifdef WITH_TURBOJPEG
+    tjDestroy(turbojpeg_handle);
+#endif
+}
+
+// -----------------------------------------------------------------------------
+bool ImageDecodePool::Decode(void *turbojpeg_handle,
+                             const sensor_msgs::CompressedImage &msg,
+                             Stream &stream, cv::Mat &frame) {
+
+    unsigned char *data = const_cast<unsigned char *>(msg.data.data());
+    const unsigned long size = msg.data.size();
+
+#ifdef WITH_TURBOJPEG
+    // straight to rgb in the buffer, no intermediate image
+    if(msg.format.find("png") == std::string::npos) {
+        int width, height, subsampling, colorspace;
+        if(tjDecompressHeader3(turbojpeg_handle, data, size, &width, &height,
+                               &subsampling, &colorspace) == 0) {
+            frame = stream.AcquireBuffer(width, height);
+            if(tjDecompress2(turbojpeg_handle, data, size, frame.data, width,
+                             (int)frame.step, height, TJPF_RGB,
+                             TJFLAG_FASTDCT) == 0)
+                return true;
+        }
+        ROS_ERROR_THROTTLE(1, "Failed to decode jpeg image: %s",
+                           tjGetErrorStr());
+        return false;
+    }
+#endif
+
+    const cv::Mat bgr = cv::imdecode(cv::Mat(1, (int)size, CV_8UC1, data),
+                                     cv::IMREAD_COLOR);
+    if(bgr.empty()) {
+        ROS_ERROR_THROTTLE(1, "Failed to decode %s image.", msg.format.c_str());
+        return false;
+    }
+    frame = stream.AcquireBuffer(bgr.cols, bgr.rows);
+    cv::cvtColor(bgr, frame, cv::COLOR_BGR2RGB);
+    return true;
+}
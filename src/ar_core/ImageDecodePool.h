@@ -0,0 +1,115 @@
+//
+// Created by charm on 19/10/26.
+//
+
+#ifndef ATAR_IMAGEDECODEPOOL_H
+#define ATAR_IMAGEDECODEPOOL_H
+
+#include <deque>
+#include <memory>
+#include <vector>
+#include <ros/ros.h>
+#include <opencv2/core.hpp>
+#include <sensor_msgs/CompressedImage.h>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+/**
+ * \class ImageDecodePool
+ * \brief A few threads decoding the compressed images of the cameras, so
+ * that the jpeg decoding does not run on the thread that spins for the
+ * render loop.
+ *
+ * Each camera has a Stream. The messages submitted to it are decoded by any
+ * free thread, with libjpeg-turbo when ATAR is built with it (directly to
+ * rgb, see WITH_TURBOJPEG in CMakeLists.txt) and cv::imdecode otherwise.
+ * The frames are decoded into a small set of buffers owned by the stream
+ * and reused once nobody holds them anymore.
+ *
+ * GetNewFrame hands out the newest decoded frame. Frames come out ordered by
+ * stamp: a frame that finishes decoding after a newer one is dropped, and
+ * so is a message still waiting in the queue when a newer one of the same
+ * stream arrives.
+ */
+class ImageDecodePool {
+public:
+
+    struct DecodeStats {
+        double  mean_decode_ms = 0.0;
+        double  max_decode_ms = 0.0;
+        int     decoded = 0;
+        int     dropped = 0;
+    };
+
+    class Stream {
+    public:
+
+        // true and the frame if a frame newer than the last one returned is
+        // available. The frame is rgb8 and must not be modified.
+        bool GetNewFrame(cv::Mat &frame, ros::Time &stamp);
+
+        // Stats since the previous call
+        DecodeStats GetStats();
+
+    private:
+
+        friend class ImageDecodePool;
+
+        // A free buffer of the stream of the given size, or a new one
+        cv::Mat AcquireBuffer(const int width, const int height);
+
+        void SetDecodedFrame(const cv::Mat &frame, const ros::Time &stamp,
+                             const double decode_ms);
+
+        void CountDropped();
+
+    private:
+
+        boost::mutex            mutex;
+        std::vector<cv::Mat>    buffers;
+        cv::Mat                 ready_frame;
+        ros::Time               ready_stamp;
+        bool                    has_ready_frame = false;
+        // newest stamp that was made ready, older frames are dropped
+        ros::Time               newest_stamp;
+        DecodeStats             stats;
+        double                  decode_ms_sum = 0.0;
+    };
+
+    // The pool of the process. Its number of threads is the decode_threads
+    // private parameter (default 2), read at the first call.
+    static ImageDecodePool &Get();
+
+    explicit ImageDecodePool(const int num_threads);
+
+    ~ImageDecodePool();
+
+    std::shared_ptr<Stream> CreateStream();
+
+    void Submit(const std::shared_ptr<Stream> &stream,
+                const sensor_msgs::CompressedImageConstPtr &msg);
+
+private:
+
+    struct Job {
+        std::shared_ptr<Stream>                 stream;
+        sensor_msgs::CompressedImageConstPtr    msg;
+    };
+
+    void WorkerThread();
+
+    // false if msg could not be decoded
+    bool Decode(void *turbojpeg_handle, const sensor_msgs::CompressedImage &msg,
+                Stream &stream, cv::Mat &frame);
+
+private:
+
+    boost::mutex                mutex;
+    boost::condition_variable   condition;
+    std::deque<Job>             jobs;
+    boost::thread_group         threads;
+};
+
+
+#endif //ATAR_IMAGEDECODEPOOL_H
@@ -9,6 +9,9 @@
 #include <image_transport/subscriber.h>
 #include <image_transport/image_transport.h>
 #include <cv_bridge/cv_bridge.h>
+#include <boost/bind.hpp>
+#include <algorithm>
+#include <limits>
 
 
 IntrinsicCalibrationCharuco::IntrinsicCalibrationCharuco(
@@ -43,6 +46,11 @@ IntrinsicCalibrationCharuco::IntrinsicCalibrationCharuco(
 
 }
 
+IntrinsicCalibrationCharuco::~IntrinsicCalibrationCharuco() {
+    StopThreads();
+}
+
+//------------------------------------------------------------------------------
 bool IntrinsicCalibrationCharuco::DoCalibration(std::string outputFile,
                                                 double &repError,
                                                 cv::Mat &cameraMatrix,
@@ -56,90 +64,95 @@ bool IntrinsicCalibrationCharuco::DoCalibration(std::string outputFile,
     ROS_INFO("Intrinsic Calibration with Charuco board started. Follow the "
                      "instructions shown on the image.");
 
+    n.param<bool>("auto_capture", auto_capture, true);
+    n.param<double>("min_frame_diversity", min_frame_diversity, 0.15);
+
     LockAndGetImage();
 
+    // leave one core to the callback that shows the images
+    n_detection_threads = std::max(1, std::min(4,
+            (int)boost::thread::hardware_concurrency() - 1));
+    for (int i = 0; i < n_detection_threads; ++i)
+        detection_threads.create_thread(
+                boost::bind(&IntrinsicCalibrationCharuco::DetectionThread,
+                            this));
+    solver_thread = boost::thread(&IntrinsicCalibrationCharuco::SolverThread,
+                                  this);
+    threads_running = true;
+
     // -----------------------------------------------------------------------//
 
     while(ros::ok() && !finished_capturing ){
         ros::spinOnce();
+        ProcessDetections();
         loop_rate.sleep();
     }
 
+    StopThreads();
+    ProcessDetections();
+
     // -----------------------------------------------------------------------//
 
-    if(allIds.size() < 10 || allImgs.size() < 15) {
+    if(allCharucoCorners.size() < 15) {
         ROS_WARN("Not enough captures for calibration. Take at least 15 "
                           "frames");
         cvDestroyWindow(window_name.c_str());
         return false;
     }
 
-    //    cv::Mat cameraMatrix, distCoeffs;
     std::vector< cv::Mat > rvecs, tvecs;
     //    double repError;
     float aspectRatio = 1;
 
-    // prepare data for calibration
-    std::vector< std::vector< cv::Point2f > > allCornersConcatenated;
-    std::vector< int > allIdsConcatenated;
-    std::vector< int > markerCounterPerFrame;
-    markerCounterPerFrame.reserve(allCorners.size());
-    for(unsigned int i = 0; i < allCorners.size(); i++) {
-        markerCounterPerFrame.push_back((int)allCorners[i].size());
-        for(unsigned int j = 0; j < allCorners[i].size(); j++) {
-            allCornersConcatenated.push_back(allCorners[i][j]);
-            allIdsConcatenated.push_back(allIds[i][j]);
-        }
-    }
-
     int calibrationFlags = 0;
-    cv::Ptr<cv::aruco::Board> board = charuco_board
-            .staticCast<cv::aruco::Board>();
-
-    // calibrate camera using aruco markers
-    double arucoRepErr;
-    arucoRepErr = cv::aruco::calibrateCameraAruco(
-            allCornersConcatenated, allIdsConcatenated,
-            markerCounterPerFrame, board, imgSize, cameraMatrix,
-            distCoeffs, cv::noArray(), cv::noArray
-                    (), calibrationFlags);
-
-    // prepare data for charuco calibration
-    int nFrames = (int)allCorners.size();
-    std::vector< cv::Mat > allCharucoCorners;
-    std::vector< cv::Mat > allCharucoIds;
-    std::vector< cv::Mat > filteredImages;
-    allCharucoCorners.reserve(nFrames);
-    allCharucoIds.reserve(nFrames);
-
-
-    for(int i = 0; i < nFrames; i++) {
-        // interpolate using camera parameters
-        cv::Mat currentCharucoCorners, currentCharucoIds;
-        cv::aruco::interpolateCornersCharuco(
-                allCorners[i], allIds[i],
-                allImgs[i], charuco_board,
-                currentCharucoCorners, currentCharucoIds, cameraMatrix,
-                distCoeffs);
-
-        allCharucoCorners.push_back(currentCharucoCorners);
-        allCharucoIds.push_back(currentCharucoIds);
-        filteredImages.push_back(allImgs[i]);
-    }
-
-    if(allCharucoCorners.size() < 4) {
-        ROS_ERROR("Not enough corners for calibration");
-        cvDestroyWindow(window_name.c_str());
-        return false;
+    // start from the last live calibration
+    int solveFlags = calibrationFlags;
+    if(!live_result.camera_matrix.empty()) {
+        live_result.camera_matrix.copyTo(cameraMatrix);
+        live_result.dist_coeffs.copyTo(distCoeffs);
+        solveFlags |= cv::CALIB_USE_INTRINSIC_GUESS;
     }
 
     // calibrate camera using charuco
+    cv::Mat stdDevIntrinsics;
+    std::vector<double> perViewErrors;
     repError =
             cv::aruco::calibrateCameraCharuco(
                     allCharucoCorners, allCharucoIds,
                     charuco_board, imgSize,
                     cameraMatrix, distCoeffs, rvecs, tvecs,
-                    calibrationFlags);
+                    stdDevIntrinsics, cv::noArray(), perViewErrors,
+                    solveFlags);
+
+    // drop the frames that fit much worse than the others (blurred or
+    // badly detected) and solve again
+    std::vector<double> sortedErrors = perViewErrors;
+    std::nth_element(sortedErrors.begin(),
+                     sortedErrors.begin() + sortedErrors.size() / 2,
+                     sortedErrors.end());
+    const double maxViewError =
+            std::max(3 * sortedErrors[sortedErrors.size() / 2], 1.0);
+
+    std::vector< cv::Mat > inlierCorners, inlierIds;
+    for (size_t i = 0; i < perViewErrors.size(); ++i)
+        if(perViewErrors[i] <= maxViewError) {
+            inlierCorners.push_back(allCharucoCorners[i]);
+            inlierIds.push_back(allCharucoIds[i]);
+        }
+
+    if(inlierCorners.size() < perViewErrors.size()
+       && inlierCorners.size() >= 15) {
+        std::cout << "Dropping " << perViewErrors.size() - inlierCorners.size()
+                  << " frames with a reprojection error above "
+                  << maxViewError << " px." << std::endl;
+        repError =
+                cv::aruco::calibrateCameraCharuco(
+                        inlierCorners, inlierIds,
+                        charuco_board, imgSize,
+                        cameraMatrix, distCoeffs, rvecs, tvecs,
+                        stdDevIntrinsics, cv::noArray(), cv::noArray(),
+                        calibrationFlags | cv::CALIB_USE_INTRINSIC_GUESS);
+    }
 
     bool saveOk =  saveCameraParams(outputFile, imgSize, aspectRatio,
                                     calibrationFlags, cameraMatrix,
@@ -151,7 +164,8 @@ bool IntrinsicCalibrationCharuco::DoCalibration(std::string outputFile,
     }
 
     std::cout << "Rep Error: " << repError << std::endl;
-    std::cout << "Rep Error Aruco: " << arucoRepErr << std::endl;
+    std::cout << "Std deviations (fx, fy, cx, cy, k1, k2, p1, p2, k3): "
+              << stdDevIntrinsics.rowRange(0, 9).t() << std::endl;
     std::cout << "Calibration saved to " << outputFile << std::endl;
 
     cvDestroyWindow(window_name.c_str());
@@ -159,54 +173,41 @@ bool IntrinsicCalibrationCharuco::DoCalibration(std::string outputFile,
 }
 
 
-
+//------------------------------------------------------------------------------
 void IntrinsicCalibrationCharuco::CameraImageCallback(
         const sensor_msgs::ImageConstPtr &msg) {
 
-    // generally not a good idea to do things that may take a while, in the
-    // callback, but let's bet on the low refresh rate of images and do it
-    // anyways!
+    // the detection runs in the detection threads, here we only show the
+    // images with the last detection and hand the frames over
 
     cv::Mat imageCopy;
 
     try {
-        image = cv_bridge::toCvCopy(msg, "bgr8")->image;
+        image = cv_bridge::toCvShare(msg, "bgr8")->image;
     }
     catch (cv_bridge::Exception &e) {
         ROS_ERROR("Could not convert from '%s' to 'bgr8'.",
                   msg->encoding.c_str());
+        return;
+    }
+    // set once, before the solver thread starts
+    if(imgSize.area() == 0)
+        imgSize = image.size();
+
+    Detection shown;
+    {
+        boost::lock_guard<boost::mutex> lock(detection_mutex);
+        shown = last_detection;
     }
-
-    std::vector<int> ids;
-    std::vector<std::vector<cv::Point2f> > corners, rejected;
-
-    // detect markers
-    cv::aruco::detectMarkers(
-        image, dictionary, corners, ids,
-        detector_params, rejected
-    );
-
-    // refind strategy to detect more markers
-    //            if (refindStrategy)
-    //                cv::aruco::refineDetectedMarkers(image, board, corners, ids, rejected);
-
-    // interpolate charuco corners
-    cv::Mat currentCharucoCorners, currentCharucoIds;
-    if (ids.size() > 0)
-        cv::aruco::interpolateCornersCharuco(
-            corners, ids, image, charuco_board,
-            currentCharucoCorners,
-            currentCharucoIds
-        );
 
     // draw results
     image.copyTo(imageCopy);
-    if (ids.size() > 0)
-        cv::aruco::drawDetectedMarkers(imageCopy, corners);
+    if (shown.marker_ids.size() > 0)
+        cv::aruco::drawDetectedMarkers(imageCopy, shown.marker_corners);
 
-    if (currentCharucoCorners.total() > 0)
+    if (shown.charuco_corners.total() > 0)
         cv::aruco::drawDetectedCornersCharuco(
-            imageCopy, currentCharucoCorners, currentCharucoIds
+            imageCopy, shown.charuco_corners, shown.charuco_ids
         );
 
     cv::putText(
@@ -217,31 +218,307 @@ void IntrinsicCalibrationCharuco::CameraImageCallback(
             0, 0
         ), 2
     );
+    DrawCalibrationState(imageCopy);
 
     cv::imshow("Intrinsic calibration", imageCopy);
     char key = (char) cv::waitKey(1);
     if (key == 'f')
         finished_capturing = true;
 
+    // skip the frame if the detection threads are all busy, unless the user
+    // asked for it
+    const bool requested = key == 'c';
+    {
+        boost::lock_guard<boost::mutex> lock(detection_mutex);
+        if(!requested && busy_detection_threads + (int)detection_jobs.size()
+                         >= n_detection_threads)
+            return;
+    }
+    cv::Mat gray;
+    cv::cvtColor(image, gray, cv::COLOR_BGR2GRAY);
+    {
+        boost::lock_guard<boost::mutex> lock(detection_mutex);
+        detection_jobs.emplace_back(gray, requested);
+    }
+    detection_condition.notify_one();
+}
+
+
+//------------------------------------------------------------------------------
+IntrinsicCalibrationCharuco::Detection
+IntrinsicCalibrationCharuco::DetectBoard(const cv::Mat &gray,
+                                         const bool requested) const {
+
+    Detection detection;
+    detection.requested = requested;
+
+    // detect markers
+    cv::aruco::detectMarkers(gray, dictionary, detection.marker_corners,
+                             detection.marker_ids, detector_params);
+
+    // interpolate charuco corners
+    if (detection.marker_ids.size() > 0)
+        cv::aruco::interpolateCornersCharuco(
+                detection.marker_corners, detection.marker_ids, gray,
+                charuco_board, detection.charuco_corners,
+                detection.charuco_ids);
+    return detection;
+}
+
+
+//------------------------------------------------------------------------------
+void IntrinsicCalibrationCharuco::DetectionThread() {
+
+    try {
+        while (true) {
+
+            std::pair<cv::Mat, bool> job;
+            {
+                boost::unique_lock<boost::mutex> lock(detection_mutex);
+                while (detection_jobs.empty())
+                    detection_condition.wait(lock);
+                job = detection_jobs.front();
+                detection_jobs.pop_front();
+                busy_detection_threads++;
+            }
+
+            const Detection detection = DetectBoard(job.first, job.second);
+
+            {
+                boost::lock_guard<boost::mutex> lock(detection_mutex);
+                busy_detection_threads--;
+                last_detection = detection;
+                detections.push_back(detection);
+            }
+        }
+    } catch(const boost::thread_interrupted &) { }
+}
+
+
+//------------------------------------------------------------------------------
+void IntrinsicCalibrationCharuco::SolverThread() {
+
+    size_t solved_frames = 0;
+    CalibrationResult previous;
+
+    try {
+        while (true) {
+
+            std::vector< cv::Mat > corners, ids;
+            {
+                boost::unique_lock<boost::mutex> lock(solver_mutex);
+                while (allCharucoCorners.size() == solved_frames
+                       || allCharucoCorners.size() < 4)
+                    solver_condition.wait(lock);
+                // shallow copies, the kept frames are never modified
+                corners = allCharucoCorners;
+                ids = allCharucoIds;
+            }
+            solved_frames = corners.size();
+
+            // start from the previous solution, which is close once a few
+            // frames are in
+            CalibrationResult result;
+            result.n_frames = (int)corners.size();
+            int flags = 0;
+            if(!previous.camera_matrix.empty()) {
+                previous.camera_matrix.copyTo(result.camera_matrix);
+                previous.dist_coeffs.copyTo(result.dist_coeffs);
+                flags |= cv::CALIB_USE_INTRINSIC_GUESS;
+            }
+            try {
+                result.rep_error = cv::aruco::calibrateCameraCharuco(
+                        corners, ids, charuco_board, imgSize,
+                        result.camera_matrix, result.dist_coeffs,
+                        cv::noArray(), cv::noArray(),
+                        result.std_dev_intrinsics, cv::noArray(),
+                        cv::noArray(), flags);
+            }
+            catch (cv::Exception &e) {
+                // degenerate set of views, wait for more
+                continue;
+            }
+            previous = result;
+
+            {
+                boost::lock_guard<boost::mutex> lock(solver_mutex);
+                live_result = result;
+            }
+            boost::this_thread::interruption_point();
+        }
+    } catch(const boost::thread_interrupted &) { }
+}
+
+
+//------------------------------------------------------------------------------
+void IntrinsicCalibrationCharuco::StopThreads() {
+
+    if(!threads_running)
+        return;
+    threads_running = false;
+
+    detection_threads.interrupt_all();
+    detection_threads.join_all();
+    solver_thread.interrupt();
+    solver_thread.join();
+
+    // the user expects the frames asked with 'c' to be used
+    std::deque< std::pair<cv::Mat, bool> > jobs;
+    {
+        boost::lock_guard<boost::mutex> lock(detection_mutex);
+        jobs.swap(detection_jobs);
+    }
+    for (const auto &job : jobs) {
+        if(!job.second)
+            continue;
+        const Detection detection = DetectBoard(job.first, true);
+        boost::lock_guard<boost::mutex> lock(detection_mutex);
+        detections.push_back(detection);
+    }
+}
+
+
+//------------------------------------------------------------------------------
+void IntrinsicCalibrationCharuco::ProcessDetections() {
+
+    std::deque< Detection > new_detections;
+    {
+        boost::lock_guard<boost::mutex> lock(detection_mutex);
+        new_detections.swap(detections);
+    }
+
     cv::Size size;
     size = charuco_board->getChessboardSize();
+    const int num_markers = size.height * size.width / 2;
+    const int num_corners = (size.height - 1) * (size.width - 1);
+
+    for (const auto &detection : new_detections) {
+
+        cv::Vec<double, 5> descriptor;
+        const bool has_descriptor = GetFrameDescriptor(detection, descriptor);
+
+        bool keep = false;
+        if(detection.requested) {
+            //if 3/4 of the markers are captured
+            if (detection.marker_ids.size()
+                >= static_cast<size_t>(num_markers * 3 / 4)
+                && detection.marker_ids.size() > 6 && has_descriptor)
+                keep = true;
+            else
+                std::cout << "Not enough markers detected: "
+                          << detection.marker_ids.size() << std::endl;
+        }
+        else if(auto_capture && has_descriptor
+                && detection.charuco_corners.total()
+                   >= static_cast<size_t>(num_corners * 3 / 4)) {
+            double min_distance = std::numeric_limits<double>::max();
+            for (const auto &kept : frameDescriptors)
+                min_distance = std::min(min_distance,
+                                        cv::norm(descriptor - kept));
+            keep = min_distance > min_frame_diversity;
+        }
+
+        if(!keep)
+            continue;
+
+        frameDescriptors.push_back(descriptor);
+        {
+            boost::lock_guard<boost::mutex> lock(solver_mutex);
+            allCharucoCorners.push_back(detection.charuco_corners);
+            allCharucoIds.push_back(detection.charuco_ids);
+        }
+        solver_condition.notify_one();
 
-    if (key == 'c') {
-        int num_markers = size.height * size.width / 2;
-        if (ids.size() >= (num_markers*3/4) && ids.size() > 6) { //if 3/4 of the markers are captured
-            std::cout << "Frame " << allImgs.size() + 1 << " captured and found "
-                      << ids.size() << " markers" << std::endl;
-            allCorners.push_back(corners);
-            allIds.push_back(ids);
-            allImgs.push_back(image);
-            imgSize = image.size();
-        } else
-            std::cout << "Not enough markers detected: "
-                      << ids.size() << std::endl;
+        std::cout << "Frame " << allCharucoCorners.size()
+                  << (detection.requested ? " captured" : " auto captured")
+                  << " and found " << detection.charuco_corners.total()
+                  << " corners" << std::endl;
     }
 }
 
 
+//------------------------------------------------------------------------------
+bool IntrinsicCalibrationCharuco::GetFrameDescriptor(
+        const Detection &detection, cv::Vec<double, 5> &descriptor) {
+
+    if(detection.charuco_ids.total() < 4 || imgSize.area() == 0)
+        return false;
+
+    // homography from the board plane to the image
+    std::vector<cv::Point2f> board_points, image_points;
+    for (int i = 0; i < (int)detection.charuco_ids.total(); ++i) {
+        const cv::Point3f &p = charuco_board->chessboardCorners[
+                detection.charuco_ids.at<int>(i)];
+        board_points.emplace_back(p.x, p.y);
+        image_points.push_back(detection.charuco_corners.at<cv::Point2f>(i));
+    }
+    cv::Mat H = cv::findHomography(board_points, image_points);
+    if(H.empty())
+        return false;
+    H /= H.at<double>(2, 2);
+
+    const cv::Size size = charuco_board->getChessboardSize();
+    const float width = size.width * charuco_board->getSquareLength();
+    const float height = size.height * charuco_board->getSquareLength();
+    std::vector<cv::Point2f> outline = {{0.f, 0.f}, {width, 0.f},
+                                        {width, height}, {0.f, height}};
+    std::vector<cv::Point2f> projected;
+    cv::perspectiveTransform(outline, projected, H);
+
+    cv::Point2f center(0.f, 0.f);
+    for (const auto &p : projected)
+        center += 0.25f * p;
+
+    descriptor[0] = center.x / imgSize.width;
+    descriptor[1] = center.y / imgSize.height;
+    descriptor[2] = std::sqrt(std::abs(cv::contourArea(projected))
+                              / imgSize.area());
+    // relative change of depth across the board, i.e. its tilt
+    descriptor[3] = H.at<double>(2, 0) * width;
+    descriptor[4] = H.at<double>(2, 1) * height;
+    return true;
+}
+
+
+//------------------------------------------------------------------------------
+void IntrinsicCalibrationCharuco::DrawCalibrationState(cv::Mat &image) {
+
+    CalibrationResult result;
+    size_t n_frames;
+    {
+        boost::lock_guard<boost::mutex> lock(solver_mutex);
+        result = live_result;
+        n_frames = allCharucoCorners.size();
+    }
+
+    std::vector<std::string> lines;
+    char buf[256];
+    snprintf(buf, sizeof(buf), "Frames: %zu%s", n_frames,
+             auto_capture ? " (auto capture on)" : "");
+    lines.emplace_back(buf);
+
+    if(!result.camera_matrix.empty() && result.std_dev_intrinsics.total() >= 9) {
+        const cv::Mat &K = result.camera_matrix;
+        const double *s = result.std_dev_intrinsics.ptr<double>();
+        snprintf(buf, sizeof(buf), "Reprojection error: %.3f px (%d frames)",
+                 result.rep_error, result.n_frames);
+        lines.emplace_back(buf);
+        snprintf(buf, sizeof(buf), "fx %.1f+-%.2f  fy %.1f+-%.2f",
+                 K.at<double>(0, 0), s[0], K.at<double>(1, 1), s[1]);
+        lines.emplace_back(buf);
+        snprintf(buf, sizeof(buf), "cx %.1f+-%.2f  cy %.1f+-%.2f",
+                 K.at<double>(0, 2), s[2], K.at<double>(1, 2), s[3]);
+        lines.emplace_back(buf);
+        const double *d = result.dist_coeffs.ptr<double>();
+        snprintf(buf, sizeof(buf), "k1 %.3f+-%.3f  k2 %.3f+-%.3f  k3 %.3f+-%.3f",
+                 d[0], s[4], d[1], s[5], d[4], s[8]);
+        lines.emplace_back(buf);
+    }
+
+    for (size_t i = 0; i < lines.size(); ++i)
+        cv::putText(image, lines[i], cv::Point(10, 45 + 20 * (int)i),
+                    cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(0, 255, 0), 1);
+}
 
 
 bool IntrinsicCalibrationCharuco::saveCameraParams(
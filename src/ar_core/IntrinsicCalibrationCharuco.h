@@ -6,16 +6,39 @@
 #define ATAR_INTRINSICCALIBRATIONCHARUCO_H
 
 #include <iostream>
+#include <deque>
 #include <vector>
 #include <opencv2/aruco/charuco.hpp>
 #include <sensor_msgs/Image.h>
 #include <image_transport/image_transport.h>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
 
+/**
+ * \class IntrinsicCalibrationCharuco
+ * \brief Intrinsic calibration of a camera with a charuco board.
+ *
+ * The markers and charuco corners of the received frames are detected by a
+ * few worker threads, and only the corners and ids of the kept frames are
+ * stored, not the images. Frames are kept when 'c' is pressed or, with the
+ * auto_capture parameter (default true), when the board is seen from a
+ * position, distance or tilt that differs enough from the frames already
+ * kept (min_frame_diversity).
+ *
+ * While capturing, a background thread recalibrates each time frames are
+ * added, starting from the previous solution, and the window shows the
+ * current reprojection error and the standard deviation of each intrinsic
+ * parameter, so one can see when more frames stop helping. Pressing 'f'
+ * runs the final calibration, which drops the frames with an outlying
+ * reprojection error.
+ */
 class IntrinsicCalibrationCharuco {
 public:
     IntrinsicCalibrationCharuco(std::string &img_topic_namespace,
                                 std::vector<float> charuco_board_param);
 
+    ~IntrinsicCalibrationCharuco();
 
     bool DoCalibration(std::string outputFile,
                        double &repError,
@@ -25,6 +48,25 @@ public:
                              sensor_msgs::ImageConstPtr &msg);
 
 private:
+
+    struct Detection {
+        std::vector< std::vector< cv::Point2f > > marker_corners;
+        std::vector< int > marker_ids;
+        cv::Mat charuco_corners;
+        cv::Mat charuco_ids;
+        // 'c' was pressed on this frame
+        bool requested = false;
+    };
+
+    struct CalibrationResult {
+        int n_frames = 0;
+        double rep_error = 0.0;
+        cv::Mat camera_matrix;
+        cv::Mat dist_coeffs;
+        // fx, fy, cx, cy, k1, k2, p1, p2, k3, ...
+        cv::Mat std_dev_intrinsics;
+    };
+
     bool saveCameraParams(const std::string
                                  &filename, cv::Size imageSize, float
                                  aspectRatio, int flags,
@@ -32,19 +74,61 @@ private:
                                  &distCoeffs, double totalAvgErr);
     cv::Mat LockAndGetImage();
 
+    // Markers and charuco corners of a grayscale frame
+    Detection DetectBoard(const cv::Mat &gray, bool requested) const;
+
+    void DetectionThread();
+
+    void SolverThread();
+
+    // Interrupts and joins the detection and solver threads. The frames
+    // requested with 'c' that were still queued are detected here, the
+    // others are dropped.
+    void StopThreads();
+
+    // Keeps the new detections that were requested or are diverse enough
+    void ProcessDetections();
+
+    // [center x, center y, scale, tilt x, tilt y] of the board in the frame,
+    // all roughly in [0, 1]. False if the board pose can't be estimated.
+    bool GetFrameDescriptor(const Detection &detection,
+                            cv::Vec<double, 5> &descriptor);
+
+    void DrawCalibrationState(cv::Mat &image);
+
 private:
     cv::Ptr<cv::aruco::CharucoBoard> charuco_board;
     cv::Ptr<cv::aruco::Dictionary> dictionary;
     cv::Ptr<cv::aruco::DetectorParameters> detector_params;
     bool finished_capturing = false;
+    bool auto_capture = true;
+    double min_frame_diversity = 0.15;
 
-    std::vector< std::vector< std::vector< cv::Point2f > > > allCorners;
-    std::vector< std::vector< int > > allIds;
-    std::vector< cv::Mat > allImgs;
+    // kept frames
+    std::vector< cv::Mat > allCharucoCorners;
+    std::vector< cv::Mat > allCharucoIds;
+    std::vector< cv::Vec<double, 5> > frameDescriptors;
     cv::Size imgSize;
     std::string image_topic_name;
     cv::Mat image;
 
+    // detection workers
+    boost::thread_group         detection_threads;
+    boost::mutex                detection_mutex;
+    boost::condition_variable   detection_condition;
+    std::deque< std::pair<cv::Mat, bool> > detection_jobs;
+    std::deque< Detection >     detections;
+    Detection                   last_detection;
+    int                         n_detection_threads = 2;
+    int                         busy_detection_threads = 0;
+    bool                        threads_running = false;
+
+    // incremental calibration. allCharucoCorners and allCharucoIds are
+    // appended under solver_mutex
+    boost::thread               solver_thread;
+    boost::mutex                solver_mutex;
+    boost::condition_variable   solver_condition;
+    CalibrationResult           live_result;
 };
 
 
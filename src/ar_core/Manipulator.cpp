@@ -3,9 +3,11 @@
 //
 
 #include <kdl_conversions/kdl_msg.h>
+#include <algorithm>
 #include <custom_conversions/Conversions.h>
 #include "Manipulator.h"
 #include "ManipulatorToWorldCalibration.h"
+#include "HandEyeCalibration.h"
 #include <src/arm_to_world_calibration/ArmToWorldCalibration.h>
 
 Manipulator::Manipulator(
@@ -17,9 +19,10 @@ Manipulator::Manipulator(
         KDL::Frame initial_pose)
         :
         n(ros::NodeHandlePtr(new ros::NodeHandle("~"))),
-        pose_world(initial_pose),
         arm_name(arm_name)
 {
+    state.Modify([&initial_pose](ManipulatorState &s){
+        s.pose_world = initial_pose; });
 
     //--------------------------------------------------------------------------
     // Define subscribers
@@ -49,38 +52,63 @@ Manipulator::Manipulator(
             "/calibrations/world_frame_to_"+arm_name+"_frame";
     std::vector<double> vec_slave = std::vector<double>(7, 0.0);
 
+    ManipulatorCalibration calib;
     if (n->getParam(master_mode_param, vect_master)) {
-        conversions::QuatVectorToKDLRot(vect_master, local_to_image_frame_rot);
+        conversions::QuatVectorToKDLRot(vect_master,
+                                        calib.local_to_image_frame_rot);
         master_mode = true;
     }
     else if(n->getParam(slave_mode_param, vec_slave))
     {
-        conversions::PoseVectorToKDLFrame(vec_slave, local_to_world_frame_tr);
-        local_to_world_frame_tr = local_to_world_frame_tr.Inverse();
+        conversions::PoseVectorToKDLFrame(vec_slave,
+                                          calib.local_to_world_frame_tr);
+        calib.local_to_world_frame_tr = calib.local_to_world_frame_tr.Inverse();
         master_mode = false;
     }
     else
         ROS_WARN("Neither %s nor %s parameter was found. Manipulator may not "
                          "be correctly calibrated.",
                  master_mode_param.c_str(), slave_mode_param.c_str());
+    calibration.Store(calib);
+
+    //--------------------------------------------------------------------------
+    // pose prediction parameters
+    n->param<double>("pose_velocity_filter_alpha", velocity_filter_alpha,
+                     velocity_filter_alpha);
+    n->param<double>("pose_max_extrapolation_time", max_extrapolation_time,
+                     max_extrapolation_time);
 
 }
 
 // -----------------------------------------------------------------------------
 void Manipulator::PoseCallback(const geometry_msgs::PoseStampedConstPtr &msg) {
 
+    const ManipulatorCalibration calib = calibration.Load();
+    const ros::Time stamp = StampOrNow(msg->header.stamp);
+
+    KDL::Frame pose_local;
     tf::poseMsgToKDL(msg->pose, pose_local);
 
-    pose_image.p =  local_to_image_frame_rot * pose_local.p;
-    pose_image.M =  local_to_image_frame_rot * pose_local.M;
+    KDL::Frame pose_image;
+    pose_image.p =  calib.local_to_image_frame_rot * pose_local.p;
+    pose_image.M =  calib.local_to_image_frame_rot * pose_local.M;
 
-    pose_world =  local_to_world_frame_tr * pose_local;
+    KDL::Frame pose_world =  calib.local_to_world_frame_tr * pose_local;
 
+    state.Modify([&](ManipulatorState &s){
+        s.pose_stamp = stamp;
+        s.pose_local = pose_local;
+        s.pose_image = pose_image;
+        s.pose_world = pose_world;
+    });
+
+    PushPoseToHistory(stamp, pose_world);
 }
 
 // -----------------------------------------------------------------------------
 void Manipulator::GripperCallback(const std_msgs::Float32ConstPtr &msg) {
-    gripper_angle = msg->data;
+    const double angle = msg->data;
+    state.Modify([angle](ManipulatorState &s){ s.gripper_angle = angle; });
 }
 
 
@@ -88,16 +116,138 @@ void Manipulator::GripperCallback(const std_msgs::Float32ConstPtr &msg) {
 void Manipulator::TwistCallback(const geometry_msgs::TwistStampedConstPtr
                                 &msg) {
 
+    const ManipulatorCalibration calib = calibration.Load();
+
+    KDL::Twist twist_local;
     tf::twistMsgToKDL(msg->twist, twist_local);
-    twist_world = local_to_world_frame_tr * twist_local;
+    KDL::Twist twist_world = calib.local_to_world_frame_tr * twist_local;
+
+    state.Modify([&](ManipulatorState &s){
+        s.twist_local = twist_local;
+        s.twist_world = twist_world;
+    });
+
+    // for prediction we need the velocity of the tool point expressed in
+    // the world frame, so only the orientation is changed.
+    boost::mutex::scoped_lock lock(history_mutex);
+    velocity_from_twist = calib.local_to_world_frame_tr.M * twist_local;
+    velocity_from_twist_stamp = ros::Time::now();
+}
+
+// -----------------------------------------------------------------------------
+void Manipulator::PushPoseToHistory(const ros::Time &stamp,
+                                    const KDL::Frame &pose) {
+
+    boost::mutex::scoped_lock lock(history_mutex);
+
+    if(history_count > 0) {
+        const StampedPose &last = history[history_head];
+        double dt = (stamp - last.stamp).toSec();
+
+        // ignore out of order or duplicate messages
+        if(dt <= 1e-6)
+            return;
+
+        KDL::Twist instant_velocity = KDL::diff(last.pose, pose, dt);
+        velocity_estimated = velocity_filter_alpha * instant_velocity
+                             + (1 - velocity_filter_alpha) * velocity_estimated;
+    }
+
+    history_head = (history_head + 1) % MANIPULATOR_HISTORY_SIZE;
+    history[history_head].stamp = stamp;
+    history[history_head].pose = pose;
+    if(history_count < MANIPULATOR_HISTORY_SIZE)
+        history_count++;
+}
+
+// -----------------------------------------------------------------------------
+KDL::Frame Manipulator::GetPoseWorldAt(const ros::Time &time) {
+
+    boost::mutex::scoped_lock lock(history_mutex);
+
+    if(history_count == 0)
+        return state.Load().pose_world;
+
+    const StampedPose &last = history[history_head];
+
+    // Extrapolate with constant velocity. The twist of the device is used
+    // if it is being received, otherwise the estimated one.
+    if(time >= last.stamp) {
+        double dt = std::min((time - last.stamp).toSec(),
+                             max_extrapolation_time);
+
+        bool twist_is_recent = !velocity_from_twist_stamp.isZero() &&
+                (ros::Time::now() - velocity_from_twist_stamp).toSec() < 0.1;
+
+        if(twist_is_recent)
+            return KDL::addDelta(last.pose, velocity_from_twist, dt);
+        return KDL::addDelta(last.pose, velocity_estimated, dt);
+    }
+
+    // Interpolate between the two samples around the requested time
+    for (int i = 1; i < history_count; ++i) {
+        int older_idx = (history_head - i + MANIPULATOR_HISTORY_SIZE)
+                        % MANIPULATOR_HISTORY_SIZE;
+        const StampedPose &older = history[older_idx];
+
+        if(older.stamp <= time) {
+            const StampedPose &newer =
+                    history[(older_idx + 1) % MANIPULATOR_HISTORY_SIZE];
+            double span = (newer.stamp - older.stamp).toSec();
+            double s = (time - older.stamp).toSec() / span;
+            return KDL::addDelta(older.pose,
+                                 KDL::diff(older.pose, newer.pose), s);
+        }
+    }
+
+    // requested time is older than the history. Return the oldest we have.
+    return history[(history_head - history_count + 1 +
+                    MANIPULATOR_HISTORY_SIZE) % MANIPULATOR_HISTORY_SIZE].pose;
+}
+
+// -----------------------------------------------------------------------------
+bool Manipulator::GetPoseLocalAt(const ros::Time &time, KDL::Frame &pose) {
+
+    {
+        boost::mutex::scoped_lock lock(history_mutex);
+        if(history_count < 2)
+            return false;
+        const ros::Time &oldest = history[(history_head - history_count + 1 +
+                MANIPULATOR_HISTORY_SIZE) % MANIPULATOR_HISTORY_SIZE].stamp;
+        if(time < oldest || time > history[history_head].stamp)
+            return false;
+    }
+
+    // the history is kept in the world frame
+    pose = calibration.Load().local_to_world_frame_tr.Inverse()
+           * GetPoseWorldAt(time);
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+ros::Time Manipulator::GetLastPoseStamp() {
+    boost::mutex::scoped_lock lock(history_mutex);
+    if(history_count == 0)
+        return ros::Time(0);
+    return history[history_head].stamp;
+}
+
+// -----------------------------------------------------------------------------
+ros::Time Manipulator::StampOrNow(const ros::Time &stamp) {
+    // some of the dummy publishers do not fill the header
+    if(stamp.isZero())
+        return ros::Time::now();
+    return stamp;
 }
 
 // -----------------------------------------------------------------------------
 void Manipulator::SetWorldToCamTr(const KDL::Frame &in) {
     if(master_mode) {
-        camera_to_world_frame_tr = in.Inverse();
-        local_to_world_frame_tr.M = camera_to_world_frame_tr.M *
-                                    local_to_image_frame_rot;
+        KDL::Frame camera_to_world_frame_tr = in.Inverse();
+        calibration.Modify([&](ManipulatorCalibration &c){
+            c.local_to_world_frame_tr.M = camera_to_world_frame_tr.M *
+                                          c.local_to_image_frame_rot;
+        });
     } else
         ROS_WARN_ONCE("SetWorldToCamTr is needed when manipulator is in master"
                               " mode.");
@@ -122,9 +272,21 @@ void Manipulator::DoArmToWorldFrameCalibration() {
 
 void Manipulator::CalibrationThread(){
 
-    ManipulatorToWorldCalibration cal(this);
+    std::string method;
+    n->param<std::string>("arm_calibration_method", method, "touch_points");
+
     KDL::Frame world_to_local_tr;
-    if(cal.DoCalibration(world_to_local_tr)){
+    bool calibrated;
+    if(method == "hand_eye") {
+        HandEyeCalibration cal(this);
+        calibrated = cal.DoCalibration(world_to_local_tr);
+    }
+    else {
+        ManipulatorToWorldCalibration cal(this);
+        calibrated = cal.DoCalibration(world_to_local_tr);
+    }
+
+    if(calibrated){
 
         // set ros param
         std::string param =
@@ -135,7 +297,10 @@ void Manipulator::CalibrationThread(){
         n->setParam(param, vec7);
 
         // set output
-        local_to_world_frame_tr = world_to_local_tr.Inverse();
+        KDL::Frame local_to_world_frame_tr = world_to_local_tr.Inverse();
+        calibration.Modify([&](ManipulatorCalibration &c){
+            c.local_to_world_frame_tr = local_to_world_frame_tr;
+        });
     }
 
     // not really needed..
@@ -144,19 +309,29 @@ void Manipulator::CalibrationThread(){
 
 }
 
-void Manipulator::PedalsCallback(const sensor_msgs::Joy &msg) {
+void Manipulator::PedalsCallback(const sensor_msgs::JoyConstPtr &msg) {
 
-    for (int i = 0; i < msg.buttons.size(); ++i) {
-        pedals[i] = msg.buttons[i];
-    }
+    const int n_buttons = std::min((int)msg->buttons.size(),
+                                   MANIPULATOR_MAX_BUTTONS);
+    if(msg->buttons.size() > MANIPULATOR_MAX_BUTTONS)
+        ROS_WARN_ONCE("Received %lu buttons, only the first %d are read.",
+                      msg->buttons.size(), MANIPULATOR_MAX_BUTTONS);
+
+    state.Modify([&](ManipulatorState &s){
+        for (int i = 0; i < n_buttons; ++i)
+            s.buttons[i] = msg->buttons[i];
+        s.n_buttons = n_buttons;
+    });
 
 }
 
-void Manipulator::GetButtons(int *pdls) {
+int Manipulator::GetButtons(int pdls[], const int max_n) {
 
-    for (int i = 0; i < sizeof(pdls)/sizeof(pdls[0]); ++i) {
-        pdls[i] = pedals[i];
-    }
+    const ManipulatorState s = state.Load();
+
+    for (int i = 0; i < max_n; ++i)
+        pdls[i] = (i < s.n_buttons) ? s.buttons[i] : 0;
 
+    return s.n_buttons;
 }
 
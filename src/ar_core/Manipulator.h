@@ -38,10 +38,30 @@
 // to SetWorldToCamTrfrom outside like in the VR case. After the calibration
 // a ros parameter is set called:
 //             "/calibrations/world_frame_to_"+arm_name+"_frame";
+// With the arm_calibration_method parameter set to "hand_eye" the points are
+// not touched: the charuco board is held by the tool and the arm is moved
+// around in front of the camera instead (see HandEyeCalibration).
 // you can set this parameter in the params_calibrations_ar.yaml so that you
 // don't have to repeat the calibration as long as the base of the robot does
 // not move with respect to the world (board) coordinate.
-
+//
+// POSE PREDICTION: The poses received in the pose callback are also saved
+// with their header stamps in a short history. GetPoseWorldAt can then be
+// used to get the pose at a given time: inside the history the pose is
+// interpolated, after the last sample it is extrapolated with a constant
+// velocity model. The velocity is taken from the twist topic if there is
+// one, otherwise it is estimated from the received poses and low-pass
+// filtered. This is useful for rendering, where the tool overlays can be
+// drawn at the pose the tool will have when the frame is displayed (check
+// Rendering::GetExpectedDisplayTime).
+//
+// THREADS: The callbacks run at the device rate (500-1000Hz) in whichever
+// thread spins ros, and the getters are called from both the graphics and
+// the haptics threads. The latest state of the device (poses, twists,
+// gripper and pedals) is therefore kept in a fixed size ManipulatorState
+// held in a SeqLock: callbacks do not allocate and readers get a
+// consistent snapshot without locking. Use GetState if more than one field
+// is needed so that they all belong to the same instant.
 
 
 #include <ros/ros.h>
@@ -51,6 +71,34 @@
 #include <std_msgs/Float32.h>
 #include <geometry_msgs/TwistStamped.h>
 #include <sensor_msgs/Joy.h>
+#include <boost/thread/mutex.hpp>
+#include "SeqLock.h"
+
+// number of poses kept in the history used for interpolation/extrapolation.
+// At 1kHz this covers the worst camera latencies we have seen (~250ms).
+#define MANIPULATOR_HISTORY_SIZE 256
+
+// maximum number of pedals/buttons that are read from the Joy message
+#define MANIPULATOR_MAX_BUTTONS 8
+
+// Snapshot of the inputs received from the device
+struct ManipulatorState {
+    ros::Time   pose_stamp;
+    KDL::Frame  pose_local;
+    KDL::Frame  pose_image;
+    KDL::Frame  pose_world;
+    KDL::Twist  twist_local;
+    KDL::Twist  twist_world;
+    double      gripper_angle = 0.0;
+    int         n_buttons = 0;
+    int         buttons[MANIPULATOR_MAX_BUTTONS] = {};
+};
+
+// Transformations set by calibration or by the camera pose
+struct ManipulatorCalibration {
+    KDL::Frame      local_to_world_frame_tr;
+    KDL::Rotation   local_to_image_frame_rot;
+};
 
 class Manipulator {
 
@@ -68,54 +116,89 @@ public:
 
     void TwistCallback(const geometry_msgs::TwistStampedConstPtr &msg);
 
-    void PedalsCallback(const sensor_msgs::Joy &msg);
+    void PedalsCallback(const sensor_msgs::JoyConstPtr &msg);
 
-    void GetPoseLocal(KDL::Frame& pose){pose = pose_local;};
+    // consistent snapshot of all the inputs
+    ManipulatorState GetState(){return state.Load();};
 
-    void GetPoseWorld(KDL::Frame& pose){pose = pose_world;};
+    void GetPoseLocal(KDL::Frame& pose){pose = state.Load().pose_local;};
 
-    KDL::Frame GetPoseWorld(){return pose_world;};
+    void GetPoseWorld(KDL::Frame& pose){pose = state.Load().pose_world;};
 
-    KDL::Frame GetPoseImage(){return pose_image;};
+    KDL::Frame GetPoseWorld(){return state.Load().pose_world;};
 
-    void GetGripper(double& gripper){gripper = gripper_angle;};
+    // Returns the pose in the world frame at the given time. Interpolates
+    // inside the history and extrapolates beyond the last received pose
+    // (extrapolation horizon is limited to max_extrapolation_time).
+    KDL::Frame GetPoseWorldAt(const ros::Time &time);
 
-    double GetGripperAngles(){return gripper_angle;};
+    // Pose in the local frame at the given time, interpolated in the
+    // history. False if the time is not covered by the history.
+    bool GetPoseLocalAt(const ros::Time &time, KDL::Frame &pose);
 
-    void GetTwistLocal(KDL::Twist& twist){twist = twist_local;};
+    // stamp of the most recent pose in the history (zero if none received)
+    ros::Time GetLastPoseStamp();
 
-    void GetTwistWorld(KDL::Twist& twist){twist = twist_world;};
+    KDL::Frame GetPoseImage(){return state.Load().pose_image;};
 
-    void GetButtons(int pdls[]);
+    void GetGripper(double& gripper){gripper = state.Load().gripper_angle;};
+
+    double GetGripperAngles(){return state.Load().gripper_angle;};
+
+    void GetTwistLocal(KDL::Twist& twist){twist = state.Load().twist_local;};
+
+    void GetTwistWorld(KDL::Twist& twist){twist = state.Load().twist_world;};
+
+    // Copies at most max_n button states into pdls. Buttons that have not
+    // been received are set to 0. Returns the number of received buttons.
+    int GetButtons(int pdls[], int max_n);
 
     void DoArmToWorldFrameCalibration();
 
     void SetWorldToCamTr(const KDL::Frame &in);  // needed for AR
 
-    KDL::Frame GetWorldToLocalTr(){return local_to_world_frame_tr.Inverse();};
+    KDL::Frame GetWorldToLocalTr(){
+        return calibration.Load().local_to_world_frame_tr.Inverse();};
 
 
 private:
     void CalibrationThread();
 
+    // saves the last world pose and updates the estimated velocity
+    void PushPoseToHistory(const ros::Time &stamp, const KDL::Frame &pose);
+
+    // returns the stamp of the message or now if the stamp is not filled
+    ros::Time StampOrNow(const ros::Time &stamp);
+
 private:
     std::string arm_name;
-    bool master_mode;
+    bool master_mode = false;
     ros::NodeHandlePtr n; // made it a member just for the calibration thread
 
     boost::thread calibration_thread;
 
-    KDL::Frame pose_local;
-    KDL::Frame pose_image;
-    KDL::Frame pose_world;
-    KDL::Frame local_to_world_frame_tr;
-    KDL::Frame camera_to_world_frame_tr;  //i.e. camera to world
-    KDL::Rotation local_to_image_frame_rot;
-
-    KDL::Twist twist_local;
-    KDL::Twist twist_world;
-    double gripper_angle;
-    int pedals[];
+    SeqLock<ManipulatorState>       state;
+    SeqLock<ManipulatorCalibration> calibration;
+
+    // pose history (circular buffer) and estimated velocities used for
+    // prediction. Protected by history_mutex since the callbacks and the
+    // readers may run in different threads.
+    struct StampedPose {
+        ros::Time   stamp;
+        KDL::Frame  pose;
+    };
+    StampedPose history[MANIPULATOR_HISTORY_SIZE];
+    int         history_head = 0;  // index of the most recent sample
+    int         history_count = 0;
+    KDL::Twist  velocity_estimated;     // from pose differences (filtered)
+    KDL::Twist  velocity_from_twist;    // from the twist topic
+    ros::Time   velocity_from_twist_stamp;
+    boost::mutex history_mutex;
+
+    // smoothing factor of the velocity low-pass filter (0: no update, 1:
+    // no filtering)
+    double velocity_filter_alpha = 0.3;
+    double max_extrapolation_time = 0.1;
 
     ros::Subscriber sub_pose;
     ros::Subscriber sub_gripper;
@@ -5,6 +5,8 @@
 #include <image_transport/image_transport.h>
 #include <custom_conversions/Conversions.h>
 #include "ManipulatorToWorldCalibration.h"
+#include <kdl/frames_io.hpp>
+#include <iomanip>
 
 ManipulatorToWorldCalibration::ManipulatorToWorldCalibration(
         Manipulator *manip)
@@ -54,6 +56,9 @@ ManipulatorToWorldCalibration::ManipulatorToWorldCalibration(
                          (-1 + double(i%rows)) * calib_points_distance,
                         0.0) );
     }
+    registration.reset(new RobustRigidRegistration(
+            calib_points_in_world_frame,
+            RobustRigidRegistration::ReadParams(n)));
 
 }
 
@@ -68,8 +73,10 @@ void ManipulatorToWorldCalibration::PutDrawings(cv::Mat img
 
     if(!calibration_done) {
 
+        // the estimation is asynchronous, use the last pose if none is new
         KDL::Frame temp;
-        ar_camera->GetNewWorldToCamTr(temp);
+        if(!ar_camera->GetNewWorldToCamTr(temp))
+            temp = ar_camera->GetWorldToCamTr();
         conversions::KDLFrameToRvectvec(temp,
                                         cam_rvec,
                                         cam_tvec);
@@ -94,12 +101,44 @@ void ManipulatorToWorldCalibration::PutDrawings(cv::Mat img
         }
 
         // draw the current target with a different colou
-        cv::circle(img, calib_points_screen[calib_points_in_arm_frame.size()],
-                   6, cv::Scalar(0, 0, 255), 2, CV_AA);
+        const int target = registration->GetCurrentTarget();
+        if(target >= 0)
+            cv::circle(img, calib_points_screen[target],
+                       6, cv::Scalar(0, 0, 255), 2, CV_AA);
+
+        // residuals of the last solution, in mm. Red for the outliers.
+        if(registration->HasSolution())
+            for (uint i = 0; i < calib_points_in_world_frame.size(); i++) {
+                const double residual = registration->GetResiduals()[i];
+                if(residual < 0)
+                    continue;
+                std::stringstream residual_msg;
+                residual_msg << std::setprecision(2) << residual * 1000.0;
+                cv::putText(img, residual_msg.str(),
+                            calib_points_screen[i] + cv::Point2d(8, -8),
+                            cv::FONT_HERSHEY_SIMPLEX, 0.4,
+                            registration->GetInliers()[i] ?
+                            cv::Scalar(0, 255, 0) : cv::Scalar(0, 0, 255), 1);
+            }
         // --------------------------------------------------------------------
 
-        instructions = "Point at the red point with the tooltip, then press "
-                "'c'. Press 'Esc' to exit";
+        if(registration->IsSampling()) {
+            std::stringstream sampling_msg;
+            sampling_msg << "Hold the tool still on the red point: "
+                         << registration->GetNumSamples() << " samples, spread "
+                         << std::setprecision(2)
+                         << registration->GetSampleStd() * 1000.0 << " mm";
+            instructions = sampling_msg.str();
+        }
+        else
+            instructions = "Point at the red point with the tooltip, then "
+                    "press 'c'. Press 'Esc' to exit";
+
+        if(registration->HasSolution())
+            cv::putText(img, "Press 'a' to accept the calibration without "
+                                "the red points", cv::Point(10, 60),
+                        cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(255, 50, 0),
+                        2);
 
 
         std::stringstream tool_pos_msg;
@@ -180,14 +219,23 @@ bool ManipulatorToWorldCalibration::DoCalibration(KDL::Frame & result) {
     bool calibration_done = false;
     cv::Mat image;
     ros::Rate rate(30);
+    // stamp of the last pose given to the registration
+    ros::Time last_sample_stamp;
 
     while(ros::ok() && !exit) {
 
-        cv::cvtColor(ar_camera->GetImage(), image, cv::COLOR_RGB2BGR);
+        // no frame yet, e.g. the first compressed one is still decoding
+        const cv::Mat camera_image = ar_camera->GetImage();
+        if(camera_image.empty()) {
+            ros::spinOnce();
+            rate.sleep();
+            continue;
+        }
+        cv::cvtColor(camera_image, image, cv::COLOR_RGB2BGR);
 
         // get the manipulator pose
-        KDL::Frame manip_pose_loc;
-        manipulator->GetPoseLocal(manip_pose_loc);
+        const ManipulatorState manip_state = manipulator->GetState();
+        const KDL::Frame &manip_pose_loc = manip_state.pose_local;
 
         PutDrawings(image, calibration_done, manip_pose_loc);
 
@@ -198,22 +246,22 @@ bool ManipulatorToWorldCalibration::DoCalibration(KDL::Frame & result) {
 
         if (key == 27)
             exit = true;
-        if (key == 'c' && !calibration_done) {
-
-            // save the position of the end effector
-            calib_points_in_arm_frame.emplace_back(
-                    manip_pose_loc.p[0],
-                    manip_pose_loc.p[1],
-                    manip_pose_loc.p[2]);
-
-            if (calib_points_in_arm_frame.size() ==
-                calib_points_in_world_frame.size()) {
-
-                world_to_arm_tr = CalculateTransformation
-                        (calib_points_in_world_frame,
-                         calib_points_in_arm_frame);
-                calibration_done = true;
-            }
+        // start sampling the current point, or start over if the tool moved
+        if (key == 'c' && !calibration_done)
+            registration->StartSampling();
+        // accept the last solution without its outliers
+        if (key == 'a' && !calibration_done && registration->HasSolution())
+            calibration_done = true;
+
+        // the loop is slower than the poses, but a pose that has not been
+        // updated must not be sampled twice or a tool that stopped
+        // publishing would look still
+        if(!calibration_done && manip_state.pose_stamp != last_sample_stamp) {
+            last_sample_stamp = manip_state.pose_stamp;
+            if(registration->AddSample(Eigen::Vector3d(manip_pose_loc.p[0],
+                                                       manip_pose_loc.p[1],
+                                                       manip_pose_loc.p[2])))
+                calibration_done = OnPointMeasured();
         }
 
         ros::spinOnce();
@@ -233,36 +281,29 @@ bool ManipulatorToWorldCalibration::DoCalibration(KDL::Frame & result) {
 
 // -----------------------------------------------------------------------------
 //
-KDL::Frame ManipulatorToWorldCalibration::CalculateTransformation(
-        std::vector<Eigen::Vector3d> points_in_frame_1,
-        std::vector<Eigen::Vector3d> points_in_frame_2) {
-
-    if( points_in_frame_1.size()!= points_in_frame_2.size())
-        throw std::runtime_error("Num of points don't match.");
-
-    // points_in_frame_2_mat: measured=arm
-    Eigen::Matrix<double, 3, 6> points_in_frame_2_mat;
-    Eigen::Matrix<double, 3, 6> points_in_frame_1_mat;
-
-    for (uint i = 0; i < points_in_frame_1.size(); i++) {
-        points_in_frame_1_mat.col(i) = points_in_frame_1[i];
-        points_in_frame_2_mat.col(i) = points_in_frame_2[i];
+bool ManipulatorToWorldCalibration::OnPointMeasured() {
+
+    if(!registration->AllMeasured())
+        return false;
+
+    if(registration->Solve()) {
+        world_to_arm_tr = registration->GetTransform();
+        ROS_INFO_STREAM(std::string("-- World To PSM Transformation Calculated: \n")
+                                << world_to_arm_tr << std::endl);
+        registration->PrintReport();
+        if(registration->GetNumOutliers() == 0)
+            return true;
+        ROS_WARN("%zu calibration point(s) are outliers. Touch them again, or "
+                         "press 'a' to accept the calibration without them.",
+                 registration->GetNumOutliers());
+        registration->ResampleOutliers();
     }
-
-    auto temp = Eigen::umeyama(points_in_frame_1_mat, points_in_frame_2_mat, 0);
-
-    KDL::Frame task_frame_to_robot_frame;
-    // converting Eigen::Matrix into KDL::Frame
-    cv::Matx33d rot_mat;
-    for (uint i = 0; i < 3; i++) {
-        rot_mat(i, 0) = temp(i, 0);
-        rot_mat(i, 1) = temp(i, 1);
-        rot_mat(i, 2) = temp(i, 2);
-        task_frame_to_robot_frame.p[i] = temp(i, 3);
+    else {
+        // keep the measurements, a new one might give the consensus
+        registration->RemeasureNext();
+        ROS_WARN("The calibration points are not consistent, touch the "
+                         "red point (%d) again.",
+                 registration->GetCurrentTarget());
     }
-    conversions::Matx33dToKdlRot(rot_mat, task_frame_to_robot_frame.M);
-    ROS_INFO_STREAM(std::string("-- World To PSM Transformation Calculated: \n")
-                            << temp << std::endl);
-
-    return task_frame_to_robot_frame;
-}
\ No newline at end of file
+    return false;
+}
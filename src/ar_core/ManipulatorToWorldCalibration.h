@@ -6,10 +6,12 @@
 #define ATAR_MANIPULATORTOWORLDCALIBRATION_H
 
 
+#include <memory>
 #include <opencv2/opencv.hpp>
 #include <Eigen/Dense>
 #include "Manipulator.h"
 #include "AugmentedCamera.h"
+#include "src/arm_to_world_calibration/RobustRigidRegistration.h"
 
 class ManipulatorToWorldCalibration {
 public:
@@ -28,9 +30,11 @@ public:
             const cv::Vec3d &rvec, const cv::Vec3d &tvec,
             float length);
 
-    KDL::Frame CalculateTransformation(
-            std::vector<Eigen::Vector3d> points_in_frame_1,
-            std::vector<Eigen::Vector3d> points_in_frame_2);
+private:
+
+    // Solves once all the points are measured, returns true if the
+    // calibration is done. The outliers are to be touched again.
+    bool OnPointMeasured();
 
 private:
     AugmentedCamera * ar_camera;
@@ -38,7 +42,7 @@ private:
     image_transport::ImageTransport *it;
 
     std::vector< Eigen::Vector3d> calib_points_in_world_frame;
-    std::vector< Eigen::Vector3d> calib_points_in_arm_frame;
+    std::unique_ptr<RobustRigidRegistration> registration;
 
     KDL::Frame world_to_arm_tr;
 
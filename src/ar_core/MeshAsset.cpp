@@ -0,0 +1,345 @@
+//
+// Created by charm on 19/10/26.
+//
+
+#include "MeshAsset.h"
+#include "LoadObjGL/tiny_obj_loader.h"
+#include "LoadObjGL/VHACDGen.h"
+#include <BulletCollision/CollisionShapes/btConvexHullShape.h>
+#include <vtkFloatArray.h>
+#include <vtkIdTypeArray.h>
+#include <vtkPoints.h>
+#include <vtkCellArray.h>
+#include <vtkPointData.h>
+#include <vtkQuadricDecimation.h>
+#include <vtkPolyDataNormals.h>
+#include <ros/ros.h>
+#include <sys/stat.h>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <algorithm>
+
+
+namespace {
+
+// One file of the cache. Its mutex is held while the file is parsed, so a
+// thread asking for a file being loaded waits for it while the other files
+// can be loaded in parallel.
+struct CacheEntry {
+    std::mutex                          mutex;
+    std::shared_ptr<const MeshAsset>    asset;
+};
+
+typedef std::map<std::string, std::shared_ptr<CacheEntry> > Cache;
+
+// guards the maps only, not the loading
+std::mutex  cache_mutex;
+Cache       mesh_cache;
+Cache       decomposed_cache;
+
+// Returns the asset of key in cache, calling make the first time. If make
+// throws the entry stays empty and the next call tries again.
+template <typename Make>
+std::shared_ptr<const MeshAsset> GetCached(Cache &cache,
+                                           const std::string &key,
+                                           Make make) {
+    std::shared_ptr<CacheEntry> entry;
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        std::shared_ptr<CacheEntry> &cached = cache[key];
+        if(!cached)
+            cached = std::make_shared<CacheEntry>();
+        entry = cached;
+    }
+
+    std::lock_guard<std::mutex> lock(entry->mutex);
+    if(!entry->asset)
+        entry->asset = make();
+    return entry->asset;
+}
+
+} // namespace
+
+// -----------------------------------------------------------------------------
+std::shared_ptr<const MeshAsset> MeshAsset::Load(const std::string &file_name) {
+
+    return GetCached(mesh_cache, file_name, [&file_name]() {
+        return std::shared_ptr<const MeshAsset>(new MeshAsset(file_name));
+    });
+}
+
+// -----------------------------------------------------------------------------
+std::shared_ptr<const MeshAsset> MeshAsset::LoadDecomposed(
+        const std::string &file_name) {
+
+    // the entry of file_name also makes sure that only one thread generates
+    // its decomposition
+    return GetCached(decomposed_cache, file_name, [&file_name]() {
+        std::string hacd_file_name = AddHACDToName(file_name);
+
+        // If there is no file with the same name ending with _hacd we need
+        // to decompose the mesh
+        struct stat buffer;
+        if(stat(hacd_file_name.c_str(), &buffer) != 0)
+            if(DecomposeObj(file_name) < 0)
+                throw std::runtime_error("Could not decompose mesh "
+                                         + file_name);
+
+        return Load(hacd_file_name);
+    });
+}
+
+// -----------------------------------------------------------------------------
+MeshAsset::MeshAsset(const std::string &file_name) {
+
+    std::vector<tinyobj::shape_t> shapes;
+    std::string err = tinyobj::LoadObj(shapes, file_name.c_str(), "");
+    if(!err.empty()) {
+        ROS_ERROR("Error reading mesh file %s: %s", file_name.c_str(),
+                  err.c_str());
+        throw std::runtime_error("Can't read mesh file.");
+    }
+
+    // merge the shapes in one buffer. Normals and texture coordinates are
+    // kept only if all the shapes have them.
+    bool with_normals = true;
+    bool with_texture_coords = true;
+    size_t n_vertices = 0, n_indices = 0;
+    for (const auto &shape : shapes) {
+        const size_t n = shape.mesh.positions.size() / 3;
+        n_vertices += n;
+        n_indices += shape.mesh.indices.size();
+        with_normals &= shape.mesh.normals.size() == 3 * n;
+        with_texture_coords &= shape.mesh.texcoords.size() == 2 * n;
+    }
+
+    vertices.reserve(3 * n_vertices);
+    triangles.reserve(4 * n_indices / 3);
+    if(with_normals)
+        normals.reserve(3 * n_vertices);
+    if(with_texture_coords)
+        texture_coords.reserve(2 * n_vertices);
+
+    for (const auto &shape : shapes) {
+        Part part;
+        part.first_vertex = vertices.size() / 3;
+        part.n_vertices = shape.mesh.positions.size() / 3;
+        part.first_triangle = triangles.size() / 4;
+        part.n_triangles = shape.mesh.indices.size() / 3;
+
+        vertices.insert(vertices.end(), shape.mesh.positions.begin(),
+                        shape.mesh.positions.end());
+        if(with_normals)
+            normals.insert(normals.end(), shape.mesh.normals.begin(),
+                           shape.mesh.normals.end());
+        if(with_texture_coords)
+            texture_coords.insert(texture_coords.end(),
+                                  shape.mesh.texcoords.begin(),
+                                  shape.mesh.texcoords.end());
+
+        for (size_t i = 0; i + 2 < shape.mesh.indices.size(); i += 3) {
+            triangles.push_back(3);
+            for (size_t j = 0; j < 3; ++j)
+                triangles.push_back(
+                        vtkIdType(part.first_vertex + shape.mesh.indices[i + j]));
+        }
+        parts.push_back(part);
+    }
+
+    if(triangles.empty()) {
+        ROS_ERROR("Mesh file %s has no triangles.", file_name.c_str());
+        throw std::runtime_error("Mesh file has no triangles.");
+    }
+
+    ComputeMassProperties();
+    BuildPolyData();
+
+    ROS_DEBUG("Loaded mesh %s: %lu vertices, %lu triangles, %lu parts, "
+                      "volume = %f", file_name.c_str(), GetNumberOfVertices(),
+              GetNumberOfTriangles(), GetNumberOfParts(), volume);
+}
+
+// -----------------------------------------------------------------------------
+// Integrals of 1, x, y, z, x^2, y^2, z^2, xy, yz, zx over the volume,
+// computed from the triangles with the divergence theorem. See D. Eberly,
+// "Polyhedral Mass Properties (Revisited)".
+void MeshAsset::ComputeMassProperties() {
+
+    auto subexpressions = [](double w0, double w1, double w2,
+                             double &f1, double &f2, double &f3,
+                             double &g0, double &g1, double &g2) {
+        double temp0 = w0 + w1;
+        f1 = temp0 + w2;
+        double temp1 = w0 * w0;
+        double temp2 = temp1 + w1 * temp0;
+        f2 = temp2 + w2 * f1;
+        f3 = w0 * temp1 + w1 * temp2 + w2 * f2;
+        g0 = f2 + w0 * (f1 + w0);
+        g1 = f2 + w1 * (f1 + w1);
+        g2 = f2 + w2 * (f1 + w2);
+    };
+
+    double integral[10] = {};
+
+    for (size_t t = 0; t < triangles.size(); t += 4) {
+        const float *p0 = &vertices[3 * triangles[t + 1]];
+        const float *p1 = &vertices[3 * triangles[t + 2]];
+        const float *p2 = &vertices[3 * triangles[t + 3]];
+
+        double a1 = p1[0] - p0[0], b1 = p1[1] - p0[1], c1 = p1[2] - p0[2];
+        double a2 = p2[0] - p0[0], b2 = p2[1] - p0[1], c2 = p2[2] - p0[2];
+        double d0 = b1 * c2 - b2 * c1;
+        double d1 = a2 * c1 - a1 * c2;
+        double d2 = a1 * b2 - a2 * b1;
+
+        double f1x, f2x, f3x, g0x, g1x, g2x;
+        double f1y, f2y, f3y, g0y, g1y, g2y;
+        double f1z, f2z, f3z, g0z, g1z, g2z;
+        subexpressions(p0[0], p1[0], p2[0], f1x, f2x, f3x, g0x, g1x, g2x);
+        subexpressions(p0[1], p1[1], p2[1], f1y, f2y, f3y, g0y, g1y, g2y);
+        subexpressions(p0[2], p1[2], p2[2], f1z, f2z, f3z, g0z, g1z, g2z);
+
+        integral[0] += d0 * f1x;
+        integral[1] += d0 * f2x;
+        integral[2] += d1 * f2y;
+        integral[3] += d2 * f2z;
+        integral[4] += d0 * f3x;
+        integral[5] += d1 * f3y;
+        integral[6] += d2 * f3z;
+        integral[7] += d0 * (p0[1] * g0x + p1[1] * g1x + p2[1] * g2x);
+        integral[8] += d1 * (p0[2] * g0y + p1[2] * g1y + p2[2] * g2y);
+        integral[9] += d2 * (p0[0] * g0z + p1[0] * g1z + p2[0] * g2z);
+    }
+
+    const double mult[10] = {1. / 6., 1. / 24., 1. / 24., 1. / 24.,
+                             1. / 60., 1. / 60., 1. / 60.,
+                             1. / 120., 1. / 120., 1. / 120.};
+    // inward facing triangles give negative integrals
+    const double sign = integral[0] < 0.0 ? -1.0 : 1.0;
+    for (int i = 0; i < 10; ++i)
+        integral[i] *= sign * mult[i];
+
+    volume = integral[0];
+    if(volume > 0.0)
+        center_of_mass = KDL::Vector(integral[1], integral[2], integral[3])
+                         / volume;
+
+    inertia_diagonal = KDL::Vector(integral[5] + integral[6],
+                                   integral[4] + integral[6],
+                                   integral[4] + integral[5]);
+}
+
+// -----------------------------------------------------------------------------
+void MeshAsset::BuildPolyData() {
+
+    // The arrays point to the buffers of the asset (save = 1: VTK does not
+    // free them). The asset is cached and outlives them.
+    vtkSmartPointer<vtkFloatArray> point_array =
+            vtkSmartPointer<vtkFloatArray>::New();
+    point_array->SetNumberOfComponents(3);
+    point_array->SetArray(vertices.data(), vertices.size(), 1);
+
+    vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+    points->SetData(point_array);
+
+    vtkSmartPointer<vtkIdTypeArray> cell_array =
+            vtkSmartPointer<vtkIdTypeArray>::New();
+    cell_array->SetArray(triangles.data(), triangles.size(), 1);
+
+    vtkSmartPointer<vtkCellArray> polys = vtkSmartPointer<vtkCellArray>::New();
+    polys->SetCells(vtkIdType(GetNumberOfTriangles()), cell_array);
+
+    poly_data = vtkSmartPointer<vtkPolyData>::New();
+    poly_data->SetPoints(points);
+    poly_data->SetPolys(polys);
+
+    if(!normals.empty()) {
+        vtkSmartPointer<vtkFloatArray> normal_array =
+                vtkSmartPointer<vtkFloatArray>::New();
+        normal_array->SetNumberOfComponents(3);
+        normal_array->SetName("Normals");
+        normal_array->SetArray(normals.data(), normals.size(), 1);
+        poly_data->GetPointData()->SetNormals(normal_array);
+    }
+
+    if(!texture_coords.empty()) {
+        vtkSmartPointer<vtkFloatArray> tcoord_array =
+                vtkSmartPointer<vtkFloatArray>::New();
+        tcoord_array->SetNumberOfComponents(2);
+        tcoord_array->SetName("TextureCoordinates");
+        tcoord_array->SetArray(texture_coords.data(), texture_coords.size(), 1);
+        poly_data->GetPointData()->SetTCoords(tcoord_array);
+    }
+}
+
+// -----------------------------------------------------------------------------
+vtkSmartPointer<vtkPolyData> MeshAsset::GetLOD(int level) const {
+
+    // meshes smaller than this are cheap enough at any distance
+    const size_t min_triangles_to_decimate = 1000;
+    // fraction of the triangles removed at each level
+    const double target_reduction[N_LODS] = {0.0, 0.6, 0.9};
+
+    level = std::max(0, std::min(N_LODS - 1, level));
+    if(level == 0 || GetNumberOfTriangles() < min_triangles_to_decimate)
+        return poly_data;
+
+    std::lock_guard<std::mutex> lock(lod_mutex);
+    if(!lods[level]) {
+        vtkSmartPointer<vtkQuadricDecimation> decimation =
+                vtkSmartPointer<vtkQuadricDecimation>::New();
+        decimation->SetInputData(poly_data);
+        decimation->SetTargetReduction(target_reduction[level]);
+
+        vtkSmartPointer<vtkPolyDataNormals> lod_normals =
+                vtkSmartPointer<vtkPolyDataNormals>::New();
+        lod_normals->SetInputConnection(decimation->GetOutputPort());
+        lod_normals->SplittingOff();
+        lod_normals->Update();
+
+        lods[level] = lod_normals->GetOutput();
+    }
+    return lods[level];
+}
+
+// -----------------------------------------------------------------------------
+btCompoundShape * MeshAsset::CreateCompoundShape(
+        const float scaling_factor) const {
+
+    btCompoundShape* compound = new btCompoundShape();
+
+    for (const auto &part : parts) {
+        if(part.n_triangles == 0)
+            continue;
+
+        // create convex hull
+        btConvexHullShape *hull = new btConvexHullShape(
+                (const btScalar *) &vertices[3 * part.first_vertex],
+                int(part.n_vertices), 3 * sizeof(float));
+        hull->setLocalScaling(btVector3(scaling_factor, scaling_factor,
+                                        scaling_factor));
+        hull->initializePolyhedralFeatures();
+        hull->optimizeConvexHull();
+        hull->setMargin(0.0);
+
+        // the centroid of the triangle vertices, like LoadCompoundMeshFromObj
+        btVector3 centroid(0.0, 0.0, 0.0);
+        const size_t first = 4 * part.first_triangle;
+        const size_t last = first + 4 * part.n_triangles;
+        for (size_t t = first; t < last; t += 4)
+            for (size_t j = 1; j < 4; ++j) {
+                const float *v = &vertices[3 * triangles[t + j]];
+                centroid += btVector3(v[0], v[1], v[2]);
+            }
+        centroid = centroid / float(3 * part.n_triangles);
+
+        // add to the compound shape
+        btTransform trans;
+        trans.setIdentity();
+        trans.setOrigin(centroid);
+        compound->addChildShape(trans, hull);
+    }
+
+    return compound;
+}
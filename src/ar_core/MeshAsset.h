@@ -0,0 +1,126 @@
+//
+// Created by charm on 19/10/26.
+//
+
+#ifndef ATAR_MESHASSET_H
+#define ATAR_MESHASSET_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <kdl/frames.hpp>
+#include <vtkSmartPointer.h>
+#include <vtkPolyData.h>
+#include <vtkType.h>
+#include <BulletCollision/CollisionShapes/btCompoundShape.h>
+
+// A mesh a task is going to load. Physics meshes also need the convex
+// decomposition (see the MESH note in SimObject.h).
+struct MeshAssetRequest {
+    std::string file_name;
+    bool        physics;
+};
+
+/**
+ * \class MeshAsset
+ * \brief An OBJ mesh parsed once and shared by graphics and physics.
+ *
+ * All the shapes of the file are merged in one indexed triangle buffer:
+ * float xyz vertices and triangles stored as (3, i0, i1, i2). This is the
+ * layout of vtkCellArray, so the vtkPolyData of the asset points directly
+ * to the buffers and nothing is copied. The volume, center of mass and
+ * inertia are computed from the same buffers, and the parts (the shapes of
+ * the file) are used to build convex hulls for bullet. For the physics of
+ * MESH SimObjects use the convex decomposition of the file
+ * (LoadDecomposed), whose parts are convex.
+ *
+ * Assets are cached by file name and are never released, so the vtkPolyData
+ * of an asset can be given to as many mappers as needed. Different files
+ * can be loaded from different threads at the same time; a thread asking
+ * for a file that is being loaded waits for it. An asset is
+ * immutable after loading, so do not modify its vtkPolyData; copy it
+ * (DeepCopy) if a filter needs to change it in place.
+ *
+ * Dimensions are those of the file, i.e. not scaled by B_DIM_SCALE.
+ */
+class MeshAsset {
+public:
+
+    // Returns the asset of file_name, parsing the file only the first time.
+    // Throws if the file can not be read.
+    static std::shared_ptr<const MeshAsset> Load(const std::string &file_name);
+
+    // Same as Load, for the convex decomposition of file_name (see the
+    // MESH note in SimObject.h). The decomposition is generated if needed.
+    static std::shared_ptr<const MeshAsset> LoadDecomposed(
+            const std::string &file_name);
+
+    size_t GetNumberOfVertices() const { return vertices.size() / 3; };
+
+    size_t GetNumberOfTriangles() const { return triangles.size() / 4; };
+
+    size_t GetNumberOfParts() const { return parts.size(); };
+
+    // Graphics representation, shares the buffers of the asset
+    vtkSmartPointer<vtkPolyData> GetPolyData() const { return poly_data; };
+
+    // Level of detail: 0 is the full mesh, the higher levels are decimated
+    // (vtkQuadricDecimation) the first time they are asked for and then
+    // shared. Small meshes are not decimated.
+    static const int N_LODS = 3;
+    vtkSmartPointer<vtkPolyData> GetLOD(int level) const;
+
+    // Mass properties assuming a closed mesh and unit density. The inertia
+    // is about the origin of the mesh, in its axes, which is also the one
+    // about the center of mass only if the mesh is centred on it (as dynamic
+    // meshes must be, see the MESH note in SimObject.h).
+    double GetVolume() const { return volume; };
+
+    KDL::Vector GetCenterOfMass() const { return center_of_mass; };
+
+    KDL::Vector GetInertiaDiagonal() const { return inertia_diagonal; };
+
+    // A compound of one convex hull per part. The caller owns the shapes.
+    btCompoundShape * CreateCompoundShape(float scaling_factor) const;
+
+private:
+
+    explicit MeshAsset(const std::string &file_name);
+
+    void ComputeMassProperties();
+
+    void BuildPolyData();
+
+    MeshAsset(const MeshAsset &);  // Purposefully not implemented.
+
+    void operator=(const MeshAsset &);  // Purposefully not implemented.
+
+private:
+
+    // a shape of the obj file
+    struct Part {
+        size_t  first_vertex;
+        size_t  n_vertices;
+        size_t  first_triangle;
+        size_t  n_triangles;
+    };
+
+    std::vector<float>              vertices;
+    std::vector<float>              normals;
+    std::vector<float>              texture_coords;
+    std::vector<vtkIdType>          triangles;
+    std::vector<Part>               parts;
+
+    double                          volume = 0.0;
+    KDL::Vector                     center_of_mass;
+    KDL::Vector                     inertia_diagonal;
+
+    vtkSmartPointer<vtkPolyData>    poly_data;
+
+    mutable std::mutex              lod_mutex;
+    mutable vtkSmartPointer<vtkPolyData> lods[N_LODS];
+};
+
+
+#endif //ATAR_MESHASSET_H
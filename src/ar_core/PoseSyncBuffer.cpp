@@ -0,0 +1,43 @@
+//
+// Created by charm on 19/10/26.
+//
+
+#include "PoseSyncBuffer.h"
+#include "SimObject.h"
+
+
+// -----------------------------------------------------------------------------
+void PoseSyncBuffer::Gather(const std::vector<SimObject*> &objects) {
+
+    // the capacity is kept between frames, so no allocation after the first
+    targets.clear();
+    rotations.clear();
+    positions.clear();
+
+    for (auto obj : objects) {
+
+        BulletVTKMotionState *state = obj->GetMotionState();
+        if(state == nullptr || !state->IsDirty())
+            continue;
+
+        const btTransform &tr = state->GetBtTransform();
+        const btMatrix3x3 &basis = tr.getBasis();
+        const btVector3 &origin = tr.getOrigin();
+
+        for (int i = 0; i < 3; ++i)
+            for (int j = 0; j < 3; ++j)
+                rotations.push_back(float(basis[i][j]));
+        for (int i = 0; i < 3; ++i)
+            positions.push_back(float(origin[i] / B_DIM_SCALE));
+
+        targets.push_back(state);
+        state->ClearDirty();
+    }
+}
+
+// -----------------------------------------------------------------------------
+void PoseSyncBuffer::Apply() {
+
+    for (size_t i = 0; i < targets.size(); ++i)
+        targets[i]->SetActorMatrix(&rotations[9 * i], &positions[3 * i]);
+}
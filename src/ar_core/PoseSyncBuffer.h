@@ -0,0 +1,53 @@
+//
+// Created by charm on 19/10/26.
+//
+
+#ifndef ATAR_POSESYNCBUFFER_H
+#define ATAR_POSESYNCBUFFER_H
+
+#include <vector>
+#include <cstddef>
+
+class SimObject;
+class BulletVTKMotionState;
+
+/**
+ * \class PoseSyncBuffer
+ * \brief Hands the poses of the bodies moved by the physics to their actors
+ * in one batch per frame.
+ *
+ * Gather walks the objects once and copies the transforms of those that
+ * moved since the last frame into contiguous arrays (structure of arrays:
+ * one for the rotations, one for the positions, one for the targets).
+ * Apply then writes them to the matrices of the actors in one pass. The
+ * two stages only share the buffer, so Apply can be run from another
+ * thread (e.g. the render thread) as long as it does not overlap with the
+ * next Gather.
+ */
+class PoseSyncBuffer {
+public:
+
+    // Collects the transforms of the objects that moved. Clears the buffer
+    // first.
+    void Gather(const std::vector<SimObject*> &objects);
+
+    // Writes the gathered transforms to the actors
+    void Apply();
+
+    // Number of gathered transforms
+    size_t GetSize() const { return targets.size(); };
+
+    // row-major 3x3 rotation of the i-th gathered transform
+    const float * GetRotation(size_t i) const { return &rotations[9 * i]; };
+
+    // position of the i-th gathered transform, not scaled by B_DIM_SCALE
+    const float * GetPosition(size_t i) const { return &positions[3 * i]; };
+
+private:
+    std::vector<BulletVTKMotionState*>  targets;
+    std::vector<float>                  rotations;
+    std::vector<float>                  positions;
+};
+
+
+#endif //ATAR_POSESYNCBUFFER_H
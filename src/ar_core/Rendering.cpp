@@ -43,6 +43,8 @@ Rendering::Rendering(std::vector<int> view_resolution,
     if(ar_mode_){
         GetCameraNames( n_views, cam_names);
         it = new image_transport::ImageTransport(n);
+        publisher_latency = n.advertise<std_msgs::Float32MultiArray>(
+                "/atar/camera_pose_latency", 1);
     }
 
     for (int k = 0; k < n_views; ++k) {
@@ -56,6 +58,7 @@ Rendering::Rendering(std::vector<int> view_resolution,
     bool offScreen_rendering;
     n.param<bool>("offScreen_rendering", offScreen_rendering, false);
     n.param<bool>("publish_overlaid_images", publish_overlaid_images_, false);
+    n.param<double>("display_latency", display_latency, 0.0);
 
     SetupLights();
 
@@ -202,6 +205,7 @@ void Rendering::UpdateCameraViewForActualWindowSize() {
 
         cameras[i]->RefreshCamera(view_size_in_current_window);
     }
+    cameras_refreshed = true;
 }
 
 //------------------------------------------------------------------------------
@@ -246,12 +250,22 @@ Rendering::AddActorToScene(vtkSmartPointer<vtkProp> actor, bool with_shadow) {
 //------------------------------------------------------------------------------
 void Rendering::Render() {
 
-    // update  view angle (in case window changes size)
-    UpdateCameraViewForActualWindowSize();
+    ros::Time start = ros::Time::now();
+
+    // update  view angle (in case window changes size) if it was not
+    // already done for this frame
+    if(!cameras_refreshed)
+        UpdateCameraViewForActualWindowSize();
 
     for (int i = 0; i < n_windows; ++i) {
         render_window_[i]->Render();
     }
+    cameras_refreshed = false;
+
+    UpdateRenderTiming(start, ros::Time::now());
+
+    if(ar_mode_)
+        PublishLatencyStats();
 
     // Copy the rendered image to memory, show it and/or publish it.
     if(publish_overlaid_images_)
@@ -453,10 +467,92 @@ void Rendering::PublishRenderedImages() {
 
 }
 
+//------------------------------------------------------------------------------
+void Rendering::UpdateRenderTiming(const ros::Time &start,
+                                  const ros::Time &end) {
+
+    // low-pass filter the timings so that a single slow frame does not
+    // make the predictions jump
+    const double alpha = 0.1;
+
+    if(!last_render_start.isZero())
+        render_interval_avg = (1 - alpha) * render_interval_avg
+                              + alpha * (start - last_render_start).toSec();
+
+    render_duration_avg = (1 - alpha) * render_duration_avg
+                          + alpha * (end - start).toSec();
+
+    last_render_start = start;
+}
+
+//------------------------------------------------------------------------------
+ros::Time Rendering::GetExpectedDisplayTime() {
+
+    if(last_render_start.isZero())
+        return ros::Time::now();
+
+    ros::Time next_render_start = last_render_start
+                                  + ros::Duration(render_interval_avg);
+    // the loop might be running late
+    ros::Time now = ros::Time::now();
+    if(next_render_start < now)
+        next_render_start = now;
+
+    return next_render_start + ros::Duration(render_duration_avg
+                                             + display_latency);
+}
+
+//------------------------------------------------------------------------------
+ros::Time Rendering::GetPoseSyncTime() {
+
+    if(ar_mode_) {
+        ros::Time image_stamp = cameras[0]->GetBackgroundImageStamp();
+        if(!image_stamp.isZero())
+            return image_stamp;
+    }
+    return GetExpectedDisplayTime();
+}
+
+//------------------------------------------------------------------------------
+void Rendering::AddSyncedManipulator(Manipulator * in) {
+    synced_manipulators.push_back(in);
+}
+
+//------------------------------------------------------------------------------
+void Rendering::PublishLatencyStats() {
+
+    ros::Time image_stamp = cameras[0]->GetBackgroundImageStamp();
+    if(image_stamp.isZero())
+        return;
+
+    std_msgs::Float32MultiArray msg;
+    msg.data.push_back(float((ros::Time::now() - image_stamp).toSec()));
+
+    for (auto &m : synced_manipulators) {
+        ros::Time pose_stamp = m->GetLastPoseStamp();
+        if(pose_stamp.isZero())
+            msg.data.push_back(0.f);
+        else
+            msg.data.push_back(float((pose_stamp - image_stamp).toSec()));
+    }
+    publisher_latency.publish(msg);
+}
+
 void Rendering::SetManipulatorInterestedInCamPose(Manipulator * in) {
     cameras[0]->SetPtrManipulatorInterestedInCamPose(in);
 }
 
+void Rendering::GetMainViewProjection(double eye[3], double &pixels_per_unit) {
+
+    cameras[0]->camera_virtual->GetPosition(eye);
+
+    // the view angle of vtk cameras is the vertical one
+    int *window_size = render_window_[0]->GetActualSize();
+    double half_angle = cameras[0]->camera_virtual->GetViewAngle() / 2.0
+                        * M_PI / 180.0;
+    pixels_per_unit = double(window_size[1]) / (2.0 * tan(half_angle));
+}
+
 void Rendering::SetMainCameraPose(const KDL::Frame &pose) {
 
     cameras[0]->SetWorldToCamTf(pose);
@@ -41,6 +41,7 @@
 #include <vtkLightCollection.h>
 #include <assert.h>
 #include <vtkFrustumSource.h>
+#include <std_msgs/Float32MultiArray.h>
 
 
 /**
@@ -50,6 +51,18 @@
  * scene_renderer_ renders the virtual objects
  * background_renderer_ renders the images captured by the real camera
  *
+ * Pose synchronisation: in AR mode the tools must be drawn at the pose they
+ * had when the background image was captured, otherwise the overlay swims
+ * with the variable latency between the camera and the manipulator
+ * streams. GetPoseSyncTime returns that capture time (or the expected
+ * display time in VR mode) and is meant to be passed to
+ * Manipulator::GetPoseWorldAt. Since the background images are picked up
+ * when the cameras are refreshed, the cameras are refreshed before the task
+ * loop (see SimTask::StepWorld) and Render does not refresh them again in
+ * the same frame.
+ * The manipulators added with AddSyncedManipulator are used to publish
+ * latency statistics on /atar/camera_pose_latency (see
+ * PublishLatencyStats).
  */
 
 class Rendering {
@@ -66,6 +79,9 @@ public:
 
     void SetEnableBackgroundImage(bool isEnabled);
 
+    // updates the view angle and the background image of the cameras. Can
+    // be called before Render so that the background image stamp is known
+    // in advance.
     void UpdateCameraViewForActualWindowSize();
 
     void AddActorsToScene(std::vector< vtkSmartPointer<vtkProp> > actors);
@@ -88,6 +104,25 @@ public:
 
     KDL::Frame GetMainCameraPose() {return cameras[0]->GetWorldToCamTr();};
 
+    // Position of the main virtual camera and the number of pixels that a
+    // unit length at unit distance covers in its view. Used to find the
+    // size of the objects on the screen (see SimObject::SelectLOD).
+    void GetMainViewProjection(double eye[3], double &pixels_per_unit);
+
+    // Estimated time at which what is set in the scene now will be shown
+    // on the display: start of the next render + render duration + the
+    // display_latency parameter. Can be passed to
+    // Manipulator::GetPoseWorldAt to compensate the rendering latency.
+    ros::Time GetExpectedDisplayTime();
+
+    // The time to which the tool poses of the current frame should be
+    // synchronised: the capture time of the background image in AR mode, the
+    // expected display time otherwise.
+    ros::Time GetPoseSyncTime();
+
+    // Adds a manipulator to the camera-to-pose latency statistics
+    void AddSyncedManipulator(Manipulator*);
+
 private:
 
     void GetCameraNames(int num_views, std::string cam_names[]);
@@ -98,6 +133,13 @@ private:
 
     void PublishRenderedImages();
 
+    // updates the running averages of the render interval and duration
+    void UpdateRenderTiming(const ros::Time &start, const ros::Time &end);
+
+    // publishes [image age at render, (latest pose stamp - image stamp) for
+    // each synced manipulator] in seconds
+    void PublishLatencyStats();
+
 
 private:
     int n_windows;
@@ -129,6 +171,19 @@ private:
 
     //overlay image publishers (SLOW)
     image_transport::Publisher              publisher_stereo_overlayed;
+
+    // render timing used to estimate the display time
+    ros::Time                               last_render_start;
+    double                                  render_interval_avg = 1./30.;
+    double                                  render_duration_avg = 0.0;
+    // additional latency of the display (e.g. monitor input lag) [s]
+    double                                  display_latency;
+
+    // set when the cameras are refreshed and reset after rendering
+    bool                                    cameras_refreshed = false;
+
+    std::vector<Manipulator*>               synced_manipulators;
+    ros::Publisher                          publisher_latency;
 };
 
 
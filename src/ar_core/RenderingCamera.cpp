@@ -47,7 +47,9 @@ RenderingCamera::RenderingCamera(const std::vector<int> view_resolution,
 
         // in AR mode we read real camera images and show them as the background
         // of our rendering
-        ConfigureBackgroundImage(ar_camera->LockAndGetImage());
+        ar_camera->LockAndGetImage();
+        ConfigureBackgroundImage(ar_camera->GetFrame(),
+                                 ar_camera->GetImageRect());
     }
 
     // this flag is to make sure nothing goes wrong if some refreshes the
@@ -86,27 +88,32 @@ void RenderingCamera::RefreshCamera(const int *view_size_in_window){
 
 
 //------------------------------------------------------------------------------
-void RenderingCamera::ConfigureBackgroundImage(cv::Mat img) {
+void RenderingCamera::ConfigureBackgroundImage(cv::Mat frame, cv::Rect rect) {
 
-    assert( img.data != nullptr );
+    assert( frame.data != nullptr );
 
-    image_width_ = img.size().width;
-    image_height_ =  img.size().height;
+    image_width_ = rect.width;
+    image_height_ =  rect.height;
+    background_frame_size_ = frame.size();
+    background_rect_ = rect;
 
     if (camera_image_) {
         image_importer_->SetOutput(camera_image_);
     }
     image_importer_->SetDataSpacing(1, 1, 1);
     image_importer_->SetDataOrigin(0, 0, 0);
-    image_importer_->SetWholeExtent(0, (int)image_width_ - 1, 0,
-                                    (int)image_height_ - 1, 0, 0);
+    image_importer_->SetWholeExtent(0, frame.cols - 1, 0,
+                                    frame.rows - 1, 0, 0);
     image_importer_->SetDataExtentToWholeExtent();
     image_importer_->SetDataScalarTypeToUnsignedChar();
-    image_importer_->SetNumberOfScalarComponents(img.channels());
-    image_importer_->SetImportVoidPointer(img.data);
+    image_importer_->SetNumberOfScalarComponents(frame.channels());
+    image_importer_->SetImportVoidPointer(frame.data);
     image_importer_->Update();
 
     image_actor_->SetInputData(camera_image_);
+    // rows of the frame are along y, so this is the rect of the image
+    image_actor_->SetDisplayExtent(rect.x, rect.x + rect.width - 1,
+                                   rect.y, rect.y + rect.height - 1, 0, 0);
 
 }
 
@@ -147,23 +154,32 @@ void RenderingCamera::UpdateVirtualView(const int *window_size) {
 //------------------------------------------------------------------------------
 void RenderingCamera::UpdateBackgroundImage(const int *window_size) {
 
-    cv::Mat img;
-    if(ar_camera->IsImageNew())
-        img = ar_camera->GetImage();
-    if(is_initialized && !img.empty()) {
+    cv::Mat frame;
+    cv::Rect rect;
+    if(ar_camera->IsImageNew()) {
+        frame = ar_camera->GetFrame();
+        rect = ar_camera->GetImageRect();
+        background_image_stamp = ar_camera->GetImageStamp();
+    }
+    if(is_initialized && !frame.empty()) {
         //    cv::flip(src, _src, 0);
-        image_importer_->SetImportVoidPointer(img.data);
+        if(frame.size() != background_frame_size_ || rect != background_rect_)
+            ConfigureBackgroundImage(frame, rect);
+
+        image_importer_->SetImportVoidPointer(frame.data);
         image_importer_->Modified();
         image_importer_->Update();
 
-        int imageSize[3];
-        image_importer_->GetOutput()->GetDimensions(imageSize);
+        // face the displayed part of the frame only
+        int imageSize[3] = {rect.width, rect.height, 1};
 
         double spacing[3];
         image_importer_->GetOutput()->GetSpacing(spacing);
 
         double origin[3];
         image_importer_->GetOutput()->GetOrigin(origin);
+        origin[0] += rect.x * spacing[0];
+        origin[1] += rect.y * spacing[1];
 
         SetCameraToFaceImage(window_size, imageSize, spacing, origin);
     }
@@ -43,6 +43,10 @@ public:
 
     void RefreshCamera(const int *view_size_in_current_window);
 
+    // capture time of the image currently shown in the background. Zero if
+    // the camera is not AR.
+    ros::Time GetBackgroundImageStamp(){ return background_image_stamp;};
+
 private:
 
     RenderingCamera(const RenderingCamera&);  // Purposefully not implemented.
@@ -50,8 +54,10 @@ private:
     void operator=(const RenderingCamera&);  // Purposefully not implemented.
 
     // Initialize and configure the image actor used in the ar_mode according
-    // to the received image
-    void ConfigureBackgroundImage(cv::Mat img);
+    // to the received frame. The whole frame is imported and only the rect
+    // part of it, the image of this camera, is displayed: with a stereo
+    // frame both cameras show their half of the same buffer.
+    void ConfigureBackgroundImage(cv::Mat frame, cv::Rect rect);
 
     // Update the view angle of the virtual Camera according to window size
     void UpdateVirtualView(const int *window_size);
@@ -80,8 +86,11 @@ private:
     bool                                is_initialized = false;
     std::vector<Manipulator*>           interested_manipulators;
     KDL::Frame                          world_to_cam_tr;
+    ros::Time                           background_image_stamp;
     vtkSmartPointer<vtkImageImport>     image_importer_;
     vtkSmartPointer<vtkImageData>       camera_image_;
+    cv::Size                            background_frame_size_;
+    cv::Rect                            background_rect_;
     vtkSmartPointer<vtkMatrix4x4>       intrinsic_matrix;
 
     double image_width_;
@@ -0,0 +1,430 @@
+//
+// Created by charm on 19/10/26.
+//
+
+#include "SceneDescription.h"
+#include <vtkProperty.h>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <cstdint>
+#include <algorithm>
+
+extern std::string RESOURCES_DIRECTORY;
+
+namespace {
+
+const char      BINARY_MAGIC[4] = {'A', 'S', 'C', 'N'};
+const uint32_t  BINARY_VERSION = 1;
+
+const std::map<std::string, ObjectShape> SHAPE_NAMES = {
+        {"static_plane", STATICPLANE},
+        {"plane",        PLANE},
+        {"sphere",       SPHERE},
+        {"cylinder",     CYLINDER},
+        {"box",          BOX},
+        {"cone",         CONE},
+        {"mesh",         MESH}};
+
+const std::map<std::string, ObjectType> TYPE_NAMES = {
+        {"no_physics",   NOPHYSICS},
+        {"no_visuals",   NOVISUALS},
+        {"dynamic",      DYNAMIC},
+        {"kinematic",    KINEMATIC}};
+
+// -----------------------------------------------------------------------------
+// yaml (XmlRpc) helpers
+double ToDouble(XmlRpc::XmlRpcValue &value) {
+    if(value.getType() == XmlRpc::XmlRpcValue::TypeInt)
+        return int(value);
+    if(value.getType() == XmlRpc::XmlRpcValue::TypeDouble)
+        return double(value);
+    throw std::runtime_error("Scene: expected a number.");
+}
+
+std::vector<double> ToDoubleVector(XmlRpc::XmlRpcValue &value) {
+    if(value.getType() != XmlRpc::XmlRpcValue::TypeArray)
+        throw std::runtime_error("Scene: expected a list of numbers.");
+    std::vector<double> out(size_t(value.size()));
+    for (int i = 0; i < value.size(); ++i)
+        out[i] = ToDouble(value[i]);
+    return out;
+}
+
+std::vector<int> ToIntVector(XmlRpc::XmlRpcValue &value) {
+    std::vector<double> in = ToDoubleVector(value);
+    return std::vector<int>(in.begin(), in.end());
+}
+
+std::string ToString(XmlRpc::XmlRpcValue &value) {
+    if(value.getType() != XmlRpc::XmlRpcValue::TypeString)
+        throw std::runtime_error("Scene: expected a string.");
+    return std::string(value);
+}
+
+bool ToBool(XmlRpc::XmlRpcValue &value) {
+    if(value.getType() != XmlRpc::XmlRpcValue::TypeBoolean)
+        throw std::runtime_error("Scene: expected true or false.");
+    return bool(value);
+}
+
+template <typename T>
+T FromName(const std::map<std::string, T> &names, const std::string &name) {
+    auto it = names.find(name);
+    if(it == names.end())
+        throw std::runtime_error("Scene: unknown name " + name);
+    return it->second;
+}
+
+SceneObjectDescription ParseObject(XmlRpc::XmlRpcValue &o) {
+
+    SceneObjectDescription d;
+    if(!o.hasMember("shape"))
+        throw std::runtime_error("Scene: every object needs a shape.");
+    d.shape = FromName(SHAPE_NAMES, ToString(o["shape"]));
+
+    if(o.hasMember("type"))
+        d.type = FromName(TYPE_NAMES, ToString(o["type"]));
+    if(o.hasMember("dimensions"))
+        d.dimensions = ToDoubleVector(o["dimensions"]);
+    if(o.hasMember("pose")) {
+        std::vector<double> pose = ToDoubleVector(o["pose"]);
+        if(pose.size() != 7)
+            throw std::runtime_error("Scene: pose must be [x, y, z, qx, qy, "
+                                             "qz, qw].");
+        d.pose = KDL::Frame(
+                KDL::Rotation::Quaternion(pose[3], pose[4], pose[5], pose[6]),
+                KDL::Vector(pose[0], pose[1], pose[2]));
+    }
+    if(o.hasMember("density"))
+        d.density = ToDouble(o["density"]);
+    if(o.hasMember("friction"))
+        d.friction = ToDouble(o["friction"]);
+    if(o.hasMember("texture"))
+        d.texture_file = ToString(o["texture"]);
+    if(o.hasMember("mesh"))
+        d.mesh_file = ToString(o["mesh"]);
+    if(o.hasMember("id"))
+        d.id = int(ToDouble(o["id"]));
+    if(o.hasMember("color")) {
+        std::vector<double> color = ToDoubleVector(o["color"]);
+        if(color.size() != 3)
+            throw std::runtime_error("Scene: color must be [r, g, b].");
+        std::copy(color.begin(), color.end(), d.color);
+    }
+    if(o.hasMember("opacity"))
+        d.opacity = ToDouble(o["opacity"]);
+    if(o.hasMember("shadow"))
+        d.shadow = ToBool(o["shadow"]);
+    if(o.hasMember("instance_group"))
+        d.instance_group = ToString(o["instance_group"]);
+    return d;
+}
+
+std::string ResourcePath(const std::string &file_name) {
+    if(file_name.empty() || file_name[0] == '/')
+        return file_name;
+    return RESOURCES_DIRECTORY + "/" + file_name;
+}
+
+// -----------------------------------------------------------------------------
+// binary helpers. Plain little endian dumps, the files are not meant to be
+// moved between architectures.
+template <typename T>
+void Write(std::ostream &out, const T &value) {
+    out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template <typename T>
+void Read(std::istream &in, T &value) {
+    in.read(reinterpret_cast<char *>(&value), sizeof(T));
+}
+
+template <typename T>
+void WriteVector(std::ostream &out, const std::vector<T> &values) {
+    Write(out, uint32_t(values.size()));
+    out.write(reinterpret_cast<const char *>(values.data()),
+              values.size() * sizeof(T));
+}
+
+// Reads a count of elements of element_size bytes. The count comes from
+// the file, so it is checked against what is left of it before anything
+// is allocated.
+uint32_t ReadCount(std::istream &in, const size_t element_size,
+                   const std::streamoff file_size) {
+    uint32_t n = 0;
+    Read(in, n);
+    if(!in)
+        throw std::runtime_error("Truncated scene file");
+    const std::streamoff position = in.tellg();
+    if(uint64_t(n) * element_size > uint64_t(file_size - position))
+        throw std::runtime_error("Corrupt scene file, a count of " +
+                                 std::to_string(n) + " at byte " +
+                                 std::to_string(position) +
+                                 " is beyond the end of the file");
+    return n;
+}
+
+template <typename T>
+void ReadVector(std::istream &in, std::vector<T> &values,
+                const std::streamoff file_size) {
+    const uint32_t n = ReadCount(in, sizeof(T), file_size);
+    values.resize(n);
+    in.read(reinterpret_cast<char *>(values.data()), n * sizeof(T));
+}
+
+void WriteString(std::ostream &out, const std::string &s) {
+    Write(out, uint32_t(s.size()));
+    out.write(s.data(), s.size());
+}
+
+void ReadString(std::istream &in, std::string &s,
+                const std::streamoff file_size) {
+    const uint32_t n = ReadCount(in, 1, file_size);
+    s.resize(n);
+    in.read(&s[0], n);
+}
+
+// Reads an int32 enum value and checks that it is in [first, last]
+int32_t ReadEnum(std::istream &in, const int32_t first, const int32_t last,
+                 const char *name) {
+    int32_t value = 0;
+    Read(in, value);
+    if(!in)
+        throw std::runtime_error("Truncated scene file");
+    if(value < first || value > last)
+        throw std::runtime_error("Corrupt scene file, invalid " +
+                                 std::string(name) + " " +
+                                 std::to_string(value));
+    return value;
+}
+
+// bytes of an object in the binary file when its vectors and strings are
+// empty
+const size_t MIN_BINARY_OBJECT_SIZE =
+        2 * sizeof(int32_t) + sizeof(uint32_t) + 7 * sizeof(double)
+        + 2 * sizeof(double) + 2 * sizeof(uint32_t) + sizeof(int32_t)
+        + 3 * sizeof(double) + sizeof(double) + sizeof(uint8_t)
+        + sizeof(uint32_t);
+
+}
+
+// -----------------------------------------------------------------------------
+SceneDescription SceneDescription::FromParameter(const ros::NodeHandle &n,
+                                                 const std::string &param_name) {
+
+    XmlRpc::XmlRpcValue scene_param;
+    if(!n.getParam(param_name, scene_param))
+        throw std::runtime_error("Parameter '" + n.resolveName(param_name)
+                                 + "' is required.");
+
+    SceneDescription scene;
+
+    if(scene_param.hasMember("rendering")) {
+        XmlRpc::XmlRpcValue &r = scene_param["rendering"];
+        SceneRenderingDescription &rendering = scene.rendering;
+        if(r.hasMember("view_resolution"))
+            rendering.view_resolution = ToIntVector(r["view_resolution"]);
+        if(r.hasMember("ar_mode"))
+            rendering.ar_mode = ToBool(r["ar_mode"]);
+        if(r.hasMember("n_views"))
+            rendering.n_views = int(ToDouble(r["n_views"]));
+        if(r.hasMember("one_window_per_view"))
+            rendering.one_window_per_view = ToBool(r["one_window_per_view"]);
+        if(r.hasMember("borders_off"))
+            rendering.borders_off = ToBool(r["borders_off"]);
+        if(r.hasMember("window_positions"))
+            rendering.window_positions = ToIntVector(r["window_positions"]);
+        if(r.hasMember("main_camera_pose")) {
+            rendering.main_camera_pose = ToDoubleVector(r["main_camera_pose"]);
+            if(rendering.main_camera_pose.size() != 7)
+                throw std::runtime_error("Scene: main_camera_pose must be [x, "
+                                                 "y, z, qx, qy, qz, qw].");
+        }
+    }
+
+    if(scene_param.hasMember("objects")) {
+        XmlRpc::XmlRpcValue &objects = scene_param["objects"];
+        if(objects.getType() != XmlRpc::XmlRpcValue::TypeArray)
+            throw std::runtime_error("Scene: objects must be a list.");
+        scene.objects.reserve(size_t(objects.size()));
+        for (int i = 0; i < objects.size(); ++i)
+            scene.objects.push_back(ParseObject(objects[i]));
+    }
+
+    ROS_INFO("Read scene with %lu objects from %s", scene.objects.size(),
+             n.resolveName(param_name).c_str());
+    return scene;
+}
+
+// -----------------------------------------------------------------------------
+void SceneDescription::WriteBinary(const std::string &file_name) const {
+
+    std::ofstream out(file_name, std::ios::binary);
+    if(!out)
+        throw std::runtime_error("Can't open scene file " + file_name);
+
+    out.write(BINARY_MAGIC, 4);
+    Write(out, BINARY_VERSION);
+
+    WriteVector(out, rendering.view_resolution);
+    Write(out, uint8_t(rendering.ar_mode));
+    Write(out, int32_t(rendering.n_views));
+    Write(out, uint8_t(rendering.one_window_per_view));
+    Write(out, uint8_t(rendering.borders_off));
+    WriteVector(out, rendering.window_positions);
+    WriteVector(out, rendering.main_camera_pose);
+
+    Write(out, uint32_t(objects.size()));
+    for (const auto &d : objects) {
+        Write(out, int32_t(d.shape));
+        Write(out, int32_t(d.type));
+        WriteVector(out, d.dimensions);
+        double pose[7];
+        pose[0] = d.pose.p.x(); pose[1] = d.pose.p.y(); pose[2] = d.pose.p.z();
+        d.pose.M.GetQuaternion(pose[3], pose[4], pose[5], pose[6]);
+        Write(out, pose);
+        Write(out, d.density);
+        Write(out, d.friction);
+        WriteString(out, d.texture_file);
+        WriteString(out, d.mesh_file);
+        Write(out, int32_t(d.id));
+        Write(out, d.color);
+        Write(out, d.opacity);
+        Write(out, uint8_t(d.shadow));
+        WriteString(out, d.instance_group);
+    }
+
+    if(!out)
+        throw std::runtime_error("Error writing scene file " + file_name);
+    ROS_INFO("Wrote scene with %lu objects to %s", objects.size(),
+             file_name.c_str());
+}
+
+// -----------------------------------------------------------------------------
+SceneDescription SceneDescription::ReadBinary(const std::string &file_name) {
+
+    std::ifstream in(file_name, std::ios::binary | std::ios::ate);
+    if(!in)
+        throw std::runtime_error("Can't open scene file " + file_name);
+    const std::streamoff file_size = in.tellg();
+    in.seekg(0);
+
+    char magic[4];
+    uint32_t version = 0;
+    in.read(magic, 4);
+    Read(in, version);
+    if(!in || !std::equal(magic, magic + 4, BINARY_MAGIC)
+       || version != BINARY_VERSION)
+        throw std::runtime_error("Not a scene file or wrong version: "
+                                 + file_name);
+
+    SceneDescription scene;
+    uint8_t flag;
+    int32_t value;
+
+    try {
+        ReadVector(in, scene.rendering.view_resolution, file_size);
+        Read(in, flag);
+        scene.rendering.ar_mode = flag != 0;
+        Read(in, value);
+        scene.rendering.n_views = value;
+        Read(in, flag);
+        scene.rendering.one_window_per_view = flag != 0;
+        Read(in, flag);
+        scene.rendering.borders_off = flag != 0;
+        ReadVector(in, scene.rendering.window_positions, file_size);
+        ReadVector(in, scene.rendering.main_camera_pose, file_size);
+
+        const uint32_t n_objects = ReadCount(in, MIN_BINARY_OBJECT_SIZE,
+                                             file_size);
+        scene.objects.resize(n_objects);
+        for (auto &d : scene.objects) {
+            d.shape = ObjectShape(ReadEnum(in, STATICPLANE, MESH, "shape"));
+            d.type = ObjectType(ReadEnum(in, NOPHYSICS, KINEMATIC, "type"));
+            ReadVector(in, d.dimensions, file_size);
+            double pose[7];
+            Read(in, pose);
+            d.pose = KDL::Frame(
+                    KDL::Rotation::Quaternion(pose[3], pose[4], pose[5], pose[6]),
+                    KDL::Vector(pose[0], pose[1], pose[2]));
+            Read(in, d.density);
+            Read(in, d.friction);
+            ReadString(in, d.texture_file, file_size);
+            ReadString(in, d.mesh_file, file_size);
+            Read(in, value);
+            d.id = value;
+            Read(in, d.color);
+            Read(in, d.opacity);
+            Read(in, flag);
+            d.shadow = flag != 0;
+            ReadString(in, d.instance_group, file_size);
+        }
+    } catch(const std::runtime_error &e) {
+        ROS_ERROR("%s: %s", file_name.c_str(), e.what());
+        throw;
+    }
+
+    if(!in)
+        throw std::runtime_error("Truncated scene file " + file_name);
+    return scene;
+}
+
+// -----------------------------------------------------------------------------
+std::vector<SimObject*> SceneDescription::CreateSimObjects() const {
+
+    std::vector<SimObject*> sim_objects;
+    sim_objects.reserve(objects.size());
+
+    try {
+        for (const auto &d : objects) {
+
+            SimObject *obj;
+            if(d.shape == STATICPLANE)
+                obj = new SimObject(STATICPLANE, d.dimensions);
+            else
+                obj = new SimObject(d.shape, d.type, d.dimensions, d.pose,
+                                    d.density, d.friction,
+                                    ResourcePath(d.texture_file),
+                                    ResourcePath(d.mesh_file), d.id);
+            sim_objects.push_back(obj);
+
+            if(obj->GetObjectType() != NOVISUALS) {
+                obj->GetActor()->GetProperty()->SetColor(d.color[0],
+                                                         d.color[1],
+                                                         d.color[2]);
+                obj->GetActor()->GetProperty()->SetOpacity(d.opacity);
+            }
+            // sets with_shadow
+            obj->DisableShadow(d.shadow);
+        }
+    } catch(...) {
+        for (auto obj : sim_objects)
+            delete obj;
+        throw;
+    }
+    return sim_objects;
+}
+
+// -----------------------------------------------------------------------------
+std::vector<MeshAssetRequest> SceneDescription::RequiredMeshes() const {
+
+    std::vector<MeshAssetRequest> meshes;
+    std::map<std::string, size_t> index;
+
+    for (const auto &d : objects) {
+        if(d.shape != MESH)
+            continue;
+
+        const std::string file_name = ResourcePath(d.mesh_file);
+        const bool physics = d.type != NOPHYSICS;
+
+        auto it = index.find(file_name);
+        if(it == index.end()) {
+            index[file_name] = meshes.size();
+            meshes.push_back({file_name, physics});
+        } else
+            meshes[it->second].physics |= physics;
+    }
+    return meshes;
+}
@@ -0,0 +1,89 @@
+//
+// Created by charm on 19/10/26.
+//
+
+#ifndef ATAR_SCENEDESCRIPTION_H
+#define ATAR_SCENEDESCRIPTION_H
+
+#include <string>
+#include <vector>
+#include <ros/ros.h>
+#include <kdl/frames.hpp>
+#include "SimObject.h"
+#include "MeshAsset.h"
+
+// One SimObject of a scene, i.e. the arguments of the SimObject constructor
+// plus the look of its actor.
+struct SceneObjectDescription {
+    ObjectShape             shape = BOX;
+    ObjectType              type = NOPHYSICS;
+    std::vector<double>     dimensions;
+    KDL::Frame              pose;
+    double                  density = 0.0;
+    double                  friction = 0.25;
+    // relative to RESOURCES_DIRECTORY unless absolute
+    std::string             texture_file;
+    std::string             mesh_file;
+    int                     id = 0;
+    double                  color[3] = {0.8, 0.8, 0.8};
+    double                  opacity = 1.0;
+    bool                    shadow = true;
+    // objects with the same non empty group are rendered by one
+    // SimObjectInstancer (they must share the geometry)
+    std::string             instance_group;
+};
+
+// The arguments of the Rendering constructor and the pose of the main camera
+struct SceneRenderingDescription {
+    std::vector<int>        view_resolution = {640, 480};
+    bool                    ar_mode = false;
+    int                     n_views = 1;
+    bool                    one_window_per_view = false;
+    bool                    borders_off = false;
+    std::vector<int>        window_positions = {100, 50, 740, 50, 1380, 50};
+    // [x, y, z, qx, qy, qz, qw] or empty to keep the default pose
+    std::vector<double>     main_camera_pose;
+};
+
+/**
+ * \class SceneDescription
+ * \brief Declarative description of the scene of a task: the rendering
+ * setup and the list of its SimObjects.
+ *
+ * Scenes are written in yaml and loaded on the parameter server like the
+ * other parameters (rosparam in the launch file), see
+ * launch/params_scene_example.yaml for the format. FromParameter reads them
+ * back from there. A scene can then be saved in a compact binary file
+ * (WriteBinary) that is read in one go (ReadBinary), without going through
+ * the parameter server.
+ *
+ * CreateSimObjects builds all the objects at once; meshes and textures come
+ * from the MeshAsset and TextureCache caches, so repeated objects only
+ * cost their actor and body. Use SimTask::AddSceneToTask to add them to a
+ * task.
+ */
+class SceneDescription {
+public:
+
+    // Throws if the parameter is missing or malformed.
+    static SceneDescription FromParameter(const ros::NodeHandle &n,
+                                          const std::string &param_name);
+
+    static SceneDescription ReadBinary(const std::string &file_name);
+
+    void WriteBinary(const std::string &file_name) const;
+
+    // The caller owns the objects
+    std::vector<SimObject*> CreateSimObjects() const;
+
+    // The mesh files of the objects, each once, for the AssetPreloader
+    std::vector<MeshAssetRequest> RequiredMeshes() const;
+
+public:
+
+    SceneRenderingDescription               rendering;
+    std::vector<SceneObjectDescription>     objects;
+};
+
+
+#endif //ATAR_SCENEDESCRIPTION_H
@@ -0,0 +1,83 @@
+//
+// Created by charm on 19/10/26.
+//
+
+#ifndef ATAR_SEQLOCK_H
+#define ATAR_SEQLOCK_H
+
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+
+/**
+ * \class SeqLock
+ * \brief A sequence lock holding a value that is written by ros callbacks
+ * and read from other threads (e.g. the haptics thread) without locking.
+ *
+ * Writers increment the sequence number to an odd value, modify the data
+ * and increment it again. Readers copy the data and retry if the sequence
+ * was odd or changed during the copy, so they always get a consistent
+ * snapshot and never block a writer. Writers are serialized among
+ * themselves with a compare-and-swap on the sequence since ros callbacks of
+ * different subscribers may run concurrently when spinOnce is called from
+ * more than one thread.
+ *
+ * T must be a plain value type (no heap memory) since it can be copied
+ * while being written; the torn copy is then discarded.
+ */
+template <typename T>
+class SeqLock {
+
+    static_assert(std::is_trivially_destructible<T>::value,
+                  "SeqLock only holds plain value types.");
+
+public:
+
+    SeqLock() : seq(0), data() {};
+
+    explicit SeqLock(const T &in) : seq(0), data(in) {};
+
+    // Applies f(T&) to the data as one atomic update
+    template <typename F>
+    void Modify(F f) {
+        uint32_t s = seq.load(std::memory_order_relaxed);
+        while ((s & 1u) || !seq.compare_exchange_weak(
+                s, s + 1, std::memory_order_acquire,
+                std::memory_order_relaxed))
+            s = seq.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        f(data);
+
+        seq.store(s + 2, std::memory_order_release);
+    }
+
+    void Store(const T &in) { Modify([&in](T &d) { d = in; }); };
+
+    // Returns a consistent copy of the data
+    T Load() const {
+        T out;
+        uint32_t s0, s1;
+        do {
+            s0 = seq.load(std::memory_order_acquire);
+            while (s0 & 1u)
+                s0 = seq.load(std::memory_order_acquire);
+            out = data;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            s1 = seq.load(std::memory_order_relaxed);
+        } while (s0 != s1);
+        return out;
+    }
+
+private:
+    SeqLock(const SeqLock &);  // Purposefully not implemented.
+
+    void operator=(const SeqLock &);  // Purposefully not implemented.
+
+private:
+    std::atomic<uint32_t>   seq;
+    T                       data;
+};
+
+
+#endif //ATAR_SEQLOCK_H
@@ -2,24 +2,44 @@
 // Created by nima on 23/11/17.
 //
 
-#include <vtkPolyDataMapper.h>
 #include <vtkProperty.h>
-#include <vtkActor.h>
+#include <vtkPointData.h>
 #include "SimDrawPath.h"
-
-
-SimDrawPath::SimDrawPath() {
-
-    //    First we'll create an initial point to build on
-    path_points->InsertPoint(0, 0.0, 0.0, 0.0);
-    path_cell->InsertNextCell(1) ;
-    path_cell->InsertCellPoint(0);
+#include <algorithm>
+
+
+SimDrawPath::SimDrawPath(const size_t capacity,
+                         const double collinear_tolerance,
+                         const double fade_time)
+        :
+        capacity(std::max(capacity, size_t(2))),
+        collinear_tolerance(collinear_tolerance),
+        fade_time(fade_time),
+        start_time(std::chrono::steady_clock::now())
+{
+    // the buffers are allocated once
+    path_points->SetNumberOfPoints(vtkIdType(this->capacity));
+    point_times->SetNumberOfTuples(vtkIdType(this->capacity));
+    point_times->SetName("Time");
+
+    connectivity.resize(2 * this->capacity + 1, 0);
+    for (size_t k = 0; k < 2 * this->capacity; ++k)
+        connectivity[1 + k] = vtkIdType(k % this->capacity);
 
     path_poly->SetPoints(path_points);
+    path_poly->GetPointData()->SetScalars(point_times);
     path_poly->SetLines(path_cell);
+    UpdateCell();
 
-    vtkSmartPointer<vtkPolyDataMapper> path_mapper = vtkPolyDataMapper::New();
     path_mapper->SetInputData(path_poly);
+    path_mapper->ScalarVisibilityOff();
+    if(fade_time > 0.0) {
+        fade_table->SetNumberOfTableValues(256);
+        path_mapper->SetLookupTable(fade_table);
+        path_mapper->SetScalarModeToUsePointData();
+        path_mapper->ScalarVisibilityOn();
+        UpdateFading();
+    }
 
     path_actor->SetMapper(path_mapper);
 
@@ -28,31 +48,105 @@ SimDrawPath::SimDrawPath() {
 
 void SimDrawPath::InsertNewPoint(KDL::Vector in) {
 
-    if(!initialized){
-        path_points->InsertPoint(0,  in[0], in[1], in[2]);
-        path_cell->InsertNextCell(1) ;
-        path_cell->InsertCellPoint(0);
-        initialized = true;
+    const float now = Now();
+
+    // replace the last point if the new one does not add anything
+    if(collinear_tolerance > 0.0 && count > 0) {
+        double p[3];
+        path_points->GetPoint(vtkIdType(RingIndex(count - 1)), p);
+        KDL::Vector last(p[0], p[1], p[2]);
+
+        bool redundant = (in - last).Norm() < collinear_tolerance;
+        if(!redundant && count > 1) {
+            path_points->GetPoint(vtkIdType(RingIndex(count - 2)), p);
+            KDL::Vector before_last(p[0], p[1], p[2]);
+
+            // distance of the last point from the segment before_last-in
+            KDL::Vector seg = in - before_last;
+            double seg_len2 = KDL::dot(seg, seg);
+            double s = seg_len2 > 0.0 ?
+                       KDL::dot(last - before_last, seg) / seg_len2 : 0.0;
+            redundant = s > 0.0 && s < 1.0 &&
+                        (before_last + s * seg - last).Norm()
+                        < collinear_tolerance;
+        }
+
+        if(redundant) {
+            SetPoint(RingIndex(count - 1), in, now);
+            path_points->Modified();
+            point_times->Modified();
+            return;
+        }
     }
-    else
-    {
-        auto num_points = path_points->GetNumberOfPoints();
-        path_points->InsertPoint(num_points, in[0], in[1], in[2]);
-        path_points->Modified();
-
-        path_cell->InsertNextCell(2);
-        path_cell->InsertCellPoint(num_points - 1);
-        path_cell->InsertCellPoint(num_points);
-        path_cell->Modified();
+
+    // drop the oldest point if full
+    if(count == capacity) {
+        tail = (tail + 1) % capacity;
+        count--;
     }
 
+    SetPoint(RingIndex(count), in, now);
+    count++;
+
+    path_points->Modified();
+    point_times->Modified();
+    UpdateCell();
 }
 
+
 void SimDrawPath::Clear() {
 
-    path_points->Reset();
-    path_cell->Reset();
-    path_poly->Reset();
-    initialized=false;
+    tail = 0;
+    count = 0;
+    UpdateCell();
+
+}
+
+
+void SimDrawPath::UpdateFading() {
+
+    if(fade_time <= 0.0)
+        return;
+
+    // the colour of the property with an alpha going from 0 for the points
+    // older than fade_time to 1 for the newest
+    double rgb[3];
+    path_actor->GetProperty()->GetColor(rgb);
+    const int n = fade_table->GetNumberOfTableValues();
+    for (int i = 0; i < n; ++i)
+        fade_table->SetTableValue(i, rgb[0], rgb[1], rgb[2],
+                                  double(i) / double(n - 1));
+
+    const float now = Now();
+    path_mapper->SetScalarRange(now - fade_time, now);
+}
+
+
+void SimDrawPath::SetPoint(const size_t index, const KDL::Vector &in,
+                           const float time) {
+    path_points->SetPoint(vtkIdType(index), in[0], in[1], in[2]);
+    point_times->SetValue(vtkIdType(index), time);
+}
+
+
+void SimDrawPath::UpdateCell() {
+
+    // give back its id to the slot that held the previous header
+    connectivity[header] = header == 0 ?
+                           0 : vtkIdType((header - 1) % capacity);
+
+    header = tail;
+    connectivity[header] = vtkIdType(count);
+
+    // no copy, the array points to the window in connectivity
+    cell_ids->SetArray(&connectivity[header], vtkIdType(count + 1), 1);
+    path_cell->SetCells(count > 0 ? 1 : 0, cell_ids);
+    path_cell->Modified();
+    path_poly->Modified();
+}
+
 
+float SimDrawPath::Now() const {
+    return std::chrono::duration<float>(
+            std::chrono::steady_clock::now() - start_time).count();
 }
@@ -9,12 +9,38 @@
 #include <vtkPoints.h>
 #include <vtkCellArray.h>
 #include <vtkPolyData.h>
+#include <vtkIdTypeArray.h>
+#include <vtkFloatArray.h>
+#include <vtkLookupTable.h>
+#include <vtkPolyDataMapper.h>
+#include <vtkActor.h>
 #include <kdl/frames.hpp>
+#include <chrono>
+#include <vector>
 
+/**
+ * \class SimDrawPath
+ * \brief Draws the trace of a point (e.g. a tool tip) as one polyline.
+ *
+ * The points are kept in a ring buffer of fixed capacity: when it is full
+ * the oldest point is dropped, so the memory and the cost of drawing the
+ * path stay constant however long it runs. The polyline is one cell whose
+ * point ids are a window of a static id buffer, so adding a point costs the
+ * same whatever the length of the path.
+ *
+ * Optional features:
+ *  collinear_tolerance: if > 0, a new point that is closer than this to the
+ *  segment joining the two previous points (or to the last point) replaces
+ *  the last point instead of being added.
+ *  fade_time: if > 0, the points fade out (alpha goes to 0) in fade_time
+ *  seconds. Call UpdateFading once per frame for this.
+ */
 class SimDrawPath {
 public:
 
-    SimDrawPath();
+    explicit SimDrawPath(size_t capacity = 4096,
+                         double collinear_tolerance = 0.0,
+                         double fade_time = 0.0);
 
     void InsertNewPoint(KDL::Vector in);
 
@@ -22,12 +48,51 @@ public:
 
     void Clear();
 
+    // Updates the transparency of the points with their age. Does nothing
+    // if fading is off.
+    void UpdateFading();
+
 private:
-    bool initialized;
-    vtkSmartPointer<vtkPoints> path_points = vtkPoints::New();
-    vtkSmartPointer<vtkCellArray> path_cell = vtkCellArray::New();
-    vtkSmartPointer<vtkPolyData> path_poly = vtkPolyData::New();
-    vtkSmartPointer<vtkActor> path_actor = vtkActor::New();
+
+    // ring buffer index of the i-th oldest point
+    size_t RingIndex(size_t i) const { return (tail + i) % capacity; };
+
+    void SetPoint(size_t index, const KDL::Vector &in, float time);
+
+    // moves the window of the polyline cell to the current points
+    void UpdateCell();
+
+    float Now() const;
+
+private:
+    size_t      capacity;
+    double      collinear_tolerance;
+    double      fade_time;
+
+    // oldest point and number of points in the ring buffer
+    size_t      tail = 0;
+    size_t      count = 0;
+
+    // connectivity[1 + k] = k % capacity. The cell is the window starting
+    // at connectivity[header], which holds its number of points.
+    std::vector<vtkIdType>  connectivity;
+    size_t                  header = 0;
+
+    std::chrono::steady_clock::time_point start_time;
+
+    vtkSmartPointer<vtkPoints> path_points = vtkSmartPointer<vtkPoints>::New();
+    vtkSmartPointer<vtkFloatArray> point_times =
+            vtkSmartPointer<vtkFloatArray>::New();
+    vtkSmartPointer<vtkIdTypeArray> cell_ids =
+            vtkSmartPointer<vtkIdTypeArray>::New();
+    vtkSmartPointer<vtkCellArray> path_cell =
+            vtkSmartPointer<vtkCellArray>::New();
+    vtkSmartPointer<vtkPolyData> path_poly = vtkSmartPointer<vtkPolyData>::New();
+    vtkSmartPointer<vtkLookupTable> fade_table =
+            vtkSmartPointer<vtkLookupTable>::New();
+    vtkSmartPointer<vtkPolyDataMapper> path_mapper =
+            vtkSmartPointer<vtkPolyDataMapper>::New();
+    vtkSmartPointer<vtkActor> path_actor = vtkSmartPointer<vtkActor>::New();
 
 };
 
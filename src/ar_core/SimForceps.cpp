@@ -6,6 +6,13 @@
 #include <vtkProperty.h>
 extern std::string                      RESOURCES_DIRECTORY;
 
+static const std::string JAW_MESH = "/mesh/jaw.obj";
+
+//------------------------------------------------------------------------------
+std::vector<MeshAssetRequest> SimForceps::RequiredMeshes() {
+    return {{RESOURCES_DIRECTORY + JAW_MESH, true}};
+}
+
 SimForceps::SimForceps(const KDL::Frame init_pose)
 {
 
@@ -25,7 +32,7 @@ SimForceps::SimForceps(const KDL::Frame init_pose)
     // create jaw 1
     sim_objects_.emplace_back(new SimObject(ObjectShape::MESH,
                                             ObjectType::DYNAMIC,
-                                            RESOURCES_DIRECTORY+ "/mesh/jaw.obj",
+                                            RESOURCES_DIRECTORY + JAW_MESH,
                                             init_pose,
                                             gripper_density,
                                             gripper_friction));
@@ -44,7 +51,7 @@ SimForceps::SimForceps(const KDL::Frame init_pose)
                                                   -link0_axis_z_offset);
     sim_objects_.emplace_back(new SimObject(ObjectShape::MESH,
                                             ObjectType::DYNAMIC,
-                                            RESOURCES_DIRECTORY+ "/mesh/jaw.obj",
+                                            RESOURCES_DIRECTORY + JAW_MESH,
                                             gripper_pose,
                                             gripper_density,
                                             gripper_friction));
@@ -7,6 +7,7 @@
 
 #include "SimObject.h"
 #include "SimMechanism.h"
+#include "MeshAsset.h"
 #include <kdl/frames.hpp>
 
 class SimForceps : public SimMechanism{
@@ -14,6 +15,9 @@ class SimForceps : public SimMechanism{
 public:
     explicit SimForceps(KDL::Frame init_pose=KDL::Frame());
 
+    // The meshes of the jaws, for the RequiredMeshes of the tasks
+    static std::vector<MeshAssetRequest> RequiredMeshes();
+
     void SetPoseAndJawAngle(KDL::Frame pose,
                             double grip_angle);
 
@@ -6,6 +6,13 @@
 #include <vtkProperty.h>
 extern std::string                      RESOURCES_DIRECTORY;
 
+static const std::string JAW_MESH = "/mesh/jaw_large.obj";
+
+//------------------------------------------------------------------------------
+std::vector<MeshAssetRequest> SimGripperLarge::RequiredMeshes() {
+    return {{RESOURCES_DIRECTORY + JAW_MESH, true}};
+}
+
 SimGripperLarge::SimGripperLarge(const KDL::Frame init_pose)
 {
 
@@ -24,8 +31,7 @@ SimGripperLarge::SimGripperLarge(const KDL::Frame init_pose)
     // create jaw 1
     sim_objects_.emplace_back(new SimObject(ObjectShape::MESH,
                                             ObjectType::DYNAMIC,
-                                            RESOURCES_DIRECTORY+
-                                                    "/mesh/jaw_large.obj",
+                                            RESOURCES_DIRECTORY + JAW_MESH,
                                             init_pose,
                                             gripper_density,
                                             gripper_friction));
@@ -44,8 +50,7 @@ SimGripperLarge::SimGripperLarge(const KDL::Frame init_pose)
                                                   -link0_axis_z_offset);
     sim_objects_.emplace_back(new SimObject(ObjectShape::MESH,
                                             ObjectType::DYNAMIC,
-                                            RESOURCES_DIRECTORY+
-                                                    "/mesh/jaw_large.obj",
+                                            RESOURCES_DIRECTORY + JAW_MESH,
                                             gripper_pose,
                                             gripper_density,
                                             gripper_friction));
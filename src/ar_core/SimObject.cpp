@@ -3,7 +3,8 @@
 //
 
 #include "SimObject.h"
-#include "LoadObjGL/LoadMeshFromObj.h"
+#include "MeshAsset.h"
+#include "TextureCache.h"
 #include <kdl/frames.hpp>
 // vtk headers
 #include <vtkPolyDataMapper.h>
@@ -12,24 +13,19 @@
 #include <vtkTransform.h>
 #include <vtkConeSource.h>
 #include <vtkCylinderSource.h>
-#include <vtkOBJReader.h>
-#include <vtkMassProperties.h>
-#include <vtkTriangleFilter.h>
 //for debug message
 #include "ros/ros.h"
 #include <sys/stat.h>
 #include <vtkTexturedSphereSource.h>
-#include <vtkImageReader2Factory.h>
-#include <vtkImageReader.h>
 #include <vtkTransformTextureCoords.h>
 #include <vtkPlaneSource.h>
 #include <vtkTextureMapToPlane.h>
-#include <vtkPNGReader.h>
-#include <vtkJPEGReader.h>
 #include <vtkPolygon.h>
 #include <vtkFloatArray.h>
 #include <vtkPointData.h>
 #include <vtkCellArray.h>
+#include <vtkAlgorithmOutput.h>
+#include <algorithm>
 
 inline bool FileExists (const std::string& name) {
     struct stat buffer;
@@ -52,11 +48,9 @@ SimObject::SimObject(const ObjectShape shape, const ObjectType o_type,
     // for controlling the generated compund mesh set this flag to true
     bool show_compound_mesh = false;
 
-    // Texture
+    // Texture, decoded once and shared (see TextureCache)
     bool textured = false;
 
-    vtkSmartPointer<vtkImageReader2> texture_reader;
-
     if(!texture_address.empty()){
 
         // check if file exists
@@ -69,18 +63,8 @@ SimObject::SimObject(const ObjectShape shape, const ObjectType o_type,
         // check if texture is asked for the correct shape
         if (shape!=SPHERE && shape!=PLANE)
             ROS_WARN("Texture is only supported in SPHERE and PLANE shapes.");
-        else {
+        else
             textured = true;
-            // check the format
-            std::string extension = texture_address.substr(
-                    texture_address.find_last_of('.'), 4);
-            if (extension == ".jpg")
-                texture_reader = vtkSmartPointer<vtkJPEGReader>::New();
-            else if (extension == ".png")
-                texture_reader = vtkSmartPointer<vtkPNGReader>::New();
-            else
-                ROS_WARN("only PNG and JPG texture formats are supported");
-        }
     }
 
     // Mapper
@@ -88,6 +72,10 @@ SimObject::SimObject(const ObjectShape shape, const ObjectType o_type,
             vtkSmartPointer<vtkPolyDataMapper>::New();
     actor_ = vtkSmartPointer<vtkActor>::New();
     double volume = 0.0;
+    // lower resolution versions of the primitives, for the LODs
+    const int lod_resolutions[2] = {16, 8};
+    // inertia of MESH shapes with unit density, not scaled
+    KDL::Vector mesh_inertia = KDL::Vector::Zero();
     std::string shape_string; // for debug report
 
     // -------------------------------------------------------------------------
@@ -180,15 +168,8 @@ SimObject::SimObject(const ObjectShape shape, const ObjectType o_type,
 
             quad->GetPointData()->SetTCoords(textureCoordinates);
 
-            if(textured){
-
-                texture_reader->SetFileName ( texture_address.c_str() );
-                // Apply the texture
-                vtkSmartPointer<vtkTexture> texture =
-                        vtkSmartPointer<vtkTexture>::New();
-                texture->SetInputConnection(texture_reader->GetOutputPort());
-                actor_->SetTexture(texture);
-            }
+            if(textured)
+                actor_->SetTexture(TextureCache::GetTexture(texture_address));
 
             mapper->SetInputData(quad);
 
@@ -215,24 +196,13 @@ SimObject::SimObject(const ObjectShape shape, const ObjectType o_type,
                 source->SetRadius(dimensions[0]);
                 source->SetPhiResolution(30);
                 source->SetThetaResolution(30);
-                // Read texture file
-                vtkSmartPointer<vtkImageReader2Factory> readerFactory =
-                        vtkSmartPointer<vtkImageReader2Factory>::New();
-                vtkImageReader2 *imageReader =
-                        readerFactory->CreateImageReader2(texture_address.c_str());
-                imageReader->SetFileName(texture_address.c_str());
-
-                // Create texture
-                vtkSmartPointer<vtkTexture> texture =
-                        vtkSmartPointer<vtkTexture>::New();
-                texture->SetInputConnection(imageReader->GetOutputPort());
 
                 vtkSmartPointer<vtkTransformTextureCoords> transformTexture =
                         vtkSmartPointer<vtkTransformTextureCoords>::New();
                 transformTexture->SetInputConnection(source->GetOutputPort());
                 transformTexture->SetPosition(translate);
                 mapper->SetInputConnection(transformTexture->GetOutputPort());
-                actor_->SetTexture( texture );
+                actor_->SetTexture(TextureCache::GetTexture(texture_address));
 
             } else {
                 // VTK actor_
@@ -243,10 +213,21 @@ SimObject::SimObject(const ObjectShape shape, const ObjectType o_type,
                 source->SetPhiResolution(30);
                 source->SetThetaResolution(30);
                 mapper->SetInputConnection(source->GetOutputPort());
+
+                for (int res : lod_resolutions) {
+                    vtkSmartPointer<vtkSphereSource> lod_source =
+                            vtkSmartPointer<vtkSphereSource>::New();
+                    lod_source->SetRadius(dimensions[0]);
+                    lod_source->SetPhiResolution(res);
+                    lod_source->SetThetaResolution(res);
+                    AddLODMapper(lod_source->GetOutputPort());
+                }
             }
 
 
 
+            bounding_radius_ = dimensions[0];
+
             // Bullet Shape
             collision_shape_ = new btSphereShape(btScalar(B_DIM_SCALE*dimensions[0]));
 
@@ -279,6 +260,17 @@ SimObject::SimObject(const ObjectShape shape, const ObjectType o_type,
             source->SetResolution(30);
             mapper->SetInputConnection(source->GetOutputPort());
 
+            for (int res : lod_resolutions) {
+                vtkSmartPointer<vtkCylinderSource> lod_source =
+                        vtkSmartPointer<vtkCylinderSource>::New();
+                lod_source->SetRadius(dimensions[0]);
+                lod_source->SetHeight(dimensions[1]);
+                lod_source->SetResolution(res);
+                AddLODMapper(lod_source->GetOutputPort());
+            }
+            bounding_radius_ = sqrt(pow(dimensions[0], 2)
+                                    + pow(dimensions[1] / 2, 2));
+
             // Bullet Shape
             collision_shape_ =
                     new btCylinderShape(
@@ -348,6 +340,17 @@ SimObject::SimObject(const ObjectShape shape, const ObjectType o_type,
 
             mapper->SetInputConnection(source->GetOutputPort());
 
+            for (int res : lod_resolutions) {
+                vtkSmartPointer<vtkConeSource> lod_source =
+                        vtkSmartPointer<vtkConeSource>::New();
+                lod_source->SetRadius(dimensions[0]);
+                lod_source->SetHeight(dimensions[1]);
+                lod_source->SetResolution(res);
+                AddLODMapper(lod_source->GetOutputPort());
+            }
+            bounding_radius_ = sqrt(pow(dimensions[0], 2)
+                                    + pow(dimensions[1] / 2, 2));
+
             // Bullet Shape
             collision_shape_ = new btConeShape(
                     btScalar(B_DIM_SCALE*dimensions[0]),
@@ -366,78 +369,73 @@ SimObject::SimObject(const ObjectShape shape, const ObjectType o_type,
         case MESH : {
             // -----------------------------------------------------------------
             // MESH
-            if(o_type!=NOPHYSICS) {
-                if (!FileExists(mesh_address)) {
-                    ROS_ERROR("Can't open mesh file: %s", mesh_address.c_str());
-                    throw std::runtime_error("Can't open mesh file.");
-                } else
-                    ROS_DEBUG("Loading mesh file from at: %s", mesh_address
-                            .c_str());
+            // The files are parsed once (see MeshAsset), graphics and
+            // physics share the parsed buffers.
+            if (!FileExists(mesh_address)) {
+                ROS_ERROR("Can't open mesh file: %s", mesh_address.c_str());
+                throw std::runtime_error("Can't open mesh file.");
+            } else
+                ROS_DEBUG("Loading mesh file from at: %s", mesh_address
+                        .c_str());
 
+            std::shared_ptr<const MeshAsset> mesh =
+                    MeshAsset::Load(mesh_address);
+            std::shared_ptr<const MeshAsset> compound_mesh;
+
+            if(o_type!=NOPHYSICS) {
+                compound_mesh = MeshAsset::LoadDecomposed(mesh_address);
                 collision_shape_ =
-                        LoadCompoundMeshFromObj(mesh_address, B_DIM_SCALE);
+                        compound_mesh->CreateCompoundShape(B_DIM_SCALE);
                 shape_string = collision_shape_->getName();;
             } else
                 collision_shape_ = nullptr;
-            // set name
 
             // -----------------------------
-            // VTK TODO: We have already read the Mesh object, we should use
-            // the vertices from that instead of reading it again with VTK
-            // reader.
-            vtkSmartPointer<vtkOBJReader> reader =
-                    vtkSmartPointer<vtkOBJReader>::New();
+            // VTK
             // visualize the compound mesh for debug
-            if(show_compound_mesh && o_type!=NOPHYSICS) {
-                size_t last_dot_pos = mesh_address.find_last_of('.');
-
-                std::string file_name_no_extension = mesh_address.substr(
-                        0,last_dot_pos);
-
-                std::stringstream out_name;
-                out_name << file_name_no_extension << "_hacd.obj";
-
-                reader->SetFileName(out_name.str().c_str());
+            if(show_compound_mesh && compound_mesh)
+                mapper->SetInputData(compound_mesh->GetPolyData());
+            else {
+                mapper->SetInputData(mesh->GetPolyData());
+
+                // the decimated meshes are shared by all the objects using
+                // the same file
+                for (int l = 1; l < MeshAsset::N_LODS; ++l) {
+                    vtkSmartPointer<vtkPolyData> lod = mesh->GetLOD(l);
+                    if(lod == mesh->GetPolyData())
+                        break;
+                    vtkSmartPointer<vtkPolyDataMapper> lod_mapper =
+                            vtkSmartPointer<vtkPolyDataMapper>::New();
+                    lod_mapper->SetInputData(lod);
+                    lod_mappers_.push_back(lod_mapper);
+                }
+
+                // farthest corner of the bounding box from the origin
+                double b[6];
+                mesh->GetPolyData()->GetBounds(b);
+                bounding_radius_ = sqrt(
+                        pow(std::max(fabs(b[0]), fabs(b[1])), 2)
+                        + pow(std::max(fabs(b[2]), fabs(b[3])), 2)
+                        + pow(std::max(fabs(b[4]), fabs(b[5])), 2));
             }
-            else
-                reader->SetFileName(mesh_address.c_str());
-
-            reader->Update();
-            mapper->SetInputConnection(reader->GetOutputPort());
-
-            // calculate the volume
-            vtkSmartPointer<vtkMassProperties> Mass =
-                    vtkSmartPointer<vtkMassProperties>::New();
-            vtkSmartPointer<vtkTriangleFilter> tri_filt =
-                    vtkSmartPointer<vtkTriangleFilter>::New();
-            tri_filt->SetInputConnection(reader->GetOutputPort());
-            Mass->SetInputConnection(tri_filt->GetOutputPort());
-            volume = Mass->GetVolume();
-            //            // transform would be necesary at this stage if
-            // cellLocator is going to be used
-            //            vtkSmartPointer<vtkTransform> transform =
-            //                    vtkSmartPointer<vtkTransform>::New();
-            //            transform->Translate(0.050, 0.060, 0.025);
-            //            transform->RotateX(180);
-            //            transform->RotateZ(150);
-            //
-            //            vtkSmartPointer<vtkTransformPolyDataFilter> transformFilter =
-            //                    vtkSmartPointer<vtkTransformPolyDataFilter>::New();
-            //            transformFilter->SetInputConnection(
-            //                    reader->GetOutputPort());
-            //            transformFilter->SetTransform(transform);
-            //            transformFilter->Update();
-            //
-            //            vtkSmartPointer<vtkPolyDataMapper> mapper =
-            //                    vtkSmartPointer<vtkPolyDataMapper>::New();
-            //            mapper->SetInputConnection(
-            //                    transformFilter->GetOutputPort());
+
+            // mass properties from the original mesh
+            volume = mesh->GetVolume();
+            mesh_inertia = mesh->GetInertiaDiagonal();
+            if(o_type == DYNAMIC && density > 0.0
+               && mesh->GetCenterOfMass().Norm() > 0.1 * bounding_radius_)
+                ROS_DEBUG("Mesh %s is not centred on its center of mass "
+                                  "(offset %f), see the MESH note in "
+                                  "SimObject.h", mesh_address.c_str(),
+                          mesh->GetCenterOfMass().Norm());
 
             break;
         }
     }
 
     actor_->SetMapper(mapper);
+    // level 0 is the full resolution mapper
+    lod_mappers_.insert(lod_mappers_.begin(), mapper);
 
     //--------------------------------------------------------------------------
     // set up dynamics
@@ -451,12 +449,20 @@ SimObject::SimObject(const ObjectShape shape, const ObjectType o_type,
         bool isStatic = (bt_mass == 0.f);
         btVector3 local_inertia(0, 0, 0);
 
-        if (isStatic)
-            actor_->SetUserMatrix(KDLFrameToVTKMatrix(pose));
-
-        if (!isStatic && (object_type_ != ObjectType::KINEMATIC))
-            // Set initial pose of graphical representation
-            collision_shape_->calculateLocalInertia(bt_mass, local_inertia);
+        if (!isStatic && (object_type_ != ObjectType::KINEMATIC)) {
+            // the inertia of meshes is computed from the actual mesh, the
+            // compound shape would only give that of its bounding box
+            if (shape == MESH)
+                local_inertia = btVector3(
+                        btScalar(density * B_DIM_SCALE * B_DIM_SCALE
+                                 * mesh_inertia.x()),
+                        btScalar(density * B_DIM_SCALE * B_DIM_SCALE
+                                 * mesh_inertia.y()),
+                        btScalar(density * B_DIM_SCALE * B_DIM_SCALE
+                                 * mesh_inertia.z()));
+            else
+                collision_shape_->calculateLocalInertia(bt_mass, local_inertia);
+        }
 
         // ensure zero mass when Kinematic
         if (object_type_ == ObjectType::KINEMATIC)
@@ -531,6 +537,49 @@ SimObject::~SimObject() {
 }
 
 
+//------------------------------------------------------------------------------
+void SimObject::AddLODMapper(vtkAlgorithmOutput *source) {
+
+    vtkSmartPointer<vtkPolyDataMapper> lod_mapper =
+            vtkSmartPointer<vtkPolyDataMapper>::New();
+    lod_mapper->SetInputConnection(source);
+    lod_mappers_.push_back(lod_mapper);
+}
+
+//------------------------------------------------------------------------------
+void SimObject::SelectLOD(const double *eye, const double pixels_per_unit) {
+
+    // projected diameters (in pixels) above which the levels 0 and 1 are used
+    const double lod_pixel_thresholds[2] = {150.0, 50.0};
+
+    if(lod_mappers_.size() < 2 || instanced)
+        return;
+
+    double center[3] = {0.0, 0.0, 0.0};
+    vtkMatrix4x4 *m = actor_->GetUserMatrix();
+    if(m)
+        for (int i = 0; i < 3; ++i)
+            center[i] = m->GetElement(i, 3);
+
+    double distance = sqrt(pow(center[0] - eye[0], 2)
+                           + pow(center[1] - eye[1], 2)
+                           + pow(center[2] - eye[2], 2));
+    double pixels = 2.0 * bounding_radius_ * pixels_per_unit
+                    / std::max(distance, 1e-6);
+
+    size_t level = 2;
+    if(pixels > lod_pixel_thresholds[0])
+        level = 0;
+    else if(pixels > lod_pixel_thresholds[1])
+        level = 1;
+    level = std::min(level, lod_mappers_.size() - 1);
+
+    if(level != lod_level_) {
+        actor_->SetMapper(lod_mappers_[level]);
+        lod_level_ = level;
+    }
+}
+
 //------------------------------------------------------------------------------
 void SimObject::SetKinematicPose(const KDL::Frame & pose) {
 
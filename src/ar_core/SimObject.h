@@ -7,8 +7,11 @@
 
 #include "BulletVTKMotionState.h"
 #include <btBulletDynamicsCommon.h>
+#include <vtkPolyDataMapper.h>
 #include <vector>
 
+class vtkAlgorithmOutput;
+
 /**
  * \class SimObject
  * \brief This class represents a simulated object with graphics and physics.
@@ -60,6 +63,12 @@
  * To check how the generated compound object looks like, you can either open
  * the generated <filename>_hacd.obj in blender or set the show_compound_mesh
  * boolean to true in the constructor of SimObject.
+ * Bullet puts the center of mass of a body at its origin, and the inertia of
+ * a mesh is computed about the origin of the file (see MeshAsset). So the
+ * meshes of dynamic objects must be centred on their center of mass, or
+ * gravity and rotations act about the wrong point. The bodies are not moved
+ * to the center of mass because the constraints (e.g. the jaws of the
+ * grippers) are defined in the frame of the mesh.
  *
  * \attention Dimension scaling: We were interested in objects with
  * dimensions in the order of a few millimiters. It turned out that the bullet
@@ -134,6 +143,14 @@ public:
 
     ~SimObject();
 
+    /**
+    * SimObjects, like the bullet objects they own, are allocated in the
+    * arena of the task being constructed (see TaskArena).
+    */
+    static void * operator new(size_t size) { return TaskArena::Allocate(size); }
+
+    static void operator delete(void *ptr) { TaskArena::Free(ptr); }
+
     /**
     * Returns the rigid body member of the object.
     */
@@ -159,21 +176,53 @@ public:
     */
     KDL::Frame GetPose();
 
+    /**
+    * Returns the motion state connecting the body to the actor (nullptr for
+    * NOPHYSICS objects).
+    */
+    BulletVTKMotionState* GetMotionState() { return motion_state_; };
+
     ObjectType GetObjectType(){return object_type_;}
 
+    /**
+    * Level of detail: spheres, cylinders, cones and meshes have lower
+    * resolution versions. The one used is chosen from the size of the
+    * object on the screen: eye is the position of the camera and
+    * pixels_per_unit the number of pixels covered by a unit length at unit
+    * distance (see Rendering::GetMainViewProjection). Called by the task
+    * before each render.
+    */
+    void SelectLOD(const double *eye, double pixels_per_unit);
+
     void DisableShadow(bool in){with_shadow=in;};
     
     bool IsShadowOn(){return with_shadow;};
-    
+
+    // Instanced objects are rendered by a SimObjectInstancer, so their actor
+    // is not added to the scene.
+    void SetInstanced(bool in){instanced=in;};
+
+    bool IsInstanced(){return instanced;};
+
+private:
+
+    void AddLODMapper(vtkAlgorithmOutput *source);
+
 private:
 
     int id_;
     ObjectType                   object_type_;
-    btRigidBody *                rigid_body_;
+    btRigidBody *                rigid_body_ = nullptr;
     vtkSmartPointer<vtkActor>    actor_;
-    BulletVTKMotionState  *      motion_state_;
-    btCollisionShape *           collision_shape_;
+    BulletVTKMotionState  *      motion_state_ = nullptr;
+    btCollisionShape *           collision_shape_ = nullptr;
     bool                         with_shadow = true;
+    bool                         instanced = false;
+    // lod_mappers_[0] is the full resolution
+    std::vector<vtkSmartPointer<vtkPolyDataMapper> > lod_mappers_;
+    size_t                       lod_level_ = 0;
+    // radius of a sphere centered at the origin of the object enclosing it
+    double                       bounding_radius_ = 0.0;
 };
 
 // -----------------------------------------------------------------------------
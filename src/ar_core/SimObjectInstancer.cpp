@@ -0,0 +1,111 @@
+//
+// Created by charm on 19/10/26.
+//
+
+#include "SimObjectInstancer.h"
+#include <vtkPoints.h>
+#include <vtkPointData.h>
+#include <vtkProperty.h>
+#include <vtkTransform.h>
+#include <vtkMatrix4x4.h>
+#include <vtkAlgorithm.h>
+#include <stdexcept>
+
+
+// -----------------------------------------------------------------------------
+SimObjectInstancer::SimObjectInstancer()
+        :
+        actor(vtkSmartPointer<vtkActor>::New()),
+        mapper(vtkSmartPointer<vtkGlyph3DMapper>::New()),
+        instance_data(vtkSmartPointer<vtkPolyData>::New()),
+        orientations(vtkSmartPointer<vtkFloatArray>::New()),
+        colors(vtkSmartPointer<vtkUnsignedCharArray>::New())
+{
+    instance_data->SetPoints(vtkSmartPointer<vtkPoints>::New());
+
+    // rotation angles in degrees, applied like the orientation of a vtkProp3D
+    orientations->SetNumberOfComponents(3);
+    orientations->SetName("Orientation");
+    instance_data->GetPointData()->AddArray(orientations);
+
+    colors->SetNumberOfComponents(3);
+    colors->SetName("Colors");
+    instance_data->GetPointData()->AddArray(colors);
+
+    mapper->SetInputData(instance_data);
+    mapper->SetOrientationArray("Orientation");
+    mapper->SetOrientationModeToRotation();
+    mapper->ScalingOff();
+    mapper->SetScalarModeToUsePointFieldData();
+    mapper->SelectColorArray("Colors");
+    mapper->ScalarVisibilityOn();
+
+    actor->SetMapper(mapper);
+}
+
+// -----------------------------------------------------------------------------
+int SimObjectInstancer::AddInstance(SimObject *obj) {
+
+    if(obj->GetObjectType() == NOVISUALS)
+        throw std::runtime_error("SimObjectInstancer: NOVISUALS objects can "
+                                         "not be instanced.");
+
+    vtkSmartPointer<vtkActor> obj_actor = obj->GetActor();
+
+    // the first object defines the geometry and the look of all
+    if(instances.empty()) {
+        vtkAlgorithm *source = obj_actor->GetMapper()->GetInputAlgorithm();
+        source->Update();
+        mapper->SetSourceData(
+                vtkPolyData::SafeDownCast(source->GetOutputDataObject(0)));
+
+        actor->GetProperty()->DeepCopy(obj_actor->GetProperty());
+        actor->SetTexture(obj_actor->GetTexture());
+        with_shadow = obj->IsShadowOn();
+    }
+
+    obj->SetInstanced(true);
+    instances.push_back(obj);
+
+    instance_data->GetPoints()->SetNumberOfPoints(vtkIdType(instances.size()));
+    orientations->SetNumberOfTuples(vtkIdType(instances.size()));
+    colors->SetNumberOfTuples(vtkIdType(instances.size()));
+    Update();
+
+    return int(instances.size()) - 1;
+}
+
+// -----------------------------------------------------------------------------
+void SimObjectInstancer::Update() {
+
+    vtkPoints *points = instance_data->GetPoints();
+    double orientation[3];
+    double rgb[3];
+
+    for (size_t i = 0; i < instances.size(); ++i) {
+
+        vtkSmartPointer<vtkActor> obj_actor = instances[i]->GetActor();
+
+        // the motion state of the object keeps the user matrix up to date
+        vtkMatrix4x4 *m = obj_actor->GetUserMatrix();
+        if(m) {
+            points->SetPoint(vtkIdType(i), m->GetElement(0, 3),
+                             m->GetElement(1, 3), m->GetElement(2, 3));
+            vtkTransform::GetOrientation(orientation, m);
+        }
+        else {
+            points->SetPoint(vtkIdType(i), 0.0, 0.0, 0.0);
+            orientation[0] = orientation[1] = orientation[2] = 0.0;
+        }
+        orientations->SetTuple(vtkIdType(i), orientation);
+
+        obj_actor->GetProperty()->GetColor(rgb);
+        colors->SetTuple3(vtkIdType(i), 255.0 * rgb[0], 255.0 * rgb[1],
+                          255.0 * rgb[2]);
+    }
+
+    points->Modified();
+    orientations->Modified();
+    colors->Modified();
+    instance_data->Modified();
+}
@@ -0,0 +1,64 @@
+//
+// Created by charm on 19/10/26.
+//
+
+#ifndef ATAR_SIMOBJECTINSTANCER_H
+#define ATAR_SIMOBJECTINSTANCER_H
+
+#include "SimObject.h"
+#include <vtkActor.h>
+#include <vtkGlyph3DMapper.h>
+#include <vtkPolyData.h>
+#include <vtkFloatArray.h>
+#include <vtkUnsignedCharArray.h>
+#include <vtkSmartPointer.h>
+#include <vector>
+
+/**
+ * \class SimObjectInstancer
+ * \brief Renders many SimObjects that share the same geometry with one
+ * actor and one vtkGlyph3DMapper, i.e. one draw call for all of them
+ * instead of one per object.
+ *
+ * The geometry and the properties of the actor (specular, texture, ...) are
+ * taken from the first object added. Each instance keeps its own pose and
+ * colour, which are read from the actor of its SimObject at every Update,
+ * so the task can keep using SetKinematicPose and
+ * GetActor()->GetProperty()->SetColor as before. Opacity and visibility of
+ * single instances are not supported.
+ *
+ * Usage: add the objects to the instancer BEFORE calling
+ * AddSimObjectToTask for them (so that their own actors are not added to
+ * the scene) and give the instancer to the task with
+ * SimTask::AddSimObjectInstancerToTask. The task calls Update before
+ * rendering.
+ */
+class SimObjectInstancer {
+public:
+
+    SimObjectInstancer();
+
+    // Returns the index of the instance
+    int AddInstance(SimObject *obj);
+
+    // Copies the poses and colours of the instances to the mapper input
+    void Update();
+
+    vtkSmartPointer<vtkActor> GetActor() { return actor; };
+
+    bool IsShadowOn() { return with_shadow; };
+
+private:
+
+    std::vector<SimObject *>                instances;
+    bool                                    with_shadow = true;
+
+    vtkSmartPointer<vtkActor>               actor;
+    vtkSmartPointer<vtkGlyph3DMapper>       mapper;
+    vtkSmartPointer<vtkPolyData>            instance_data;
+    vtkSmartPointer<vtkFloatArray>          orientations;
+    vtkSmartPointer<vtkUnsignedCharArray>   colors;
+};
+
+
+#endif //ATAR_SIMOBJECTINSTANCER_H
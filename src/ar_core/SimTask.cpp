@@ -4,6 +4,7 @@
 
 #include <ros/ros.h>
 #include <boost/thread/thread.hpp>
+#include <map>
 #include "SimTask.h"
 
 
@@ -35,6 +36,11 @@ void SimTask::InitBullet() {
     ///btDbvtBroadphase is a good general purpose broadphase. You can also try out btAxis3Sweep.
     overlappingPairCache = std::make_unique<btDbvtBroadphase>();
 
+    // ghost objects get their overlaps from broadphase pair events
+    ghost_pair_callback = std::make_unique<btGhostPairCallback>();
+    overlappingPairCache->getOverlappingPairCache()
+            ->setInternalGhostPairCallback(ghost_pair_callback.get());
+
     ///the default constraint solver. For parallel processing you can use a different solver (see Extras/BulletMultiThreaded)
     solver = std::make_unique<btSequentialImpulseConstraintSolver>();
 
@@ -46,6 +52,9 @@ void SimTask::InitBullet() {
 
     dynamics_world->setGravity(btVector3(0, 0, -10));
 
+    dynamics_world->setInternalTickCallback(&SimTask::InternalTickCallback,
+                                            this);
+
 
     btContactSolverInfo& info = dynamics_world->getSolverInfo();
     //optionally set the m_splitImpulsePenetrationThreshold (only used when m_splitImpulse  is enabled)
@@ -62,18 +71,32 @@ void SimTask::InitBullet() {
 // -----------------------------------------------------------------------------
 void SimTask::StepWorld() {
 
-    // render
-    if(graphics)
-        graphics->Render();
-    else
+    if(!graphics)
         throw std::runtime_error("Oops! It seems that the graphics was "
                                          "not constructed.");
 
+    // refresh the cameras first so that the stamp of the background images
+    // is known in the task loop (see Rendering::GetPoseSyncTime)
+    graphics->UpdateCameraViewForActualWindowSize();
+
     // step the world
     StepPhysics();
 
     // call the task loop
     TaskLoop();
+
+    // the instanced objects are drawn from the poses after the task loop
+    for (auto &instancer : instancers)
+        instancer->Update();
+
+    // choose the level of detail of the objects from their size on screen
+    double eye[3], pixels_per_unit;
+    graphics->GetMainViewProjection(eye, pixels_per_unit);
+    for (auto obj : lod_objs)
+        obj->SelectLOD(eye, pixels_per_unit);
+
+    // render
+    graphics->Render();
 }
 
 // -----------------------------------------------------------------------------
@@ -89,6 +112,15 @@ void SimTask::StepPhysics() {
                                          "not constructed.");
     time_last = ros::Time::now();
 
+    // one update of the actors per frame, however many substeps were taken
+    pose_sync.Gather(sim_objs);
+    pose_sync.Apply();
+}
+
+// -----------------------------------------------------------------------------
+void SimTask::InternalTickCallback(btDynamicsWorld *world,
+                                   btScalar time_step) {
+    static_cast<SimTask*>(world->getWorldUserInfo())->PhysicsTick(time_step);
 }
 
 
@@ -110,6 +142,8 @@ SimTask::~SimTask() {
         //delete dynamics world
     for(auto i:sim_objs)
         delete i;
+    for(auto i:scene_visual_objs)
+        delete i;
     delete dynamics_world;
 
 }
@@ -117,12 +151,13 @@ SimTask::~SimTask() {
 void SimTask::AddSimObjectToTask(SimObject *obj) {
 
     if(obj) {
-        if (obj->GetObjectType() != NOVISUALS) {
+        if (obj->GetObjectType() != NOVISUALS && !obj->IsInstanced()) {
             if (graphics)
                 graphics->AddActorToScene(obj->GetActor(), obj->IsShadowOn());
             else
                 throw std::runtime_error("Oops! It seems that the graphics was "
                                                  "not constructed.");
+            lod_objs.push_back(obj);
         }
 
         if (obj->GetObjectType() != NOPHYSICS) {
@@ -146,6 +181,48 @@ void SimTask::AddSimMechanismToTask(SimMechanism *mech) {
 
 }
 
+void SimTask::AddSimObjectInstancerToTask(SimObjectInstancer *instancer) {
+
+    if(instancer) {
+        if (graphics)
+            graphics->AddActorToScene(instancer->GetActor(),
+                                      instancer->IsShadowOn());
+        else
+            throw std::runtime_error("Oops! It seems that the graphics was "
+                                             "not constructed.");
+        instancers.emplace_back(instancer);
+    }
+}
+
+std::vector<SimObject*> SimTask::AddSceneToTask(const SceneDescription &scene) {
+
+    std::vector<SimObject*> objects = scene.CreateSimObjects();
+
+    // the instances must be known before the objects are added
+    std::map<std::string, SimObjectInstancer*> groups;
+    for (size_t i = 0; i < objects.size(); ++i) {
+        const std::string &group = scene.objects[i].instance_group;
+        if(group.empty() || objects[i]->GetObjectType() == NOVISUALS)
+            continue;
+        SimObjectInstancer *&instancer = groups[group];
+        if(!instancer)
+            instancer = new SimObjectInstancer;
+        instancer->AddInstance(objects[i]);
+    }
+
+    sim_objs.reserve(sim_objs.size() + objects.size());
+    for (auto obj : objects) {
+        AddSimObjectToTask(obj);
+        if(obj->GetObjectType() == NOPHYSICS)
+            scene_visual_objs.push_back(obj);
+    }
+
+    for (auto &group : groups)
+        AddSimObjectInstancerToTask(group.second);
+
+    return objects;
+}
+
 void SimTask::HapticsThread() {
 
     ros::Rate loop_rate(60);
@@ -13,9 +13,14 @@
 #include <vector>
 #include <kdl/frames.hpp>
 #include <btBulletDynamicsCommon.h>
+#include <BulletCollision/CollisionDispatch/btGhostObject.h>
 #include "Rendering.h"
 #include "SimObject.h"
 #include "SimMechanism.h"
+#include "SimObjectInstancer.h"
+#include "PoseSyncBuffer.h"
+#include "SceneDescription.h"
+#include "MeshAsset.h"
 #include "Colors.hpp"
 #include <memory>
 //#include "sss.h"
@@ -23,6 +28,9 @@
 extern std::string                      RESOURCES_DIRECTORY;
 
 
+// Every task also declares the meshes its constructor loads in a static
+// RequiredMeshes(), returning MeshAssetRequests. TaskHandler gives them to
+// the AssetPreloader so that they are ready before the task is constructed.
 class SimTask{
 public:
 
@@ -53,8 +61,28 @@ public:
 
     void AddSimMechanismToTask(SimMechanism* mech);
 
+    // The task takes the ownership of the instancer and updates it before
+    // each render.
+    void AddSimObjectInstancerToTask(SimObjectInstancer* instancer);
+
+    // Creates all the objects of the scene and adds them to the task, with
+    // one instancer per instance group. The objects are returned in the
+    // order of the description and are owned by the task.
+    std::vector<SimObject*> AddSceneToTask(const SceneDescription &scene);
+
+protected:
+
+    // Called by bullet after each internal simulation step, i.e. at the
+    // physics rate which is higher than the graphics one. Override it for
+    // things that need to follow the simulation closely, like detecting
+    // events from ghost objects. It runs inside StepPhysics.
+    virtual void PhysicsTick(double /*time_step*/){};
+
 private:
 
+    static void InternalTickCallback(btDynamicsWorld *world,
+                                     btScalar time_step);
+
     // This method is called from the StepWorld loop. The idea is to override
     // this in children tasks.
     virtual void TaskLoop(){};
@@ -74,7 +102,18 @@ protected:
     std::vector<vtkSmartPointer<vtkProp>>   graphics_actors;
 
     std::vector<SimObject*>                 sim_objs;
+    // scene objects without physics (not in sim_objs), deleted with the task
+    std::vector<SimObject*>                 scene_visual_objs;
+    // every object whose actor is in the scene, with or without physics. Their
+    // level of detail is chosen before each render (not owned)
+    std::vector<SimObject*>                 lod_objs;
+    std::vector<std::unique_ptr<SimObjectInstancer>> instancers;
+    // hands the poses of the moved bodies to the actors once per frame
+    PoseSyncBuffer                          pose_sync;
     btDiscreteDynamicsWorld *               dynamics_world;
+    // keeps the overlapping pairs of ghost objects (btPairCachingGhostObject)
+    // up to date. Declared first so that it outlives the broadphase.
+    std::unique_ptr<btGhostPairCallback>                 ghost_pair_callback;
     //make sure to re-use collision shapes among rigid bodies whenever possible!
     std::unique_ptr<btSequentialImpulseConstraintSolver> solver;
     std::unique_ptr<btBroadphaseInterface>               overlappingPairCache;
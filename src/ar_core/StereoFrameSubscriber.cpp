@@ -0,0 +1,106 @@
+//
+// Created by charm on 19/10/26.
+//
+
+#include "StereoFrameSubscriber.h"
+#include "AugmentedCamera.h"
+#include <cv_bridge/cv_bridge.h>
+#include <algorithm>
+#include <stdexcept>
+
+
+// -----------------------------------------------------------------------------
+StereoFrameSubscriber::Layout StereoFrameSubscriber::LayoutFromName(
+        const std::string &name) {
+
+    if(name == "side_by_side")
+        return SIDE_BY_SIDE;
+    if(name == "top_bottom")
+        return TOP_BOTTOM;
+    throw std::runtime_error("Unknown stereo layout '" + name +
+                             "'. Expecting side_by_side or top_bottom.");
+}
+
+// -----------------------------------------------------------------------------
+std::shared_ptr<StereoFrameSubscriber> StereoFrameSubscriber::Get(
+        image_transport::ImageTransport *it, const std::string &topic,
+        const Layout layout) {
+
+    static std::map<std::string, std::weak_ptr<StereoFrameSubscriber> >
+            subscribers;
+
+    std::shared_ptr<StereoFrameSubscriber> subscriber =
+            subscribers[topic].lock();
+    if(!subscriber) {
+        subscriber = std::make_shared<StereoFrameSubscriber>(it, topic,
+                                                             layout);
+        subscribers[topic] = subscriber;
+    }
+    else if(subscriber->layout != layout)
+        throw std::runtime_error("Stereo topic " + topic + " is already "
+                "subscribed to with a different layout.");
+    return subscriber;
+}
+
+// -----------------------------------------------------------------------------
+StereoFrameSubscriber::StereoFrameSubscriber(
+        image_transport::ImageTransport *it, const std::string &topic,
+        const Layout layout)
+        :
+        layout(layout),
+        topic(topic)
+{
+    sub_image = it->subscribe(topic, 1, &StereoFrameSubscriber::ImageCallback,
+                              this);
+    ROS_INFO("Reading the %s stereo images from %s.",
+             layout == SIDE_BY_SIDE ? "side by side" : "top bottom",
+             topic.c_str());
+}
+
+// -----------------------------------------------------------------------------
+void StereoFrameSubscriber::AddCamera(AugmentedCamera *camera,
+                                      const int half) {
+    std::lock_guard<std::mutex> lock(listeners_mutex);
+    listeners.push_back(Listener{camera, half});
+}
+
+// -----------------------------------------------------------------------------
+void StereoFrameSubscriber::RemoveCamera(AugmentedCamera *camera) {
+    std::lock_guard<std::mutex> lock(listeners_mutex);
+    listeners.erase(std::remove_if(listeners.begin(), listeners.end(),
+                                   [camera](const Listener &l) {
+                                       return l.camera == camera;
+                                   }), listeners.end());
+}
+
+// -----------------------------------------------------------------------------
+cv::Rect StereoFrameSubscriber::GetHalfRect(const cv::Size &frame_size,
+                                            const int half) const {
+    if(layout == SIDE_BY_SIDE) {
+        const int width = frame_size.width / 2;
+        return cv::Rect(half * width, 0, width, frame_size.height);
+    }
+    const int height = frame_size.height / 2;
+    return cv::Rect(0, half * height, frame_size.width, height);
+}
+
+// -----------------------------------------------------------------------------
+void StereoFrameSubscriber::ImageCallback(
+        const sensor_msgs::ImageConstPtr &msg) {
+    try
+    {
+        // one conversion for both cameras
+        cv::Mat frame = cv_bridge::toCvCopy(msg, "rgb8")->image;
+        const ros::Time stamp = msg->header.stamp.isZero() ? ros::Time::now()
+                                                           : msg->header.stamp;
+        std::lock_guard<std::mutex> lock(listeners_mutex);
+        for (const auto &listener : listeners)
+            listener.camera->SetImage(
+                    frame, GetHalfRect(frame.size(), listener.half), stamp);
+    }
+    catch (cv_bridge::Exception& e)
+    {
+        ROS_ERROR("Could not convert from '%s' to 'rgb8'.",
+                  msg->encoding.c_str());
+    }
+}
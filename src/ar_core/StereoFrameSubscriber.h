@@ -0,0 +1,80 @@
+//
+// Created by charm on 19/10/26.
+//
+
+#ifndef ATAR_STEREOFRAMESUBSCRIBER_H
+#define ATAR_STEREOFRAMESUBSCRIBER_H
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <ros/ros.h>
+#include <opencv2/core.hpp>
+#include <image_transport/image_transport.h>
+
+class AugmentedCamera;
+
+/**
+ * \class StereoFrameSubscriber
+ * \brief One subscription to a topic carrying the images of both cameras of
+ * a stereo pair in one frame, side by side or top and bottom.
+ *
+ * The AugmentedCameras of the two halves share it (see Get), so each frame
+ * is received and converted once. The cameras are handed the whole frame
+ * and the rectangle of their half; the halves are cv::Mat headers on the
+ * shared buffer, nothing is copied per eye.
+ */
+class StereoFrameSubscriber {
+public:
+
+    enum Layout {
+        SIDE_BY_SIDE,
+        TOP_BOTTOM
+    };
+
+    // "side_by_side" or "top_bottom". Throws for anything else.
+    static Layout LayoutFromName(const std::string &name);
+
+    // The subscriber of topic, created at the first call. It lives as long
+    // as one of the cameras holds it.
+    static std::shared_ptr<StereoFrameSubscriber> Get(
+            image_transport::ImageTransport *it, const std::string &topic,
+            const Layout layout);
+
+    StereoFrameSubscriber(image_transport::ImageTransport *it,
+                          const std::string &topic, const Layout layout);
+
+    // half is 0 for the left (or top) image and 1 for the right (or bottom)
+    // one. The camera's SetImage is called with each new frame, from the
+    // spinner thread.
+    void AddCamera(AugmentedCamera *camera, const int half);
+
+    // Waits for a frame being handed out, so the camera is never called
+    // once this returns.
+    void RemoveCamera(AugmentedCamera *camera);
+
+    // rectangle of a half in a frame of the given size
+    cv::Rect GetHalfRect(const cv::Size &frame_size, const int half) const;
+
+private:
+
+    void ImageCallback(const sensor_msgs::ImageConstPtr &msg);
+
+private:
+
+    struct Listener {
+        AugmentedCamera *   camera;
+        int                 half;
+    };
+
+    Layout                      layout;
+    std::string                 topic;
+    // guards listeners, held while a frame is handed to the cameras
+    std::mutex                  listeners_mutex;
+    std::vector<Listener>       listeners;
+    image_transport::Subscriber sub_image;
+};
+
+
+#endif //ATAR_STEREOFRAMESUBSCRIBER_H
@@ -0,0 +1,124 @@
+//
+// Created by charm on 19/10/26.
+//
+
+#include "TaskArena.h"
+#include <LinearMath/btAlignedAllocator.h>
+#include <cstdlib>
+#include <cstdint>
+#include <algorithm>
+#include <new>
+
+thread_local TaskArena * TaskArena::current = nullptr;
+
+namespace {
+
+// Put in front of every allocation. Its size keeps the returned pointers
+// 16 byte aligned.
+struct alignas(16) AllocationHeader {
+    uint32_t from_arena;
+};
+
+const size_t ALIGNMENT = 16;
+
+size_t RoundUp(const size_t size) {
+    return (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+}
+
+void * BulletAlloc(size_t size) {
+    return TaskArena::Allocate(size);
+}
+
+void BulletFree(void *ptr) {
+    TaskArena::Free(ptr);
+}
+
+}
+
+// -----------------------------------------------------------------------------
+TaskArena::TaskArena(const size_t block_size)
+        :
+        block_size(RoundUp(block_size))
+{ }
+
+// -----------------------------------------------------------------------------
+TaskArena::~TaskArena() {
+    for (auto block : blocks)
+        free(block);
+}
+
+// -----------------------------------------------------------------------------
+TaskArena::Scope::Scope(TaskArena *arena)
+        :
+        previous(TaskArena::current)
+{
+    TaskArena::current = arena;
+}
+
+// -----------------------------------------------------------------------------
+TaskArena::Scope::~Scope() {
+    TaskArena::current = previous;
+}
+
+// -----------------------------------------------------------------------------
+void TaskArena::InstallBulletAllocator() {
+    btAlignedAllocSetCustom(&BulletAlloc, &BulletFree);
+}
+
+// -----------------------------------------------------------------------------
+void * TaskArena::Allocate(const size_t size) {
+
+    const size_t total = sizeof(AllocationHeader) + RoundUp(size);
+
+    AllocationHeader *header;
+    if(current) {
+        header = static_cast<AllocationHeader *>(
+                current->AllocateFromBlocks(total));
+        header->from_arena = 1;
+    }
+    else {
+        header = static_cast<AllocationHeader *>(malloc(total));
+        if(!header)
+            throw std::bad_alloc();
+        header->from_arena = 0;
+    }
+    return header + 1;
+}
+
+// -----------------------------------------------------------------------------
+void TaskArena::Free(void *ptr) {
+
+    if(!ptr)
+        return;
+
+    AllocationHeader *header = static_cast<AllocationHeader *>(ptr) - 1;
+    // arena memory is released with the arena
+    if(!header->from_arena)
+        free(header);
+}
+
+// -----------------------------------------------------------------------------
+void * TaskArena::AllocateFromBlocks(const size_t size) {
+
+    if(size > size_t(block_end - cursor)) {
+        // big allocations get a block of their own so that the current
+        // block is not wasted
+        const size_t new_block_size = std::max(size, block_size);
+        char *block = static_cast<char *>(malloc(new_block_size));
+        if(!block)
+            throw std::bad_alloc();
+        blocks.push_back(block);
+
+        if(size > block_size / 4 && cursor) {
+            allocated_bytes += size;
+            return block;
+        }
+        cursor = block;
+        block_end = block + new_block_size;
+    }
+
+    void *ptr = cursor;
+    cursor += size;
+    allocated_bytes += size;
+    return ptr;
+}
@@ -0,0 +1,83 @@
+//
+// Created by charm on 19/10/26.
+//
+
+#ifndef ATAR_TASKARENA_H
+#define ATAR_TASKARENA_H
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * \class TaskArena
+ * \brief Block allocator holding the physics objects of a task.
+ *
+ * While a task is constructed its arena is made current (TaskArena::Scope)
+ * and the SimObjects, their motion states, and everything bullet allocates
+ * (rigid bodies, shapes, constraints, the arrays of the world, ...) are
+ * carved one after the other from large blocks, so the data that is
+ * touched at every physics step ends up contiguous instead of being spread
+ * over the heap. Freeing an arena allocation does nothing: the memory is
+ * given back all at once, a few blocks, when the arena is destroyed after
+ * the task. The destructors still run as before, they are needed to remove
+ * the bodies from the world and to release the VTK objects.
+ *
+ * Outside of a Scope, and on any other thread, the allocations go to the
+ * heap as usual, e.g. the arrays bullet grows while stepping. Each
+ * allocation carries a small header telling where it comes from, so Free
+ * can be called from any thread and for any pointer returned by Allocate.
+ *
+ * InstallBulletAllocator must be called before anything is allocated by
+ * bullet, since memory bullet got from malloc can not be given to Free.
+ * The arena must outlive every object allocated in it.
+ */
+class TaskArena {
+public:
+
+    explicit TaskArena(size_t block_size = size_t(1) << 20);
+
+    ~TaskArena();
+
+    // Makes an arena the current one of the calling thread for its lifetime.
+    class Scope {
+    public:
+        explicit Scope(TaskArena *arena);
+        ~Scope();
+    private:
+        TaskArena *previous;
+    };
+
+    // Routes btAlignedAlloc/btAlignedFree (thus the new/delete of all the
+    // bullet classes) through Allocate and Free.
+    static void InstallBulletAllocator();
+
+    // 16 byte aligned, from the current arena if any, otherwise the heap.
+    static void * Allocate(size_t size);
+
+    static void Free(void *ptr);
+
+    size_t GetAllocatedBytes() const { return allocated_bytes; };
+
+    size_t GetNumberOfBlocks() const { return blocks.size(); };
+
+private:
+
+    void * AllocateFromBlocks(size_t size);
+
+    TaskArena(const TaskArena &);  // Purposefully not implemented.
+
+    void operator=(const TaskArena &);  // Purposefully not implemented.
+
+private:
+
+    static thread_local TaskArena * current;
+
+    size_t              block_size;
+    std::vector<char *> blocks;
+    char *              cursor = nullptr;
+    char *              block_end = nullptr;
+    size_t              allocated_bytes = 0;
+};
+
+
+#endif //ATAR_TASKARENA_H
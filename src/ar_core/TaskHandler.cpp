@@ -4,6 +4,7 @@
 
 #include "TaskHandler.h"
 #include <custom_conversions/Conversions.h>
+#include <std_msgs/Float32.h>
 #include <src/ar_core/tasks/TaskDemo2.h>
 #include <src/ar_core/tasks/TaskDemo3.h>
 #include <src/ar_core/tasks/TaskDemo4.h>
@@ -15,9 +16,29 @@
 #include "src/ar_core/tasks/TaskRingTransfer.h"
 #include "src/ar_core/tasks/TaskSteadyHand.h"
 #include "src/ar_core/tasks/TaskDemo1.h"
+#include "src/ar_core/tasks/TaskScene.h"
 
 std::string RESOURCES_DIRECTORY;
 
+// -----------------------------------------------------------------------------
+// The meshes each task loads, so that they can be prepared in the
+// background. Each task declares them next to its constructor.
+static std::vector<MeshAssetRequest> GetTaskMeshes(const uint task_id) {
+
+    switch(task_id){
+        case 1: return TaskDemo1::RequiredMeshes();
+        case 2: return TaskDemo2::RequiredMeshes();
+        case 3: return TaskDemo3::RequiredMeshes();
+        case 4: return TaskDemo4::RequiredMeshes();
+        case 5: return TaskSteadyHand::RequiredMeshes();
+        case 6: return TaskRingTransfer::RequiredMeshes();
+        case 7: return TaskDeformable::RequiredMeshes();
+        case 8: return TaskActiveConstraintDesign::RequiredMeshes();
+        case 9: return TaskScene::RequiredMeshes();
+        default: return {};
+    }
+}
+
 // -----------------------------------------------------------------------------
 TaskHandler::TaskHandler(std::string node_name)
         :
@@ -26,6 +47,9 @@ TaskHandler::TaskHandler(std::string node_name)
 
     ros::NodeHandle n(node_name);
 
+    // before any bullet object is created
+    TaskArena::InstallBulletAllocator();
+
     if( ros::console::set_logger_level(ROSCONSOLE_DEFAULT_NAME,
                                        ros::console::levels::Info) )
         ros::console::notifyLoggerLevelsChanged();
@@ -39,6 +63,13 @@ TaskHandler::TaskHandler(std::string node_name)
     subscriber_control_events = n.subscribe(
             "/atar/control_events", 1, &TaskHandler::ControlEventsCallback, this);
 
+    publisher_loading_progress = n.advertise<std_msgs::Float32>(
+            "/atar/task_loading_progress", 1);
+
+    if(n.getParam("task_protocol", task_protocol))
+        ROS_INFO("The task following the running one in the protocol will "
+                         "be preloaded.");
+
     ROS_INFO("Task Handler is ready!");
 
 }
@@ -55,6 +86,29 @@ bool TaskHandler::UpdateWorld() {
     if(new_task_event)
         HandleTaskEvent();
 
+    if(cancel_loading_event) {
+        cancel_loading_event = false;
+        if(task_loading) {
+            preloader.Cancel();
+            task_loading = false;
+            ROS_INFO("Loading of task %u canceled.", requested_task_id);
+
+            // nothing is loading any more, let the gui reset its bar
+            std_msgs::Float32 progress;
+            progress.data = 1.f;
+            publisher_loading_progress.publish(progress);
+        }
+    }
+
+    if(task_loading) {
+        std_msgs::Float32 progress;
+        progress.data = preloader.GetProgress();
+        publisher_loading_progress.publish(progress);
+
+        if(preloader.IsDone())
+            CommitTask();
+    }
+
     // Time performance debug
     ros::Time start =ros::Time::now();
 
@@ -79,22 +133,55 @@ void TaskHandler::HandleTaskEvent() {
 
     if (new_task_event){
 
-        //close tasks if it was already running
-        if(task_ptr)
-            DeleteTask();
-
-        try {
-            StartTask(running_task_id);
-            ROS_DEBUG("Starting new task . ");
-        } catch(const std::exception& e){
-            ROS_ERROR_STREAM("Did not manage to create task. With: "
-                                     << e.what());
-        }
+        // the running task (if any) keeps running while the assets of the
+        // new one are loaded
+        ROS_DEBUG("Preparing task %u", requested_task_id);
+        preloader.Start(GetTaskMeshes(requested_task_id));
+        task_loading = true;
 
         new_task_event = false;
     }
 }
 
+// -----------------------------------------------------------------------------
+void TaskHandler::CommitTask() {
+
+    task_loading = false;
+
+    //close tasks if it was already running
+    if(task_ptr)
+        DeleteTask();
+
+    running_task_id = requested_task_id;
+    try {
+        ros::Time start = ros::Time::now();
+        StartTask(running_task_id);
+        ROS_DEBUG("Started task %u in %.3f s", running_task_id,
+                  (ros::Time::now() - start).toSec());
+    } catch(const std::exception& e){
+        ROS_ERROR_STREAM("Did not manage to create task. With: "
+                                 << e.what());
+    }
+
+    std_msgs::Float32 progress;
+    progress.data = 1.f;
+    publisher_loading_progress.publish(progress);
+
+    PreloadNextTask(running_task_id);
+}
+
+// -----------------------------------------------------------------------------
+void TaskHandler::PreloadNextTask(const uint task_id) {
+
+    for (size_t i = 0; i + 1 < task_protocol.size(); ++i) {
+        if(task_protocol[i] == int(task_id)) {
+            ROS_DEBUG("Preloading task %d", task_protocol[i + 1]);
+            preloader.Start(GetTaskMeshes(uint(task_protocol[i + 1])));
+            return;
+        }
+    }
+}
+
 
 // -----------------------------------------------------------------------------
 void TaskHandler::StartTask(const uint task_id) {
@@ -104,6 +191,11 @@ void TaskHandler::StartTask(const uint task_id) {
     if(task_id>0 && task_id<10)
         ROS_DEBUG("Creating new Task %iu", task_id);
 
+    // everything the task allocates while it is constructed and during its
+    // first step goes to its arena
+    task_arena = std::make_unique<TaskArena>();
+    TaskArena::Scope arena_scope(task_arena.get());
+
     if(task_id ==1){
         task_ptr   = new TaskDemo1();
     }
@@ -123,10 +215,15 @@ void TaskHandler::StartTask(const uint task_id) {
         task_ptr = new TaskActiveConstraintDesign();
     }
     else if(task_id ==9){
+        task_ptr = new TaskScene();
     }
     else if(task_id ==10){
     }
     if(task_ptr) {
+        ROS_DEBUG("Task arena: %lu bytes in %lu blocks",
+                  task_arena->GetAllocatedBytes(),
+                  task_arena->GetNumberOfBlocks());
+
         // assign the tool pose pointers
         ros::spinOnce();
 
@@ -147,10 +244,12 @@ void TaskHandler::DeleteTask() {
     sleep.sleep();
     delete task_ptr;
     task_ptr = nullptr;
+    task_arena.reset();
 }
 
 // -----------------------------------------------------------------------------
 void TaskHandler::Cleanup() {
+    preloader.Cancel();
     DeleteTask();
 }
 
@@ -170,6 +269,10 @@ void TaskHandler::ControlEventsCallback(const std_msgs::Int8ConstPtr
             task_ptr->ResetCurrentAcquisition();
             break;
 
+        case CE_CANCEL_TASK_LOADING:
+            cancel_loading_event = true;
+            break;
+
         case CE_PUBLISH_IMGS_ON:
 //            publish_overlayed_images = true;
             break;
@@ -190,42 +293,47 @@ void TaskHandler::ControlEventsCallback(const std_msgs::Int8ConstPtr
             break;
 
         case CE_START_TASK1:
-            running_task_id = 1;
+            requested_task_id = 1;
             new_task_event = true;
             break;
 
         case CE_START_TASK2:
-            running_task_id = 2;
+            requested_task_id = 2;
             new_task_event = true;
             break;
 
         case CE_START_TASK3:
-            running_task_id = 3;
+            requested_task_id = 3;
             new_task_event = true;
             break;
 
         case CE_START_TASK4:
-            running_task_id = 4;
+            requested_task_id = 4;
             new_task_event = true;
             break;
 
         case CE_START_TASK5:
-            running_task_id = 5;
+            requested_task_id = 5;
             new_task_event = true;
             break;
 
         case CE_START_TASK6:
-            running_task_id = 6;
+            requested_task_id = 6;
             new_task_event = true;
             break;
 
         case CE_START_TASK7:
-            running_task_id = 7;
+            requested_task_id = 7;
             new_task_event = true;
             break;
 
         case CE_START_TASK8:
-            running_task_id = 8;
+            requested_task_id = 8;
+            new_task_event = true;
+            break;
+
+        case CE_START_TASK9:
+            requested_task_id = 9;
             new_task_event = true;
             break;
 
@@ -7,12 +7,24 @@
 
 #include "SimTask.h"
 #include "Rendering.h"
+#include "AssetPreloader.h"
+#include "TaskArena.h"
 #include <boost/thread/thread.hpp>
 #include <std_msgs/Int8.h>
 #include "ros/ros.h"
 
 // This class loads the tasks. Its UpdateWorld method is called from the
 // main and TaskHandler checks for control commands from the gui node.
+//
+// A task is loaded in two phases: first its meshes are prepared in the
+// background by an AssetPreloader while the current task keeps running,
+// then, once they are ready, the old task is deleted and the new one is
+// constructed on the render thread, which is now short since the meshes
+// are cached. The progress of the preparation is published on
+// /atar/task_loading_progress and CE_CANCEL_TASK_LOADING aborts it.
+// If the ros parameter task_protocol (a list of task ids) is set, the
+// meshes of the task that follows the running one in the list are
+// preloaded as soon as the running task is started.
 
 class TaskHandler {
 public:
@@ -26,10 +38,16 @@ public:
     void ControlEventsCallback(const std_msgs::Int8ConstPtr &msg);
 
 private:
-    // stop the running haptic thread (if any), destruct the previous task
-    // (if any) and start a new task and thread.
+    // start preparing the assets of the requested task
     void HandleTaskEvent();
 
+    // stop the running haptic thread (if any), destruct the previous task
+    // (if any) and start the prepared task and thread.
+    void CommitTask();
+
+    // preload the assets of the task following task_id in the protocol
+    void PreloadNextTask(uint task_id);
+
     // start a new task and thread.
     void StartTask(uint task_id);
 
@@ -42,15 +60,25 @@ private:
 
     SimTask *task_ptr;
 
+    // holds the physics objects of the running task, released after it
+    std::unique_ptr<TaskArena> task_arena;
+
     boost::thread haptics_thread;
 
 
     bool new_task_event = false;
+    bool cancel_loading_event = false;
+    bool task_loading = false;
 
     uint running_task_id;
+    uint requested_task_id;
     int8_t control_event;
 
+    AssetPreloader preloader;
+    std::vector<int> task_protocol;
+
     ros::Subscriber subscriber_control_events;
+    ros::Publisher publisher_loading_progress;
 
 };
 
@@ -0,0 +1,69 @@
+//
+// Created by charm on 19/10/26.
+//
+
+#include "TextureCache.h"
+#include <vtkImageReader2.h>
+#include <vtkImageReader2Factory.h>
+#include <vtkVersion.h>
+#include <ros/ros.h>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+
+
+// -----------------------------------------------------------------------------
+vtkSmartPointer<vtkImageData> TextureCache::LoadImage(
+        const std::string &file_name) {
+
+    static std::mutex cache_mutex;
+    static std::map<std::string, vtkSmartPointer<vtkImageData> > cache;
+
+    std::lock_guard<std::mutex> lock(cache_mutex);
+
+    auto it = cache.find(file_name);
+    if(it != cache.end())
+        return it->second;
+
+    vtkSmartPointer<vtkImageReader2Factory> reader_factory =
+            vtkSmartPointer<vtkImageReader2Factory>::New();
+    vtkSmartPointer<vtkImageReader2> reader;
+    reader.TakeReference(reader_factory->CreateImageReader2(file_name.c_str()));
+    if(!reader) {
+        ROS_ERROR("Unsupported texture file: %s", file_name.c_str());
+        throw std::runtime_error("Can't read texture file.");
+    }
+    reader->SetFileName(file_name.c_str());
+    reader->Update();
+
+    // keep the image only, not the reader
+    vtkSmartPointer<vtkImageData> image = vtkSmartPointer<vtkImageData>::New();
+    image->ShallowCopy(reader->GetOutput());
+
+    int *dims = image->GetDimensions();
+    ROS_DEBUG("Loaded texture %s (%dx%d)", file_name.c_str(), dims[0], dims[1]);
+
+    cache[file_name] = image;
+    return image;
+}
+
+// -----------------------------------------------------------------------------
+vtkSmartPointer<vtkTexture> TextureCache::GetTexture(
+        const std::string &file_name) {
+
+    static std::map<std::string, vtkSmartPointer<vtkTexture> > cache;
+
+    auto it = cache.find(file_name);
+    if(it != cache.end())
+        return it->second;
+
+    vtkSmartPointer<vtkTexture> texture = vtkSmartPointer<vtkTexture>::New();
+    texture->SetInputData(LoadImage(file_name));
+    texture->InterpolateOn();
+#if VTK_MAJOR_VERSION >= 8
+    texture->MipmapOn();
+#endif
+
+    cache[file_name] = texture;
+    return texture;
+}
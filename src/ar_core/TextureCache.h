@@ -0,0 +1,44 @@
+//
+// Created by charm on 19/10/26.
+//
+
+#ifndef ATAR_TEXTURECACHE_H
+#define ATAR_TEXTURECACHE_H
+
+#include <string>
+#include <vtkSmartPointer.h>
+#include <vtkImageData.h>
+#include <vtkTexture.h>
+
+/**
+ * \class TextureCache
+ * \brief Process wide cache of the textures of the SimObjects, keyed by
+ * the path of the image file.
+ *
+ * An image is decoded once and the textures using it share one vtkTexture,
+ * which means one upload to the GPU per render window instead of one per
+ * object and per task. Mipmaps are generated at the upload (VTK 8 and
+ * newer), so textured planes seen at grazing angles do not shimmer.
+ *
+ * Like the MeshAssets, cached entries are never released and must not be
+ * modified: set the properties of the actor, not of the shared texture.
+ */
+class TextureCache {
+public:
+
+    // Decoded image of file_name (PNG, JPG, or anything vtkImageReader2Factory
+    // can read). Can be called from any thread, e.g. to decode the images in
+    // the background before a task is constructed. Throws if the file can
+    // not be read.
+    static vtkSmartPointer<vtkImageData> LoadImage(const std::string &file_name);
+
+    // The shared texture of file_name. Call it from the render thread.
+    static vtkSmartPointer<vtkTexture> GetTexture(const std::string &file_name);
+
+private:
+
+    TextureCache();  // Purposefully not implemented.
+};
+
+
+#endif //ATAR_TEXTURECACHE_H
@@ -0,0 +1,244 @@
+//
+// Created by charm on 19/10/26.
+//
+
+#include "VirtualFixtures.h"
+#include <vtkPolyDataNormals.h>
+#include <vtkCellData.h>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+
+
+// -----------------------------------------------------------------------------
+bool VirtualFixtureSequence::GetDesiredPose(const KDL::Frame &current,
+                                            KDL::Frame &desired) {
+
+    bool active = false;
+    KDL::Frame pose = current;
+    KDL::Frame fixture_desired;
+
+    for (auto &f : fixtures) {
+        if(f->GetDesiredPose(pose, fixture_desired)) {
+            pose = fixture_desired;
+            active = true;
+        }
+    }
+    desired = pose;
+    return active;
+}
+
+
+// -----------------------------------------------------------------------------
+MeshGuidanceFixture::MeshGuidanceFixture(vtkSmartPointer<vtkPolyData> mesh,
+                                         const KDL::Frame &mesh_pose,
+                                         const double radial_distance)
+        :
+        mesh_pose(mesh_pose),
+        mesh_pose_inv(mesh_pose.Inverse()),
+        radial_distance(radial_distance),
+        locator(vtkSmartPointer<vtkCellLocator>::New()),
+        cell(vtkSmartPointer<vtkGenericCell>::New())
+{
+    // build the locator once. It is not updated in the haptics loop.
+    locator->SetDataSet(mesh);
+    locator->BuildLocator();
+}
+
+// -----------------------------------------------------------------------------
+KDL::Vector MeshGuidanceFixture::ClosestPoint(const KDL::Vector &point_in_world){
+
+    // the locator works in the local frame of the mesh
+    KDL::Vector p_local = mesh_pose_inv * point_in_world;
+    double point[3] = {p_local[0], p_local[1], p_local[2]};
+
+    double closest_point[3] = {0.0, 0.0, 0.0};
+    double dist2;
+    vtkIdType cell_id;
+    int sub_id;
+    locator->FindClosestPoint(point, closest_point, cell, cell_id, sub_id,
+                              dist2);
+
+    return mesh_pose * KDL::Vector(closest_point[0], closest_point[1],
+                                   closest_point[2]);
+}
+
+// -----------------------------------------------------------------------------
+bool MeshGuidanceFixture::GetDesiredPose(const KDL::Frame &current,
+                                         KDL::Frame &desired) {
+
+    // Note that we could have used the central point for the orientation
+    // too, but that vector gets pretty small and unstable when we're close
+    // to the desired pose.
+    KDL::Vector radial_x_point = current * KDL::Vector(radial_distance, 0, 0);
+    KDL::Vector radial_y_point = current * KDL::Vector(0, radial_distance, 0);
+
+    KDL::Vector point_x_to_cp = ClosestPoint(radial_x_point) - radial_x_point;
+    KDL::Vector point_y_to_cp = ClosestPoint(radial_y_point) - radial_y_point;
+
+    // degenerate case: the radial points are on the mesh
+    if(point_x_to_cp.Norm() < 1e-9 || point_y_to_cp.Norm() < 1e-9){
+        desired = current;
+        return false;
+    }
+
+    // Desired position puts the center of the frame on the mesh
+    desired.p = ClosestPoint(current.p);
+
+    KDL::Vector desired_x = -point_x_to_cp / point_x_to_cp.Norm();
+    KDL::Vector desired_y = -point_y_to_cp / point_y_to_cp.Norm();
+    KDL::Vector desired_z = desired_x * desired_y;
+
+    // make sure axes are perpendicular and normal
+    desired_z = desired_z / desired_z.Norm();
+    desired_x = desired_y * desired_z;
+    desired_x = desired_x / desired_x.Norm();
+    desired_y = desired_z * desired_x;
+    desired_y = desired_y / desired_y.Norm();
+
+    desired.M = KDL::Rotation(desired_x, desired_y, desired_z);
+    return true;
+}
+
+
+// -----------------------------------------------------------------------------
+GuidanceCurveFixture::GuidanceCurveFixture(std::vector<KDL::Vector> points,
+                                           const bool align_z)
+        :
+        points(std::move(points)),
+        align_z(align_z)
+{
+    if(this->points.size() < 2)
+        throw std::runtime_error("GuidanceCurveFixture needs at least two "
+                                         "points.");
+}
+
+// -----------------------------------------------------------------------------
+bool GuidanceCurveFixture::GetDesiredPose(const KDL::Frame &current,
+                                          KDL::Frame &desired) {
+
+    double min_dist2 = INFINITY;
+    KDL::Vector closest, tangent;
+
+    for (size_t i = 0; i < points.size() - 1; ++i) {
+        KDL::Vector seg = points[i + 1] - points[i];
+        double seg_len2 = KDL::dot(seg, seg);
+        if(seg_len2 < 1e-18)
+            continue;
+
+        double s = KDL::dot(current.p - points[i], seg) / seg_len2;
+        s = std::max(0.0, std::min(1.0, s));
+
+        KDL::Vector cp = points[i] + s * seg;
+        double dist2 = KDL::dot(current.p - cp, current.p - cp);
+        if(dist2 < min_dist2){
+            min_dist2 = dist2;
+            closest = cp;
+            tangent = seg / std::sqrt(seg_len2);
+        }
+    }
+
+    desired = current;
+    if(min_dist2 == INFINITY)
+        return false;
+
+    desired.p = closest;
+
+    if(align_z) {
+        KDL::Vector z = current.M.UnitZ();
+        // the curve has no direction for us, take the closest one
+        if(KDL::dot(z, tangent) < 0)
+            tangent = -tangent;
+        KDL::Vector axis = z * tangent;
+        double angle = std::atan2(axis.Norm(), KDL::dot(z, tangent));
+        desired.M = KDL::Rotation::Rot(axis, angle) * current.M;
+    }
+    return true;
+}
+
+
+// -----------------------------------------------------------------------------
+ForbiddenPlaneFixture::ForbiddenPlaneFixture(const KDL::Vector &point,
+                                             const KDL::Vector &normal)
+        :
+        point(point),
+        normal(normal / normal.Norm())
+{ }
+
+// -----------------------------------------------------------------------------
+bool ForbiddenPlaneFixture::GetDesiredPose(const KDL::Frame &current,
+                                           KDL::Frame &desired) {
+
+    desired = current;
+    double signed_distance = KDL::dot(current.p - point, normal);
+
+    if(signed_distance >= 0.0)
+        return false;
+
+    desired.p = current.p - signed_distance * normal;
+    return true;
+}
+
+
+// -----------------------------------------------------------------------------
+ForbiddenMeshFixture::ForbiddenMeshFixture(vtkSmartPointer<vtkPolyData> mesh,
+                                           const KDL::Frame &mesh_pose,
+                                           const double margin)
+        :
+        mesh_pose(mesh_pose),
+        mesh_pose_inv(mesh_pose.Inverse()),
+        margin(margin),
+        locator(vtkSmartPointer<vtkCellLocator>::New()),
+        cell(vtkSmartPointer<vtkGenericCell>::New())
+{
+    // we need outward cell normals to decide if a point is inside
+    vtkSmartPointer<vtkPolyDataNormals> normals =
+            vtkSmartPointer<vtkPolyDataNormals>::New();
+    normals->SetInputData(mesh);
+    normals->ComputeCellNormalsOn();
+    normals->ComputePointNormalsOff();
+    normals->AutoOrientNormalsOn();
+    normals->SplittingOff();
+    normals->Update();
+
+    mesh_with_normals = normals->GetOutput();
+    cell_normals = mesh_with_normals->GetCellData()->GetNormals();
+    if(cell_normals == nullptr)
+        throw std::runtime_error("ForbiddenMeshFixture could not compute the "
+                                         "normals of the mesh.");
+
+    locator->SetDataSet(mesh_with_normals);
+    locator->BuildLocator();
+}
+
+// -----------------------------------------------------------------------------
+bool ForbiddenMeshFixture::GetDesiredPose(const KDL::Frame &current,
+                                          KDL::Frame &desired) {
+
+    desired = current;
+
+    KDL::Vector p_local = mesh_pose_inv * current.p;
+    double point[3] = {p_local[0], p_local[1], p_local[2]};
+
+    double closest_point[3] = {0.0, 0.0, 0.0};
+    double dist2;
+    vtkIdType cell_id;
+    int sub_id;
+    locator->FindClosestPoint(point, closest_point, cell, cell_id, sub_id,
+                              dist2);
+    if(cell_id < 0)
+        return false;
+
+    double n[3];
+    cell_normals->GetTuple(cell_id, n);
+    KDL::Vector normal(n[0], n[1], n[2]);
+    KDL::Vector cp(closest_point[0], closest_point[1], closest_point[2]);
+
+    // signed distance from the surface, positive outside
+    double signed_distance = KDL::dot(p_local - cp, normal);
+    if(signed_distance >= margin)
+        return false;
+
+    desired.p = mesh_pose * (cp + margin * normal);
+    return true;
+}
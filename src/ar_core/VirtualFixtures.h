@@ -0,0 +1,174 @@
+//
+// Created by charm on 19/10/26.
+//
+
+#ifndef ATAR_VIRTUALFIXTURES_H
+#define ATAR_VIRTUALFIXTURES_H
+
+#include <kdl/frames.hpp>
+#include <vector>
+#include <memory>
+#include <vtkSmartPointer.h>
+#include <vtkPolyData.h>
+#include <vtkCellLocator.h>
+#include <vtkGenericCell.h>
+#include <vtkDataArray.h>
+
+/**
+ * \class VirtualFixture
+ * \brief Base class of the virtual fixtures evaluated in the haptics thread.
+ *
+ * A fixture receives the current pose of the frame it acts on (the tool, or
+ * an object rigidly attached to it like a grasped ring) and writes the pose
+ * that frame should have. The difference between the two is then used as a
+ * guidance or a constraint by the HapticsScheduler.
+ *
+ * GetDesiredPose is called at the haptics rate (500Hz-1kHz), so
+ * implementations must run in bounded time and must not allocate. Anything
+ * expensive (e.g. building cell locators) is done in the constructors.
+ * Fixtures can be chained with VirtualFixtureSequence.
+ *
+ * \attention A fixture instance holds scratch data and must be evaluated
+ * from one thread only.
+ */
+class VirtualFixture {
+public:
+
+    virtual ~VirtualFixture() = default;
+
+    // Returns false if the fixture does not act at the current pose, in that
+    // case desired is set to current.
+    virtual bool GetDesiredPose(const KDL::Frame &current,
+                                KDL::Frame &desired) = 0;
+};
+
+
+/**
+ * \class VirtualFixtureSequence
+ * \brief Applies its fixtures one after the other, each one on the desired
+ * pose of the previous. Put guidance fixtures first and forbidden regions
+ * last so that constraints have the final word.
+ */
+class VirtualFixtureSequence : public VirtualFixture {
+public:
+
+    void AddFixture(std::shared_ptr<VirtualFixture> in){fixtures.push_back(in);};
+
+    bool GetDesiredPose(const KDL::Frame &current,
+                        KDL::Frame &desired) override;
+
+private:
+    std::vector<std::shared_ptr<VirtualFixture> > fixtures;
+};
+
+
+/**
+ * \class MeshGuidanceFixture
+ * \brief Guides a ring-like frame along a thin tube mesh.
+ *
+ * The desired position puts the center of the frame on the closest point of
+ * the mesh. The desired orientation is estimated from two points at
+ * radial_distance along the x and y axes of the frame: the vectors
+ * connecting them to their closest points on the mesh are taken as the
+ * desired x and y axes. This is far from ideal but it works with any
+ * arbitrary tube, not only parametric curves. (Originally written for
+ * TaskSteadyHand.)
+ */
+class MeshGuidanceFixture : public VirtualFixture {
+public:
+
+    // mesh is expressed in its local frame, placed at mesh_pose in the world
+    MeshGuidanceFixture(vtkSmartPointer<vtkPolyData> mesh,
+                        const KDL::Frame &mesh_pose,
+                        double radial_distance);
+
+    bool GetDesiredPose(const KDL::Frame &current,
+                        KDL::Frame &desired) override;
+
+private:
+    KDL::Vector ClosestPoint(const KDL::Vector &point_in_world);
+
+private:
+    KDL::Frame                          mesh_pose;
+    KDL::Frame                          mesh_pose_inv;
+    double                              radial_distance;
+    vtkSmartPointer<vtkCellLocator>     locator;
+    vtkSmartPointer<vtkGenericCell>     cell;
+};
+
+
+/**
+ * \class GuidanceCurveFixture
+ * \brief Guides the frame along a polyline given in the world frame.
+ *
+ * The desired position is the closest point on the curve. If align_z is
+ * true the z axis of the frame is also rotated (minimally) to be parallel
+ * to the tangent of the curve. The cost is linear in the number of
+ * segments, which is fixed at construction.
+ */
+class GuidanceCurveFixture : public VirtualFixture {
+public:
+
+    explicit GuidanceCurveFixture(std::vector<KDL::Vector> points,
+                                  bool align_z = false);
+
+    bool GetDesiredPose(const KDL::Frame &current,
+                        KDL::Frame &desired) override;
+
+private:
+    std::vector<KDL::Vector>    points;
+    bool                        align_z;
+};
+
+
+/**
+ * \class ForbiddenPlaneFixture
+ * \brief The half-space behind a plane is forbidden. The plane is defined
+ * by a point and its normal, which points towards the allowed side.
+ */
+class ForbiddenPlaneFixture : public VirtualFixture {
+public:
+
+    ForbiddenPlaneFixture(const KDL::Vector &point, const KDL::Vector &normal);
+
+    bool GetDesiredPose(const KDL::Frame &current,
+                        KDL::Frame &desired) override;
+
+private:
+    KDL::Vector point;
+    KDL::Vector normal;
+};
+
+
+/**
+ * \class ForbiddenMeshFixture
+ * \brief The inside of a closed mesh (plus margin) is forbidden.
+ *
+ * Whether the frame is inside is decided from the outward normal of the
+ * closest cell, so the mesh must be closed and reasonably convex locally.
+ * When inside, the desired position is the closest point moved out by
+ * margin along the normal.
+ */
+class ForbiddenMeshFixture : public VirtualFixture {
+public:
+
+    // mesh is expressed in its local frame, placed at mesh_pose in the world
+    ForbiddenMeshFixture(vtkSmartPointer<vtkPolyData> mesh,
+                         const KDL::Frame &mesh_pose,
+                         double margin = 0.0);
+
+    bool GetDesiredPose(const KDL::Frame &current,
+                        KDL::Frame &desired) override;
+
+private:
+    KDL::Frame                          mesh_pose;
+    KDL::Frame                          mesh_pose_inv;
+    double                              margin;
+    vtkSmartPointer<vtkPolyData>        mesh_with_normals;
+    vtkDataArray*                       cell_normals;
+    vtkSmartPointer<vtkCellLocator>     locator;
+    vtkSmartPointer<vtkGenericCell>     cell;
+};
+
+
+#endif //ATAR_VIRTUALFIXTURES_H
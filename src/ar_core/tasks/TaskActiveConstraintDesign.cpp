@@ -4,6 +4,14 @@
 
 #include "TaskActiveConstraintDesign.h"
 
+static const std::string KIDNEY_MESH = "/mesh/kidney_half_wire.obj";
+
+//------------------------------------------------------------------------------
+std::vector<MeshAssetRequest> TaskActiveConstraintDesign::RequiredMeshes() {
+    return {{RESOURCES_DIRECTORY + KIDNEY_MESH, false}};
+}
+
+//------------------------------------------------------------------------------
 TaskActiveConstraintDesign::TaskActiveConstraintDesign()
 {
 
@@ -68,7 +76,7 @@ TaskActiveConstraintDesign::TaskActiveConstraintDesign()
 
         // construct the object
         kidney = new SimObject(ObjectShape::MESH, ObjectType::NOPHYSICS,
-                               RESOURCES_DIRECTORY+"/mesh/kidney_half_wire.obj",
+                               RESOURCES_DIRECTORY + KIDNEY_MESH,
                                mesh_pose);
         kidney->GetActor()->GetProperty()->SetColor(colors.BlueDodger);
 
@@ -132,7 +140,7 @@ void TaskActiveConstraintDesign::TaskLoop() {
 
     // get the buttons of the master
     int buttons[1];
-    master->GetButtons(buttons);
+    master->GetButtons(buttons, 1);
 
     // rotate the camera
 //    auto rotate_cam_now = (bool)buttons[1];
@@ -21,6 +21,9 @@ class TaskActiveConstraintDesign : public SimTask {
 public:
     TaskActiveConstraintDesign();
 
+    // The meshes loaded by the constructor (see SimTask)
+    static std::vector<MeshAssetRequest> RequiredMeshes();
+
     ~TaskActiveConstraintDesign() override;
 
     void TaskLoop() override;
@@ -11,7 +11,14 @@
 #include <vtkCellArray.h>
 
 
+//------------------------------------------------------------------------------
+std::vector<MeshAssetRequest> TaskDeformable::RequiredMeshes() {
+    // The soft sphere is read by SimSoftObject, which does not go through
+    // the MeshAsset cache, so there is nothing to prepare.
+    return {};
+}
 
+//------------------------------------------------------------------------------
 TaskDeformable::TaskDeformable()
     :
     time_last(ros::Time::now())
@@ -56,6 +63,7 @@ TaskDeformable::TaskDeformable()
 
     dynamics_world->addRigidBody(board->GetBody());
     graphics_actors.push_back(board->GetActor());
+    dynamic_objs.push_back(board);
 
 
 
@@ -145,6 +153,7 @@ TaskDeformable::TaskDeformable()
 
             dynamics_world->addRigidBody(spheres[i*rows+j]->GetBody());
             graphics_actors.push_back(spheres[i*rows+j]->GetActor());
+            dynamic_objs.push_back(spheres[i*rows+j]);
 
         }
     }
@@ -341,6 +350,11 @@ void TaskDeformable::StepPhysics() {
     dynamics_world->stepSimulation(btScalar(time_step), 60, 1/120.f);
     time_last = ros::Time::now();
 
+    // the motion states only keep the poses, the actors are updated here
+    // as in SimTask::StepPhysics
+    pose_sync.Gather(dynamic_objs);
+    pose_sync.Apply();
+
 
 }
 
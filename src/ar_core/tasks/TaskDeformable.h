@@ -54,6 +54,9 @@ public:
 
     explicit TaskDeformable();
 
+    // The meshes loaded by the constructor (see SimTask)
+    static std::vector<MeshAssetRequest> RequiredMeshes();
+
     ~TaskDeformable();
 
     // returns all the task graphics_actors to be sent to the rendering part
@@ -97,6 +100,10 @@ private:
     SimObject* kine_box;
     SimObject* kine_sphere_0;
     SimObject* kine_sphere_1;
+    // the dynamic rigid bodies, whose actors follow the physics. They are
+    // in the soft body world of this task, not in sim_objs, and are deleted
+    // with it.
+    std::vector<SimObject*> dynamic_objs;
     btSoftRigidDynamicsWorld* dynamics_world;
 
     //keep track of the shapes, we release memory at exit.
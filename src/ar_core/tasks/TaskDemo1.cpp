@@ -5,6 +5,14 @@
 #include "TaskDemo1.h"
 #include <custom_conversions/Conversions.h>
 
+static const std::string MONKEY_MESH = "/mesh/monkey.obj";
+
+//------------------------------------------------------------------------------
+std::vector<MeshAssetRequest> TaskDemo1::RequiredMeshes() {
+    return {{RESOURCES_DIRECTORY + MONKEY_MESH, true}};
+}
+
+//------------------------------------------------------------------------------
 TaskDemo1::TaskDemo1()
 {
 
@@ -85,7 +93,7 @@ TaskDemo1::TaskDemo1()
 
             // construct the object
             monkey = new SimObject(ObjectShape::MESH, ObjectType::DYNAMIC,
-                                 RESOURCES_DIRECTORY+"/mesh/monkey.obj", pose,
+                                 RESOURCES_DIRECTORY + MONKEY_MESH, pose,
                                    density,friction);
             monkey->GetActor()->GetProperty()->SetColor(colors.OrangeDark);
 
@@ -19,6 +19,9 @@ public:
 
     explicit TaskDemo1();
 
+    // The meshes loaded by the constructor (see SimTask)
+    static std::vector<MeshAssetRequest> RequiredMeshes();
+
     // updates the task logic and the graphics_actors
     void TaskLoop() override;
 
@@ -5,6 +5,11 @@
 #include "TaskDemo2.h"
 #include <boost/thread/thread.hpp>
 
+//------------------------------------------------------------------------------
+std::vector<MeshAssetRequest> TaskDemo2::RequiredMeshes() {
+    return SimGripperLarge::RequiredMeshes();
+}
+
 //------------------------------------------------------------------------------
 TaskDemo2::TaskDemo2()
 {
@@ -36,6 +41,10 @@ TaskDemo2::TaskDemo2()
                                 "/gripper_position_current");
     graphics->SetManipulatorInterestedInCamPose(master[1]);
 
+    // report the latency between the camera images and the tool poses
+    graphics->AddSyncedManipulator(master[0]);
+    graphics->AddSyncedManipulator(master[1]);
+
     // DEFINE OBJECTS
     // -------------------------------------------------------------------------
     // Create one SimForceps to be connected to master[0]
@@ -100,14 +109,18 @@ TaskDemo2::~TaskDemo2() {
 //------------------------------------------------------------------------------
 void TaskDemo2::TaskLoop() {
 
+    // the poses are synchronised with the background image in AR, or
+    // predicted to the time the frame will be displayed in VR
+    ros::Time display_time = graphics->GetPoseSyncTime();
+
     // update the pose of the virtual forceps from the real manipulator
-    auto temp_pose = master[0]->GetPoseWorld();
+    auto temp_pose = master[0]->GetPoseWorldAt(display_time);
     // rotate the tool locally
     temp_pose.M.DoRotY(-M_PI/2.);
     gripper->SetPoseAndJawAngle(temp_pose, master[0]->GetGripperAngles());
 
     // update the position of the spherical tool
-    sphere_tool->SetKinematicPose(master[1]->GetPoseWorld());
+    sphere_tool->SetKinematicPose(master[1]->GetPoseWorldAt(display_time));
 }
 
 //------------------------------------------------------------------------------
@@ -18,6 +18,9 @@ public:
 
     explicit TaskDemo2();
 
+    // The meshes loaded by the constructor (see SimTask)
+    static std::vector<MeshAssetRequest> RequiredMeshes();
+
     ~TaskDemo2() override;
 
     // In this demo we use the loop to read the poses of our real
@@ -5,6 +5,14 @@
 #include <vtkAxesActor.h>
 #include "TaskDemo3.h"
 
+static const std::string TEXT_MESH = "/mesh/text.obj";
+
+//------------------------------------------------------------------------------
+std::vector<MeshAssetRequest> TaskDemo3::RequiredMeshes() {
+    return {{RESOURCES_DIRECTORY + TEXT_MESH, false}};
+}
+
+//------------------------------------------------------------------------------
 TaskDemo3::TaskDemo3()
 {
     // create a rendering object with desired parameters. In particular, we
@@ -64,7 +72,7 @@ TaskDemo3::TaskDemo3()
     KDL::Frame pose(KDL::Vector(4*distance, 2*distance, 0.05));
     pose.M.DoRotY(M_PI);
     SimObject *mesh = new SimObject(ObjectShape::MESH, ObjectType::NOPHYSICS,
-                                    RESOURCES_DIRECTORY+"/mesh/text.obj",pose);
+                                    RESOURCES_DIRECTORY + TEXT_MESH,pose);
     mesh->GetActor()->GetProperty()->SetColor(colors.BlueDodger);
     AddSimObjectToTask(mesh);
 
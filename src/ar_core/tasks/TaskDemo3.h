@@ -19,6 +19,9 @@
 class TaskDemo3: public SimTask {
 public:
     explicit TaskDemo3();
+
+    // The meshes loaded by the constructor (see SimTask)
+    static std::vector<MeshAssetRequest> RequiredMeshes();
 };
 
 
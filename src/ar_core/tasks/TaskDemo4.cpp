@@ -6,6 +6,12 @@
 #include <src/ar_core/SimForceps.h>
 #include "TaskDemo4.h"
 
+//------------------------------------------------------------------------------
+std::vector<MeshAssetRequest> TaskDemo4::RequiredMeshes() {
+    return SimGripperLarge::RequiredMeshes();
+}
+
+//------------------------------------------------------------------------------
 TaskDemo4::TaskDemo4() {
 
     graphics = std::make_unique<Rendering>(
@@ -21,6 +27,9 @@ TaskDemo4::TaskDemo4() {
     // for correct calibration, the master needs the pose of the camera
 //    graphics->SetManipulatorInterestedInCamPose(slave[0]);
 
+    // report the latency between the camera images and the tool pose
+    graphics->AddSyncedManipulator(slave[0]);
+
 
     // -------------------------------------------------------------------------
     // Create one SimForceps to be connected to master[0]
@@ -87,7 +96,9 @@ TaskDemo4::TaskDemo4() {
 
 void TaskDemo4::TaskLoop() {
 
-    // update the pose of the virtual forceps from the real manipulator
-    gripper->SetPoseAndJawAngle(slave[0]->GetPoseWorld(),
-                                slave[0]->GetGripperAngles());
+    // update the pose of the virtual forceps from the real manipulator,
+    // synchronised with the background image
+    gripper->SetPoseAndJawAngle(
+            slave[0]->GetPoseWorldAt(graphics->GetPoseSyncTime()),
+            slave[0]->GetGripperAngles());
 }
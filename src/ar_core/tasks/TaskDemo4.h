@@ -13,6 +13,9 @@ class TaskDemo4 : public SimTask {
 public:
     TaskDemo4();
 
+    // The meshes loaded by the constructor (see SimTask)
+    static std::vector<MeshAssetRequest> RequiredMeshes();
+
     void TaskLoop() override;
 
     void StartManipulatorToWorldFrameCalibration(const uint arm_id) override
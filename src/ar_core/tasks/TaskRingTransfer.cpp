@@ -7,7 +7,16 @@
 #include <boost/thread/thread.hpp>
 #include <vtkAxesActor.h>
 
+static const std::string RING_MESH = "/mesh/task_Hook_ring_D2cm_D5mm.obj";
+static const std::string HOOK_MESH = "/mesh/task_hook_hook.obj";
 
+//------------------------------------------------------------------------------
+std::vector<MeshAssetRequest> TaskRingTransfer::RequiredMeshes() {
+    return {{RESOURCES_DIRECTORY + RING_MESH, true},
+            {RESOURCES_DIRECTORY + HOOK_MESH, true}};
+}
+
+//------------------------------------------------------------------------------
 TaskRingTransfer::TaskRingTransfer()
 {
 
@@ -64,6 +73,10 @@ TaskRingTransfer::TaskRingTransfer()
     int cols = 4;
     int rows = 1;
     SimObject *cylinders[cols * rows];
+    // the pegs are all drawn with one instanced actor, and so are the rings
+    auto peg_instancer = new SimObjectInstancer;
+    std::vector<double> peg_dim = {0.002, 0.035};
+    peg_radius = peg_dim[0];
 
     {
         float friction = 2.2;
@@ -71,7 +84,7 @@ TaskRingTransfer::TaskRingTransfer()
 
             for (int j = 0; j < cols; ++j) {
 
-                std::vector<double> dim = {0.002, 0.035};
+                std::vector<double> dim = peg_dim;
 
                 KDL::Frame pose(KDL::Rotation::Quaternion(0, 0.70711,
                                                           0.70711, 0.0),
@@ -90,10 +103,17 @@ TaskRingTransfer::TaskRingTransfer()
                         ->SetSpecular(0.8);
                 cylinders[i*rows+j]->GetActor()->GetProperty()
                         ->SetSpecularPower(50);
+                peg_instancer->AddInstance(cylinders[i * rows + j]);
                 AddSimObjectToTask(cylinders[i * rows + j]);
+
+                PegTrigger peg;
+                peg.pose = pose;
+                peg.height = dim[1];
+                pegs.push_back(std::move(peg));
             }
         }
     }
+    AddSimObjectInstancerToTask(peg_instancer);
 
     // -------------------------------------------------------------------------
     // ROD
@@ -112,12 +132,14 @@ TaskRingTransfer::TaskRingTransfer()
 
     // -------------------------------------------------------------------------
     //// Create smallRING meshes
-    size_t n_rings = 4;
+    const size_t n_rings = 4;
+    static_assert(n_rings <= MAX_RINGS, "Too many rings for the peg masks");
     SimObject *rings[n_rings];
+    auto ring_instancer = new SimObjectInstancer;
     {
         float density = 50000;
         float friction = 5;
-        for (int l = 0; l < n_rings; ++l) {
+        for (size_t l = 0; l < n_rings; ++l) {
 
             KDL::Frame pose(KDL::Rotation::Quaternion(0.70711, 0.70711, 0.0, 0.0),
                             KDL::Vector(0.06 + (double) l * 0.01, 0.03, 0.03));
@@ -125,11 +147,56 @@ TaskRingTransfer::TaskRingTransfer()
 
             rings[l] = new
                     SimObject(ObjectShape::MESH, ObjectType::DYNAMIC,
-                              RESOURCES_DIRECTORY+"/mesh/task_Hook_ring_D2cm_D5mm.obj",
+                              RESOURCES_DIRECTORY + RING_MESH,
                               pose, density, friction);
             rings[l]->GetActor()->GetProperty()->SetColor(0., 0.5, 0.6);
+            ring_instancer->AddInstance(rings[l]);
             AddSimObjectToTask(rings[l]);
 
+            // the index is used to find the ring from the ghost overlaps
+            rings[l]->GetBody()->setUserIndex(int(l));
+            ring_bodies.push_back(rings[l]->GetBody());
+        }
+    }
+    AddSimObjectInstancerToTask(ring_instancer);
+
+    // -------------------------------------------------------------------------
+    // Trigger volumes around the pegs
+    {
+        // the ring mesh has an outer diameter of 2cm and a 5mm thickness
+        double ring_outer_radius = 0.01;
+        ring_inner_radius = ring_outer_radius - 0.005;
+
+        // One shape for all the pegs. Like the peg cylinders, the axis is
+        // along local y. The volume is as wide as the ring so that the
+        // rings around the peg are reported.
+        peg_trigger_shape = std::make_unique<btCylinderShape>(
+                btVector3(btScalar(B_DIM_SCALE * ring_outer_radius),
+                          btScalar(B_DIM_SCALE * peg_dim[1] / 2),
+                          btScalar(B_DIM_SCALE * ring_outer_radius)));
+
+        for (auto &peg : pegs) {
+            peg.ghost = std::make_unique<btPairCachingGhostObject>();
+            peg.ghost->setCollisionShape(peg_trigger_shape.get());
+            peg.ghost->setCollisionFlags(
+                    peg.ghost->getCollisionFlags()
+                    | btCollisionObject::CF_NO_CONTACT_RESPONSE);
+
+            double x, y, z, w;
+            peg.pose.M.GetQuaternion(x, y, z, w);
+            btTransform tr;
+            tr.setRotation(btQuaternion(btScalar(x), btScalar(y),
+                                        btScalar(z), btScalar(w)));
+            tr.setOrigin(btVector3(btScalar(B_DIM_SCALE * peg.pose.p[0]),
+                                   btScalar(B_DIM_SCALE * peg.pose.p[1]),
+                                   btScalar(B_DIM_SCALE * peg.pose.p[2])));
+            peg.ghost->setWorldTransform(tr);
+
+            // only the dynamic bodies can trigger (not the board, the pegs or
+            // the kinematic tools)
+            dynamics_world->addCollisionObject(
+                    peg.ghost.get(), btBroadphaseProxy::SensorTrigger,
+                    btBroadphaseProxy::DefaultFilter);
         }
     }
 // -------------------------------------------------------------------------
@@ -174,7 +241,7 @@ TaskRingTransfer::TaskRingTransfer()
 
         hook_mesh = new
                 SimObject(ObjectShape::MESH, ObjectType::KINEMATIC,
-                          RESOURCES_DIRECTORY+"/mesh/task_hook_hook.obj", pose,
+                          RESOURCES_DIRECTORY + HOOK_MESH, pose,
                           density, 0);
         hook_mesh->GetActor()->GetProperty()->SetColor(1., 1.0, 1.0);
         AddSimObjectToTask(hook_mesh);
@@ -194,8 +261,12 @@ TaskRingTransfer::TaskRingTransfer()
     if(show_ref_frames)
         graphics->AddActorToScene(task_coordinate_axes, false);
 
-    
-    
+    // Publisher for the task state
+    publisher_task_state = nh->advertise<custom_msgs::TaskState>(
+            "/atar/task_state", 10);
+    start_time = ros::Time::now();
+    task_state_msg.task_name = "RingTransfer";
+    task_state_msg.task_state = (uint8_t)RTTaskState::Idle;
 };
 
 //------------------------------------------------------------------------------
@@ -237,14 +308,111 @@ void TaskRingTransfer::TaskLoop() {
 }
 
 
+//------------------------------------------------------------------------------
+void TaskRingTransfer::PhysicsTick(double /*time_step*/) {
+
+    // all the pegs are updated before publishing, so that the events count
+    // the rings of this tick
+    for (size_t peg = 0; peg < pegs.size(); ++peg) {
+
+        PegTrigger &trigger = pegs[peg];
+        btPairCachingGhostObject *ghost = trigger.ghost.get();
+        uint32_t rings_on_peg = 0;
+
+        // only the bodies whose AABB overlap the trigger volume are here
+        for (int i = 0; i < ghost->getNumOverlappingObjects(); ++i) {
+            const btCollisionObject *obj = ghost->getOverlappingObject(i);
+            const int ring = obj->getUserIndex();
+            if (ring < 0 || ring >= int(ring_bodies.size())
+                || ring >= int(MAX_RINGS) || ring_bodies[ring] != obj)
+                continue;
+
+            if(IsRingOnPeg(obj, peg, trigger.radial_distance[ring]))
+                rings_on_peg |= (1u << ring);
+        }
+
+        trigger.changed = rings_on_peg ^ trigger.rings_on_peg;
+        trigger.rings_on_peg = rings_on_peg;
+    }
+
+    for (size_t peg = 0; peg < pegs.size(); ++peg) {
+
+        const PegTrigger &trigger = pegs[peg];
+        if(!trigger.changed)
+            continue;
+
+        for (size_t ring = 0; ring < ring_bodies.size(); ++ring) {
+            if(!(trigger.changed & (1u << ring)))
+                continue;
+            if(trigger.rings_on_peg & (1u << ring))
+                PublishPlacementEvent(RTTaskState::RingPlaced, peg, ring,
+                                      trigger.radial_distance[ring]);
+            else
+                PublishPlacementEvent(RTTaskState::RingRemoved, peg, ring,
+                                      0.0);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+bool TaskRingTransfer::IsRingOnPeg(const btCollisionObject *ring,
+                                   const size_t peg,
+                                   double &radial_distance) const {
+
+    const btVector3 &o = ring->getWorldTransform().getOrigin();
+    KDL::Vector ring_center(o.x() / B_DIM_SCALE, o.y() / B_DIM_SCALE,
+                            o.z() / B_DIM_SCALE);
+
+    // position of the ring center in the peg frame, whose y axis is the
+    // axis of the peg and origin is at the middle of it
+    KDL::Vector p = pegs[peg].pose.Inverse() * ring_center;
+    radial_distance = sqrt(p.x() * p.x() + p.z() * p.z());
+
+    // the peg must go through the hole, and the ring must be lower than the
+    // tip of the peg
+    return radial_distance < ring_inner_radius - peg_radius
+           && fabs(p.y()) < pegs[peg].height / 2;
+}
+
+//------------------------------------------------------------------------------
+void TaskRingTransfer::PublishPlacementEvent(const RTTaskState event,
+                                             const size_t peg,
+                                             const size_t ring,
+                                             const double radial_distance) {
+    size_t n_placed = 0;
+    for (const auto &p : pegs)
+        n_placed += size_t(__builtin_popcount(p.rings_on_peg));
+
+    RTTaskState state = event;
+    if(n_placed == ring_bodies.size())
+        state = RTTaskState::Finished;
+
+    task_state_msg.task_state = (uint8_t)state;
+    task_state_msg.number_of_repetition = (uint8_t)n_placed;
+    task_state_msg.uint_slot = (uint8_t)peg;
+    task_state_msg.time_stamp = (ros::Time::now() - start_time).toSec();
+    task_state_msg.error_field_1 = ring;
+    task_state_msg.error_field_2 = radial_distance;
+    publisher_task_state.publish(task_state_msg);
+
+    ROS_DEBUG("Ring %lu %s peg %lu", ring,
+              event == RTTaskState::RingPlaced ? "placed on" : "removed from",
+              peg);
+}
+
+//------------------------------------------------------------------------------
 custom_msgs::TaskState TaskRingTransfer::GetTaskStateMsg() {
-    custom_msgs::TaskState task_state_msg;
     return task_state_msg;
 }
 
 void TaskRingTransfer::ResetTask() {
     ROS_INFO("Resetting the task.");
-
+    // the rings on the pegs will be reported again at the next step
+    for (auto &peg : pegs)
+        peg.rings_on_peg = 0;
+    start_time = ros::Time::now();
+    task_state_msg.task_state = (uint8_t)RTTaskState::Idle;
+    task_state_msg.number_of_repetition = 0;
 }
 
 void TaskRingTransfer::ResetCurrentAcquisition() {
@@ -293,6 +461,11 @@ void TaskRingTransfer::HapticsThread() {
 
 TaskRingTransfer::~TaskRingTransfer() {
 
+    // the ghost objects are owned here, so take them out of the world before
+    // SimTask cleans it up
+    for (auto &peg : pegs)
+        dynamics_world->removeCollisionObject(peg.ghost.get());
+
     delete master;
 
 }
@@ -17,12 +17,30 @@
 #include <ros/ros.h>
 #include <std_msgs/Empty.h>
 
+/**
+ * Placement of the rings on the pegs is detected with a ghost object
+ * (trigger volume) around each peg. The ghost objects get their overlapping
+ * bodies from the broadphase pair events of bullet, so at each physics step
+ * only the rings that are actually near a peg are checked. When the set of
+ * rings on a peg changes a TaskState message is published on
+ * /atar/task_state:
+ *      task_state           -> RTTaskState of the event
+ *      number_of_repetition -> number of rings on all the pegs
+ *      uint_slot            -> index of the peg
+ *      time_stamp           -> seconds since the start of the task
+ *      error_field_1        -> index of the ring
+ *      error_field_2        -> distance of the ring center from the peg axis
+ */
+enum class RTTaskState: uint8_t {Idle, RingPlaced, RingRemoved, Finished};
 
 class TaskRingTransfer : public SimTask{
 public:
 
     TaskRingTransfer();
 
+    // The meshes loaded by the constructor (see SimTask)
+    static std::vector<MeshAssetRequest> RequiredMeshes();
+
     ~TaskRingTransfer();
 
     // returns all the task graphics_actors to be sent to the rendering part
@@ -51,6 +69,18 @@ public:
   *  **/
     void HapticsThread();
 
+private:
+
+    // Reads the overlaps of the peg ghost objects at physics rate
+    void PhysicsTick(double time_step) override;
+
+    // A ring is on a peg if the peg passes through its hole
+    bool IsRingOnPeg(const btCollisionObject *ring, size_t peg,
+                     double &radial_distance) const;
+
+    void PublishPlacementEvent(RTTaskState event, size_t peg, size_t ring,
+                               double radial_distance);
+
 private:
 
     double board_dimensions[3];
@@ -60,6 +90,31 @@ private:
 
     SimObject *hook_mesh;
 
+    // -------------------------------------------------------------------------
+    // placement detection
+    // the rings on a peg are a bit mask
+    static const size_t                             MAX_RINGS = 32;
+    struct PegTrigger {
+        KDL::Frame                                  pose;
+        double                                      height;
+        std::unique_ptr<btPairCachingGhostObject>   ghost;
+        // bit i is set when ring i is on the peg
+        uint32_t                                    rings_on_peg = 0;
+        // the rings that changed at the last physics tick, and their
+        // distance from the axis
+        uint32_t                                    changed = 0;
+        double                                      radial_distance[MAX_RINGS] = {};
+    };
+    std::vector<PegTrigger>                         pegs;
+    std::unique_ptr<btCylinderShape>                peg_trigger_shape;
+    std::vector<btCollisionObject*>                 ring_bodies;
+    double                                          ring_inner_radius;
+    double                                          peg_radius;
+
+    ros::Time                                       start_time;
+    custom_msgs::TaskState                          task_state_msg;
+    ros::Publisher                                  publisher_task_state;
+
     // -------------------------------------------------------------------------
     // graphics
     // for not we use the same type of active constraint for both arms
@@ -0,0 +1,52 @@
+//
+// Created by charm on 19/10/26.
+//
+
+#include "TaskScene.h"
+#include <custom_conversions/Conversions.h>
+
+// -----------------------------------------------------------------------------
+SceneDescription TaskScene::ReadScene(const ros::NodeHandle &n) {
+
+    std::string scene_file;
+    if(n.getParam("scene_file", scene_file))
+        return SceneDescription::ReadBinary(scene_file);
+    return SceneDescription::FromParameter(n, "scene");
+}
+
+// -----------------------------------------------------------------------------
+std::vector<MeshAssetRequest> TaskScene::RequiredMeshes() {
+
+    // a scene that can not be read is reported when the task is constructed
+    try {
+        return ReadScene(ros::NodeHandle("~")).RequiredMeshes();
+    } catch(const std::exception &) {
+        return {};
+    }
+}
+
+// -----------------------------------------------------------------------------
+TaskScene::TaskScene()
+{
+    ros::NodeHandle n("~");
+
+    SceneDescription scene = ReadScene(n);
+
+    std::string binary_output;
+    if(!n.hasParam("scene_file")
+       && n.getParam("scene_binary_output", binary_output))
+        scene.WriteBinary(binary_output);
+
+    const SceneRenderingDescription &r = scene.rendering;
+    graphics = std::make_unique<Rendering>(
+            r.view_resolution, r.ar_mode, r.n_views, r.one_window_per_view,
+            r.borders_off, r.window_positions);
+
+    if(!r.main_camera_pose.empty()) {
+        KDL::Frame camera_pose;
+        conversions::PoseVectorToKDLFrame(r.main_camera_pose, camera_pose);
+        graphics->SetMainCameraPose(camera_pose);
+    }
+
+    scene_objects = AddSceneToTask(scene);
+}
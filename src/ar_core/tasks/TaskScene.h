@@ -0,0 +1,36 @@
+//
+// Created by charm on 19/10/26.
+//
+
+#ifndef ATAR_TASKSCENE_H
+#define ATAR_TASKSCENE_H
+
+// This task has no logic of its own: it shows the scene described in a
+// file, so that layouts can be tried without recompiling. The scene is
+// either read from the binary file given by the scene_file parameter, or
+// from the scene parameter (a yaml description, see
+// launch/params_scene_example.yaml). In the second case, if the
+// scene_binary_output parameter is set, the scene is also saved there in
+// binary form for the next runs.
+
+#include <src/ar_core/SimTask.h>
+
+class TaskScene: public SimTask {
+public:
+    explicit TaskScene();
+
+    // The meshes loaded by the constructor (see SimTask)
+    static std::vector<MeshAssetRequest> RequiredMeshes();
+
+private:
+
+    // From the scene_file or the scene parameter
+    static SceneDescription ReadScene(const ros::NodeHandle &n);
+
+private:
+
+    std::vector<SimObject*> scene_objects;
+};
+
+
+#endif //ATAR_TASKSCENE_H
@@ -10,7 +10,33 @@
 #include "TaskSteadyHand.h"
 #include <vtkSphereSource.h>
 
+static const std::string STAND_MESH = "/mesh/task_steady_hand_stand.obj";
+static const std::string TUBE_MESH_THIN =
+        "/mesh/task_steady_hand_tube_whole_thin.obj";
+static const std::string RING_MESH =
+        "/mesh/task_steady_hand_torus_D10mm_d1.2mm.obj";
+
+// the m-th quarter of the tube, m in [0, 3]
+static std::string TubeQuarterMesh(const int m) {
+    return "/mesh/task_steady_hand_tube_quarter_mesh" + std::to_string(m + 1)
+           + ".obj";
+}
+
+//------------------------------------------------------------------------------
+std::vector<MeshAssetRequest> TaskSteadyHand::RequiredMeshes() {
+    std::vector<MeshAssetRequest> meshes =
+            {{RESOURCES_DIRECTORY + STAND_MESH, true}};
+    for (int m = 0; m < 4; ++m)
+        meshes.push_back({RESOURCES_DIRECTORY + TubeQuarterMesh(m), true});
+    meshes.push_back({RESOURCES_DIRECTORY + TUBE_MESH_THIN, false});
+    meshes.push_back({RESOURCES_DIRECTORY + RING_MESH, true});
+
+    std::vector<MeshAssetRequest> forceps_meshes = SimForceps::RequiredMeshes();
+    meshes.insert(meshes.end(), forceps_meshes.begin(), forceps_meshes.end());
+    return meshes;
+}
 
+//------------------------------------------------------------------------------
 TaskSteadyHand::TaskSteadyHand()
         :
         destination_ring_counter(0),
@@ -57,8 +83,6 @@ TaskSteadyHand::TaskSteadyHand()
 
     destination_ring_actor = vtkSmartPointer<vtkActor>::New();
 
-    cellLocator = vtkSmartPointer<vtkCellLocator>::New();
-
     line1_source = vtkSmartPointer<vtkLineSource>::New();
 
     line2_source = vtkSmartPointer<vtkLineSource>::New();
@@ -186,7 +210,7 @@ TaskSteadyHand::TaskSteadyHand()
     double friction = 0.001;
     stand_mesh = new
             SimObject(ObjectShape::MESH, ObjectType::DYNAMIC,
-                      RESOURCES_DIRECTORY+"/mesh/task_steady_hand_stand.obj"
+                      RESOURCES_DIRECTORY + STAND_MESH
             , stand_frame, 0.0, friction);
 
     AddSimObjectToTask(stand_mesh);
@@ -215,20 +239,12 @@ TaskSteadyHand::TaskSteadyHand()
     // -------------------------------------------------------------------------
     // MESH hq is for rendering and lq is for generating
     // active constraints
-    std::stringstream input_file_dir;
-    std::string mesh_file_dir_str;
     for (int m = 0; m <4; ++m) {
 
-        input_file_dir.str("");
-        input_file_dir << RESOURCES_DIRECTORY
-                       << std::string
-                               ("/mesh/task_steady_hand_tube_quarter_mesh")
-                       << m+1 <<".obj";
-        mesh_file_dir_str = input_file_dir.str();
-
         tube_meshes[m] = new
                 SimObject(ObjectShape::MESH, ObjectType::DYNAMIC
-                , mesh_file_dir_str, pose_tube, 0.0, friction);
+                , RESOURCES_DIRECTORY + TubeQuarterMesh(m), pose_tube, 0.0,
+                          friction);
         tube_meshes[m]->GetActor()->GetProperty()->SetColor(colors.BlueDodger);
         tube_meshes[m]->GetActor()->GetProperty()->SetSpecular(1);
         tube_meshes[m]->GetActor()->GetProperty()->SetSpecularPower(100);
@@ -239,7 +255,7 @@ TaskSteadyHand::TaskSteadyHand()
     // MESH thin
     tube_mesh_thin = new
             SimObject(ObjectShape::MESH, ObjectType::NOPHYSICS
-            ,RESOURCES_DIRECTORY+"/mesh/task_steady_hand_tube_whole_thin.obj",
+            ,RESOURCES_DIRECTORY + TUBE_MESH_THIN,
                       pose_tube, 0.0 ,friction);
     //graphics_actors.push_back(tube_mesh_thin->GetActor());
 
@@ -247,8 +263,18 @@ TaskSteadyHand::TaskSteadyHand()
     /// don't repeat the transform every time.
 
     // CLOSEST POINT will be found on the low quality mesh
-    cellLocator->SetDataSet(tube_mesh_thin->GetActor()->GetMapper()->GetInput());
-    cellLocator->BuildLocator();
+    ring_guidance = std::make_shared<MeshGuidanceFixture>(
+            vtkPolyData::SafeDownCast(
+                    tube_mesh_thin->GetActor()->GetMapper()->GetInput()),
+            pose_tube, ring_radius);
+
+    // -------------------------------------------------------------------------
+    // Haptics: the guidance acts on the ring, when it is grasped by an arm
+    haptics = std::make_unique<HapticsScheduler>(500);
+    haptics->AddArm(slaves[0], "/atar/PSM1_DUMMY/tool_pose_desired",
+                    ring_guidance, ac_soft_start_duration);
+    haptics->AddArm(slaves[1], "/atar/PSM2_DUMMY/tool_pose_desired",
+                    ring_guidance, ac_soft_start_duration);
 
 
     // -------------------------------------------------------------------------
@@ -268,6 +294,11 @@ TaskSteadyHand::TaskSteadyHand()
     KDL::Rotation rings_orient = ring_holder_bar_pose.M *
                                  KDL::Rotation::RotY(M_PI/2);
 
+    // the rings and the separation cylinders are drawn with one instanced
+    // actor each
+    auto ring_instancer = new SimObjectInstancer;
+    auto sep_cylinder_instancer = new SimObjectInstancer;
+
     for (int l = 0; l < ring_num; ++l) {
 
         KDL::Frame pose(rings_orient
@@ -277,11 +308,12 @@ TaskSteadyHand::TaskSteadyHand()
 
         ring_mesh[ring_num - l -1] = new
                 SimObject(ObjectShape::MESH, ObjectType::DYNAMIC,
-                          RESOURCES_DIRECTORY+"/mesh/task_steady_hand_torus_D10mm_d1.2mm.obj"
+                          RESOURCES_DIRECTORY + RING_MESH
                 , pose, density, friction);
 
-        AddSimObjectToTask(ring_mesh[ring_num - l -1]);
         ring_mesh[ring_num-l-1]->GetActor()->GetProperty()->SetColor(colors.Turquoise);
+        ring_instancer->AddInstance(ring_mesh[ring_num - l -1]);
+        AddSimObjectToTask(ring_mesh[ring_num - l -1]);
         ring_mesh[ring_num-l-1]->GetBody()->setContactStiffnessAndDamping
                 (3000, 100);
         ring_mesh[ring_num-l-1]->GetBody()->setRollingFriction(btScalar(0.01));
@@ -301,8 +333,11 @@ TaskSteadyHand::TaskSteadyHand()
                 SimObject(ObjectShape::CYLINDER, ObjectType::KINEMATIC, _dim,
                           pose_cyl);
         sep_cylinder[l]->GetActor()->GetProperty()->SetColor(colors.BlueDodger);
+        sep_cylinder_instancer->AddInstance(sep_cylinder[l]);
         AddSimObjectToTask(sep_cylinder[l]);
     }
+    AddSimObjectInstancerToTask(ring_instancer);
+    AddSimObjectInstancerToTask(sep_cylinder_instancer);
 
     start_point  = ring_holder_bar_pose.p + (ring_num + 3) * step *dir;
     end_point = pose_tube * KDL::Vector(-0.012, 0.0, -0.01);
@@ -434,6 +469,12 @@ void TaskSteadyHand::TaskLoop() {
     if( (gripper_in_contact[1] & !gripper_in_contact_last[1]) || drift > 0.001)
         tool_to_ring_tr[1] = tool_current_pose[1].Inverse() * ring_pose ;
 
+    // the guidance is applied to the arms holding the ring
+    for (int i = 0; i < 2; ++i) {
+        haptics->SetControlledFrame(i, tool_to_ring_tr[i]);
+        haptics->SetEngaged(i, gripper_in_contact[i]);
+    }
+
     //// change the color of the grasped ring
     //if (gripper_in_contact[0] || gripper_in_contact[1])
     //    ring_mesh[ring_in_action]->GetActor()->GetProperty()
@@ -594,154 +635,6 @@ void TaskSteadyHand::TaskLoop() {
 
 
 
-//------------------------------------------------------------------------------
-void TaskSteadyHand::CalculatedDesiredRingPose(
-        const KDL::Frame ring_pose,
-        KDL::Frame &desired_ring_pose
-) {
-    // NOTE: All the closest points are on the wire mesh
-
-    //---------------------------------------------------------------------
-    // Find the desired orientation
-    // We use two vectors to estimate the tangent of the direction of the
-    // tube. Assuming that the ref frame of the ring is on the center of its
-    // circle and and the circle lie on the x-y plane.
-    // Imagine two points on the inner circle of the ring such that one
-    // point is put on the intersection of the x axis of the ring with its
-    // inner circle and the other point is simillar but along the y axis.
-    // The estimated tangent is the cross product of the two vectors
-    // connecting these points to their correspondin closest point on the
-    // surface of the thin tube (after normalization). This is just a quick
-    // and non-ideal approximation.
-    // Note that we could have used the central point instead of the tool
-    // point but that vector gets pretty small and unstable when we're
-    // close to the desired pose.
-
-    // Another important thing to note here is that we want to apply the
-    // guidance force to the tool at the end (and not the ring). so we find
-    // the transformation that would take the current ring pose to the
-    // desired one and add that to the current pose of the tool.
-
-
-    // Note that to find the closest point to the mesh, we need to take the
-    // points to the local reference farame of the mesh object
-    // So we need the its pose and inv
-
-    //static KDL::Frame tube_mesh_pose = tube_mesh_thin->GetPose();
-    static KDL::Frame tube_mesh_pose = pose_tube;
-    static KDL::Frame tube_mesh_pose_inv = tube_mesh_pose.Inverse();
-
-    // ----------------------- FIRST CLOSEST POINT
-    //Find the closest cell to the the central point
-    KDL::Vector center_point_in_mesh_local = tube_mesh_pose_inv*ring_pose.p;
-
-    double ring_central_point_in_mesh_local[3] = {center_point_in_mesh_local[0],
-                                                  center_point_in_mesh_local[1],
-                                                  center_point_in_mesh_local[2]};
-
-    double closest_point[3] = {0.0, 0.0, 0.0};
-    double closestPointDist2; //the squared distance to the closest point
-    vtkIdType cell_id; //the cell id of the cell containing the closest point
-    int subId;
-
-    cellLocator->Update();
-    cellLocator->FindClosestPoint(ring_central_point_in_mesh_local, closest_point,
-                                  cell_id, subId, closestPointDist2);
-    // take the closest point to the current pose of the object
-    KDL::Vector closest_point_to_center_point = tube_mesh_pose *
-                                                KDL::Vector(closest_point[0], closest_point[1], closest_point[2]);
-
-    // ----------------------- SECOND CLOSEST POINT
-    //Find the closest cell to the grip point
-    KDL::Vector radial_x_point_kdl = ring_pose *
-                                     KDL::Vector(ring_radius, 0.0, 0.0);
-    KDL::Vector radial_x_point_in_mesh_local_kdl =tube_mesh_pose_inv*radial_x_point_kdl;
-
-    double radial_x_point_in_mesh_local[3] = {radial_x_point_in_mesh_local_kdl[0],
-                                              radial_x_point_in_mesh_local_kdl[1],
-                                              radial_x_point_in_mesh_local_kdl[2]};
-
-    cellLocator->Update();
-    cellLocator->FindClosestPoint(radial_x_point_in_mesh_local, closest_point,
-                                  cell_id, subId, closestPointDist2);
-    // take the closest point to the current pose of the object
-    KDL::Vector closest_point_to_x_point = tube_mesh_pose *
-                                           KDL::Vector(closest_point[0],closest_point[1],closest_point[2]);
-
-    // ----------------------- THIRD CLOSEST POINT
-    //Find the closest cell to the radial tool point
-    KDL::Vector radial_y_point_kdl = ring_pose *
-                                     KDL::Vector(0., ring_radius, 0.f);
-    KDL::Vector radial_y_point_in_mesh_local_kdl = tube_mesh_pose_inv*radial_y_point_kdl;
-
-    double radial_y_point_in_mesh_local[3] = {radial_y_point_in_mesh_local_kdl[0],
-                                              radial_y_point_in_mesh_local_kdl[1],
-                                              radial_y_point_in_mesh_local_kdl[2]};
-
-    cellLocator->Update();
-    cellLocator->FindClosestPoint(radial_y_point_in_mesh_local, closest_point,
-                                  cell_id, subId, closestPointDist2);
-    // take the closest point to the current pose of the object
-    KDL::Vector closest_point_to_y_point = tube_mesh_pose *
-                                           KDL::Vector(closest_point[0],closest_point[1],closest_point[2]);
-
-
-    // Find the vector from ring center to the corresponding closest point on
-    // the thin mesh
-    //KDL::Vector ring_center_to_cp = closest_point_to_center_point - ring_pose.p;
-
-    // desired pose only when the ring is close to the wire.if it is too
-    // far we don't want fixtures
-    //if (ring_center_to_cp.Norm() < 5 * ring_radius) {
-
-    // Desired position is one that puts the center of the ring on the
-    // center of the mesh.
-
-    //---------------------------------------------------------------------
-    // Find the desired position of the ring assuming that the length
-    // of the thin tube is negligible
-    desired_ring_pose.p = closest_point_to_center_point;
-
-    KDL::Vector desired_z, desired_y, desired_x;
-
-    KDL::Vector point_y_to_cp =
-            closest_point_to_y_point - radial_y_point_kdl;
-
-    KDL::Vector point_x_to_cp =
-            closest_point_to_x_point - radial_x_point_kdl;
-
-    desired_x = -point_x_to_cp / point_x_to_cp.Norm();
-    desired_y = -point_y_to_cp / point_y_to_cp.Norm();
-    desired_z = desired_x * desired_y;
-
-    // make sure axes are perpendicular and normal
-    desired_z = desired_z / desired_z.Norm();
-    desired_x = desired_y * desired_z;
-    desired_x = desired_x / desired_x.Norm();
-    desired_y = desired_z * desired_x;
-    desired_y = desired_y / desired_y.Norm();
-
-    desired_ring_pose.M =
-            KDL::Rotation(desired_x, desired_y, desired_z);
-
-    // draw the connection lines for debug
-    //line1_source->SetPoint1(radial_x_point_kdl[0],
-    //                        radial_x_point_kdl[1],
-    //                        radial_x_point_kdl[2]);
-    //line1_source->SetPoint2(closest_point_to_x_point[0],
-    //                        closest_point_to_x_point[1],
-    //                        closest_point_to_x_point[2]);
-    //line2_source->SetPoint1(radial_y_point_kdl[0],
-    //                        radial_y_point_kdl[1],
-    //                        radial_y_point_kdl[2]);
-    //line2_source->SetPoint2(closest_point_to_y_point[0],
-    //                        closest_point_to_y_point[1],
-    //                        closest_point_to_y_point[2]);
-
-
-}
-
-
 //------------------------------------------------------------------------------
 void TaskSteadyHand::UpdateRingColor() {
 
@@ -797,15 +690,8 @@ void TaskSteadyHand::HapticsThread() {
 
     ros::NodeHandlePtr node = boost::make_shared<ros::NodeHandle>();
 
-    ros::Publisher pub_slave_desired[2];
     ros::Publisher pub_wrench_abs[2];
 
-    //getting the name of the arms
-    std::string param_name = "/atar/PSM1_DUMMY/tool_pose_desired";
-    pub_slave_desired[0] = node->advertise<geometry_msgs::PoseStamped>
-            (param_name, 1);
-    ROS_INFO("Will publish on %s", param_name.c_str());
-
     // make sure the masters are in wrench absolute orientation
     // assuming MTMR is always used
     std::string master_topic = "/dvrk/MTMR/set_wrench_body_orientation_absolute";
@@ -815,23 +701,11 @@ void TaskSteadyHand::HapticsThread() {
     pub_wrench_abs[0].publish(wrench_body_orientation_absolute);
     ROS_INFO("Setting wrench_body_orientation_absolute on %s", master_topic.c_str());
 
-    //getting the name of the arms
-    param_name = "/atar/PSM2_DUMMY/tool_pose_desired";
-    pub_slave_desired[1] = node->advertise<geometry_msgs::PoseStamped>
-            (param_name, 1);
-    ROS_INFO("Will publish on %s", param_name.c_str());
-
-    // make sure the masters are in wrench absolute orientation
-    // assuming MTMR is always used
     master_topic = "/dvrk/MTML/set_wrench_body_orientation_absolute";
     pub_wrench_abs[1] = node->advertise<std_msgs::Bool>(master_topic, 1);
     pub_wrench_abs[1].publish(wrench_body_orientation_absolute);
     ROS_INFO("Setting wrench_body_orientation_absolute on %s", master_topic.c_str());
 
-
-    ros::Rate loop_rate(500);
-    ROS_INFO("The desired pose will be updated at 500 Hz");
-
     // publish ring poses (at a lower rate) for data analysis
     ros::Publisher pub_ring_desired, pub_ring_current;
     std::string ring_topic = "/atar/ring_pose_current";
@@ -843,27 +717,18 @@ void TaskSteadyHand::HapticsThread() {
     ROS_INFO("Will publish on %s", ring_topic.c_str());
     int lower_freq_pub_counter = 0;
 
-    // todo: what if this changes during the task execution...
-    KDL::Frame world_to_slave_tr[2];
-    world_to_slave_tr[0] = slaves[0]->GetWorldToLocalTr();
-    world_to_slave_tr[1] = slaves[1]->GetWorldToLocalTr();
-
     //---------------------------------------------
-    // loop
-    while (ros::ok())
-    {
-        slaves[0]->GetPoseWorld(tool_current_pose[0]);
-        slaves[0]->GetGripper(gripper_angle[0]);
-        slaves[1]->GetPoseWorld(tool_current_pose[1]);
-        slaves[1]->GetGripper(gripper_angle[1]);
-
-        KDL::Frame ring_pose_loc;
+    // The desired poses are computed and published by the scheduler. Here
+    // we only read them back to find the ring pose and the errors.
+    haptics->SetTickCallback([&]() {
 
-        //ring_pose = ring_mesh[ring_in_action]->GetPose();
-        ring_pose_loc = ring_pose;
-
-        KDL::Frame tr_to_desired_ring_pose, desired_ring_pose;
-        KDL::Frame estimated_ring_pose_loc;
+        HapticsArmOutput out[2] = {haptics->GetLastOutput(0),
+                                   haptics->GetLastOutput(1)};
+        for (int n_arm = 0; n_arm < 2; ++n_arm) {
+            tool_current_pose[n_arm] = out[n_arm].tool_current;
+            tool_desired_pose[n_arm] = out[n_arm].tool_desired;
+            gripper_angle[n_arm] = out[n_arm].gripper_angle;
+        }
 
         // the pose of the ring is updated with the graphics frequency which
         // is too low for haptics. The good news is that if we assume that
@@ -872,74 +737,23 @@ void TaskSteadyHand::HapticsThread() {
         // ring_pose. When the ring is not gripped we do not need haptics but
         // to calculate the errors etc we still need to know the pose of the
         // ring the desired one.
-        //         tool_to_ring_tr[0] = ring_pose * tool_current_pose[0].Inverse();
-
-        if(gripper_in_contact[0])
-            estimated_ring_pose_loc = tool_current_pose[0] *tool_to_ring_tr[0];
-        else if (gripper_in_contact[1])
-            estimated_ring_pose_loc = tool_current_pose[1]* tool_to_ring_tr[1];
-        else
-            estimated_ring_pose_loc = ring_pose_loc;
-
-        // save in global for use in the other thread
-        estimated_ring_pose = estimated_ring_pose_loc;
-
-        // calculate the desired pose
-        CalculatedDesiredRingPose(estimated_ring_pose_loc, desired_ring_pose);
-
-        tr_to_desired_ring_pose.p = desired_ring_pose.p - estimated_ring_pose_loc.p;
-        tr_to_desired_ring_pose.M = desired_ring_pose.M * estimated_ring_pose_loc.M
-                .Inverse();
-        //tr_to_desired_ring_pose = desired_ring_pose * estimated_ring_pose_loc.Inverse();
-
-        // --------------- Soft start delta calculation
-        // did we grasp the ring just now?
-        if( (gripper_in_contact[0] & !gripper_in_contact_last[0]) ||
-            (gripper_in_contact[1] & !gripper_in_contact_last[1]) )
-            ac_soft_start_counter = 0;
-
-        double soft_start_delta;
-        if(ac_soft_start_counter < ac_soft_start_duration){
-            soft_start_delta = double(ac_soft_start_counter)
-                               /double(ac_soft_start_duration);
-            ac_soft_start_counter++;
+        KDL::Frame estimated_ring_pose_loc, desired_ring_pose;
+        if(out[0].engaged) {
+            estimated_ring_pose_loc = out[0].controlled_current;
+            desired_ring_pose = out[0].controlled_desired;
         }
-        else
-            soft_start_delta = 1.0;
-
-        // --------------- Publish desired poses
-        for (int n_arm = 0; n_arm < 2; ++n_arm) {
-
-            if(gripper_in_contact[n_arm]) {
-
-                // here find the desired tool pose if it is in contact with
-                // the ring we add the displacement that would take the ring
-                // to its desired pose to the current pose of the tool;
-                tool_desired_pose[n_arm].p =
-                        soft_start_delta * tr_to_desired_ring_pose.p +
-                        tool_current_pose[n_arm].p;
-                tool_desired_pose[n_arm].M =
-                        tr_to_desired_ring_pose.M * tool_current_pose[n_arm].M;
-
-            }
-            else {
-                tool_desired_pose[n_arm]= tool_current_pose[n_arm];
-            }
-
-            // convert to pose message
-            geometry_msgs::PoseStamped pose_msg;
-            KDL::Frame tool_desired_pose_in_slave_frame;
-            tool_desired_pose_in_slave_frame =
-                    world_to_slave_tr[n_arm]*tool_desired_pose[n_arm];
-
-            tf::poseKDLToMsg(tool_desired_pose_in_slave_frame, pose_msg.pose);
-            // fill the header
-            pose_msg.header.frame_id = "/slave_frame";
-            pose_msg.header.stamp = ros::Time::now();
-            // publish
-            pub_slave_desired[n_arm].publish(pose_msg);
+        else if(out[1].engaged) {
+            estimated_ring_pose_loc = out[1].controlled_current;
+            desired_ring_pose = out[1].controlled_desired;
+        }
+        else {
+            estimated_ring_pose_loc = ring_pose;
+            ring_guidance->GetDesiredPose(estimated_ring_pose_loc,
+                                          desired_ring_pose);
         }
 
+        // save in global for use in the other thread
+        estimated_ring_pose = estimated_ring_pose_loc;
 
         lower_freq_pub_counter++;
         // publish the ring poses
@@ -951,17 +765,20 @@ void TaskSteadyHand::HapticsThread() {
         }
         //------------------------------------------------------------------
         // Calculate errors
+        KDL::Frame tr_to_desired_ring_pose;
+        tr_to_desired_ring_pose.p = desired_ring_pose.p - estimated_ring_pose_loc.p;
+        tr_to_desired_ring_pose.M = desired_ring_pose.M * estimated_ring_pose_loc.M
+                .Inverse();
+
         position_error_norm = tr_to_desired_ring_pose.p.Norm();
         KDL::Vector rpy;
         tr_to_desired_ring_pose.M.GetRPY(rpy[0],
                                          rpy[1],
                                          rpy[2]);
         orientation_error_norm = rpy.Norm();
+    });
 
-        ros::spinOnce();
-        loop_rate.sleep();
-        boost::this_thread::interruption_point();
-    }
+    haptics->Run();
 }
 
 void TaskSteadyHand::CalculateAndSaveError() {
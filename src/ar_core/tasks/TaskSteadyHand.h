@@ -31,6 +31,8 @@
 #include <std_msgs/Empty.h>
 #include <std_msgs/Bool.h>
 #include <src/ar_core/Manipulator.h>
+#include <src/ar_core/VirtualFixtures.h>
+#include <src/ar_core/HapticsScheduler.h>
 #include "custom_msgs/ActiveConstraintParameters.h"
 #include "custom_msgs/TaskState.h"
 
@@ -55,8 +57,10 @@
  * An important point here is that there is a thread in this class that does
  * the spinning for ros and updates the desired pose at a much higher
  * frequency with respect to the 25Hz for graphics which would lead to
- * unstable guidance forces. This is totally not thread-safe! Hopefully in
- * future I learn more about multi-threaded applications and improve this.
+ * unstable guidance forces. The guidance itself is a MeshGuidanceFixture
+ * run by a HapticsScheduler; the graphics thread only tells the scheduler
+ * which arm holds the ring. The task metrics shared between the threads
+ * are still not thread-safe.
  */
 
 
@@ -68,6 +72,9 @@ public:
 
     TaskSteadyHand();
 
+    // The meshes loaded by the constructor (see SimTask)
+    static std::vector<MeshAssetRequest> RequiredMeshes();
+
     ~TaskSteadyHand();
 
     // updates the task logic and the graphics_actors
@@ -75,8 +82,8 @@ public:
 
     /**
     * \brief This is the function that is handled by the haptics thread.
-    * It first reads the current poses of the tools and then finds the
-    * desired pose from the mesh.
+    * It runs the haptics scheduler that finds and publishes the desired
+    * tool poses, and computes the ring errors at each tick.
     *  **/
     void HapticsThread() override;
 
@@ -93,12 +100,6 @@ public:
     void ResetTask() override;
 
 
-    // calculates the desired tool pose
-    void CalculatedDesiredRingPose(
-        KDL::Frame ring_pose,
-        KDL::Frame &desired_ring_pose
-    );
-
     // resets the history of the scores and changes the colors to gray
     void ResetScoreHistory();
 
@@ -162,7 +163,6 @@ private:
     uint ring_in_action = 0;
     bool gripper_in_contact[2] ={false, false};
     bool gripper_in_contact_last[2] ={false, false};
-    uint ac_soft_start_counter = 0;
     uint ac_soft_start_duration = 200;
 
     // the distance between the center of the ring and the closest point on
@@ -188,7 +188,9 @@ private:
     vtkSmartPointer<vtkAxesActor>                   tool_current_frame_axes[2];
     vtkSmartPointer<vtkAxesActor>                   tool_desired_frame_axes[2];
 
-    vtkSmartPointer<vtkCellLocator>                 cellLocator;
+    // guidance along the thin tube mesh and the loop that applies it
+    std::shared_ptr<MeshGuidanceFixture>            ring_guidance;
+    std::unique_ptr<HapticsScheduler>               haptics;
 
     vtkSmartPointer<vtkLineSource>                  line1_source;
     vtkSmartPointer<vtkLineSource>                  line2_source;
@@ -6,11 +6,13 @@
 #define ATAR_ARMTOWORLDCALIBRATION_H
 
 #include <iostream>
+#include <memory>
 #include <kdl/frames.hpp>
 #include <opencv-3.2.0-dev/opencv2/core/mat.hpp>
 #include <sensor_msgs/Image.h>
 #include <geometry_msgs/PoseStamped.h>
 #include <Eigen/Dense>
+#include "RobustRigidRegistration.h"
 
 class ArmToWorldCalibration {
 
@@ -35,9 +37,9 @@ private:
 
     void CameraPoseCallback(const geometry_msgs::PoseStamped::ConstPtr &msg);
 
-    KDL::Frame CalculateTransformation(
-            std::vector<Eigen::Vector3d> points_in_frame_1,
-            std::vector<Eigen::Vector3d> points_in_frame_2);
+    // Solves once all the points are measured. The outliers are to be
+    // touched again.
+    void OnPointMeasured();
 
     void PutDrawings(cv::Mat img);
 
@@ -61,8 +63,8 @@ private:
     KDL::Frame world_to_cam_tr;
     KDL::Frame world_to_arm_tr;
 
-    std::vector< Eigen::Vector3d> calib_points_in_arm_frame;
     std::vector< Eigen::Vector3d> calib_points_in_world_frame;
+    std::unique_ptr<RobustRigidRegistration> registration;
 
 };
 
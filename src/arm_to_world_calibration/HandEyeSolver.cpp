@@ -0,0 +1,239 @@
+//
+// Created by charm on 19/10/26.
+//
+
+#include "HandEyeSolver.h"
+#include <cmath>
+
+namespace hand_eye {
+
+    // m per rad: weight of the rotation residuals against the translation
+    // ones. 1 deg counts as ~1.7 mm.
+    static const double ROTATION_WEIGHT = 0.1;
+
+    // m, above this residual the loss is linear
+    static const double HUBER_THRESHOLD = 0.005;
+
+    // rad, smaller relative rotations say little about the axes
+    static const double MIN_PAIR_ROTATION = 0.1;
+
+    typedef Eigen::Matrix<double, 6, 1> Vector6d;
+    typedef Eigen::Matrix<double, 12, 1> Vector12d;
+    typedef Eigen::Matrix<double, 12, 12> Matrix12d;
+
+    // -------------------------------------------------------------------------
+    static Eigen::Vector3d Log(const Eigen::Matrix3d &R) {
+        const Eigen::AngleAxisd aa(R);
+        return aa.angle() * aa.axis();
+    }
+
+    // -------------------------------------------------------------------------
+    static Eigen::Matrix3d Exp(const Eigen::Vector3d &w) {
+        const double angle = w.norm();
+        if(angle < 1e-12)
+            return Eigen::Matrix3d::Identity();
+        return Eigen::AngleAxisd(angle, w / angle).toRotationMatrix();
+    }
+
+    // -------------------------------------------------------------------------
+    // closest rotation to M
+    static Eigen::Matrix3d ProjectToRotation(const Eigen::Matrix3d &M) {
+        Eigen::JacobiSVD<Eigen::Matrix3d> svd(
+                M, Eigen::ComputeFullU | Eigen::ComputeFullV);
+        Eigen::Matrix3d D = Eigen::Matrix3d::Identity();
+        D(2, 2) = (svd.matrixU() * svd.matrixV().transpose()).determinant();
+        return svd.matrixU() * D * svd.matrixV().transpose();
+    }
+
+    // -------------------------------------------------------------------------
+    static Eigen::Isometry3d Perturb(const Eigen::Isometry3d &T,
+                                     const Eigen::Ref<const Vector6d> &delta) {
+        Eigen::Isometry3d out = T;
+        out.linear() = T.linear() * Exp(delta.head<3>());
+        out.translation() += delta.tail<3>();
+        return out;
+    }
+
+    // -------------------------------------------------------------------------
+    // identity when A Y = X B
+    static Vector6d Residual(const Eigen::Isometry3d &A,
+                             const Eigen::Isometry3d &B,
+                             const Eigen::Isometry3d &X,
+                             const Eigen::Isometry3d &Y) {
+        const Eigen::Isometry3d E = (X * B).inverse() * (A * Y);
+        Vector6d r;
+        r.head<3>() = E.translation();
+        r.tail<3>() = ROTATION_WEIGHT * Log(E.linear());
+        return r;
+    }
+
+    // -------------------------------------------------------------------------
+    static double HuberWeight(const double norm) {
+        return norm <= HUBER_THRESHOLD ? 1.0 : HUBER_THRESHOLD / norm;
+    }
+
+    // -------------------------------------------------------------------------
+    static double HuberCost(const PoseVector &A,
+                            const PoseVector &B,
+                            const Eigen::Isometry3d &X,
+                            const Eigen::Isometry3d &Y) {
+        double cost = 0.0;
+        for (size_t i = 0; i < A.size(); ++i) {
+            const double n = Residual(A[i], B[i], X, Y).norm();
+            cost += n <= HUBER_THRESHOLD
+                    ? 0.5 * n * n
+                    : HUBER_THRESHOLD * (n - 0.5 * HUBER_THRESHOLD);
+        }
+        return cost;
+    }
+
+    // -------------------------------------------------------------------------
+    double RotationAngle(const Eigen::Matrix3d &R_1,
+                         const Eigen::Matrix3d &R_2) {
+        return Eigen::AngleAxisd(R_1.transpose() * R_2).angle();
+    }
+
+    // -------------------------------------------------------------------------
+    static bool InitialGuess(const PoseVector &A,
+                             const PoseVector &B,
+                             Eigen::Isometry3d &X, Eigen::Isometry3d &Y) {
+
+        // relative motions: A_j A_i^-1 X = X B_j B_i^-1
+        PoseVector motions_A, motions_B;
+        for (size_t i = 0; i < A.size(); ++i)
+            for (size_t j = i + 1; j < A.size(); ++j) {
+                const Eigen::Isometry3d motion_A = A[j] * A[i].inverse();
+                if(Eigen::AngleAxisd(motion_A.linear()).angle()
+                   < MIN_PAIR_ROTATION)
+                    continue;
+                motions_A.push_back(motion_A);
+                motions_B.push_back(B[j] * B[i].inverse());
+            }
+        if(motions_A.size() < 2)
+            return false;
+
+        // the rotation axes of the motions: axis_A = R_X axis_B
+        Eigen::Matrix3d M = Eigen::Matrix3d::Zero();
+        for (size_t k = 0; k < motions_A.size(); ++k)
+            M += Log(motions_A[k].linear())
+                 * Log(motions_B[k].linear()).transpose();
+        Eigen::JacobiSVD<Eigen::Matrix3d> svd(M);
+        // all the axes are (nearly) parallel, the rotation about them is
+        // unknown
+        if(svd.singularValues()(1) < 1e-2 * svd.singularValues()(0))
+            return false;
+        X.linear() = ProjectToRotation(M);
+
+        // (R_A - I) t_X = R_X t_B - t_A
+        Eigen::Matrix3d AtA = Eigen::Matrix3d::Zero();
+        Eigen::Vector3d Atb = Eigen::Vector3d::Zero();
+        for (size_t k = 0; k < motions_A.size(); ++k) {
+            const Eigen::Matrix3d C = motions_A[k].linear()
+                                      - Eigen::Matrix3d::Identity();
+            const Eigen::Vector3d d = X.linear() * motions_B[k].translation()
+                                      - motions_A[k].translation();
+            AtA += C.transpose() * C;
+            Atb += C.transpose() * d;
+        }
+        X.translation() = AtA.ldlt().solve(Atb);
+
+        // Y = A_i^-1 X B_i, averaged over the samples
+        Eigen::Matrix3d rotation_sum = Eigen::Matrix3d::Zero();
+        Eigen::Vector3d translation_sum = Eigen::Vector3d::Zero();
+        for (size_t i = 0; i < A.size(); ++i) {
+            const Eigen::Isometry3d Y_i = A[i].inverse() * X * B[i];
+            rotation_sum += Y_i.linear();
+            translation_sum += Y_i.translation();
+        }
+        Y.linear() = ProjectToRotation(rotation_sum);
+        Y.translation() = translation_sum / A.size();
+        return true;
+    }
+
+    // -------------------------------------------------------------------------
+    static void Refine(const PoseVector &A,
+                       const PoseVector &B,
+                       Eigen::Isometry3d &X, Eigen::Isometry3d &Y) {
+
+        const double eps = 1e-7;
+        double lambda = 1e-3;
+        double cost = HuberCost(A, B, X, Y);
+
+        for (int iteration = 0; iteration < 50; ++iteration) {
+
+            // normal equations of the weighted residuals, with numerical
+            // derivatives with respect to the 12 parameters
+            Matrix12d H = Matrix12d::Zero();
+            Vector12d g = Vector12d::Zero();
+            for (size_t i = 0; i < A.size(); ++i) {
+                const Vector6d r = Residual(A[i], B[i], X, Y);
+                Eigen::Matrix<double, 6, 12> J;
+                for (int k = 0; k < 12; ++k) {
+                    Vector12d delta = Vector12d::Zero();
+                    delta(k) = eps;
+                    const Vector6d r_plus = Residual(
+                            A[i], B[i], Perturb(X, delta.head<6>()),
+                            Perturb(Y, delta.tail<6>()));
+                    J.col(k) = (r_plus - r) / eps;
+                }
+                const double w = HuberWeight(r.norm());
+                H += w * J.transpose() * J;
+                g += w * J.transpose() * r;
+            }
+
+            // Levenberg-Marquardt step
+            bool improved = false;
+            while (lambda < 1e8) {
+                Matrix12d H_damped = H;
+                H_damped.diagonal() *= 1.0 + lambda;
+                const Vector12d delta = H_damped.ldlt().solve(-g);
+                const Eigen::Isometry3d X_new = Perturb(X, delta.head<6>());
+                const Eigen::Isometry3d Y_new = Perturb(Y, delta.tail<6>());
+                const double new_cost = HuberCost(A, B, X_new, Y_new);
+                if(new_cost < cost) {
+                    X = X_new;
+                    Y = Y_new;
+                    improved = cost - new_cost > 1e-12 * cost;
+                    cost = new_cost;
+                    lambda = std::max(lambda / 10, 1e-9);
+                    break;
+                }
+                lambda *= 10;
+            }
+            if(!improved)
+                break;
+        }
+    }
+
+    // -------------------------------------------------------------------------
+    bool Solve(const PoseVector &A,
+               const PoseVector &B,
+               Solution &solution) {
+
+        if(A.size() != B.size() || A.size() < 3)
+            return false;
+
+        Eigen::Isometry3d X = Eigen::Isometry3d::Identity();
+        Eigen::Isometry3d Y = Eigen::Isometry3d::Identity();
+        if(!InitialGuess(A, B, X, Y))
+            return false;
+
+        Refine(A, B, X, Y);
+
+        double sum_translation = 0.0, sum_rotation = 0.0;
+        for (size_t i = 0; i < A.size(); ++i) {
+            const Eigen::Isometry3d E = (X * B[i]).inverse() * (A[i] * Y);
+            sum_translation += E.translation().squaredNorm();
+            const double angle = Eigen::AngleAxisd(E.linear()).angle();
+            sum_rotation += angle * angle;
+        }
+
+        solution.X = X;
+        solution.Y = Y;
+        solution.rms_translation = std::sqrt(sum_translation / A.size());
+        solution.rms_rotation = std::sqrt(sum_rotation / A.size());
+        solution.n_samples = (int)A.size();
+        return true;
+    }
+
+}
@@ -0,0 +1,55 @@
+//
+// Created by charm on 19/10/26.
+//
+
+#ifndef ATAR_HANDEYESOLVER_H
+#define ATAR_HANDEYESOLVER_H
+
+#include <vector>
+#include <Eigen/Dense>
+#include <Eigen/Geometry>
+#include <Eigen/StdVector>
+
+/**
+ * Solver of the hand-eye problem A_i * Y = X * B_i, for pairs of poses
+ * measured at the same time.
+ *
+ * With a board held by the tool of an arm and a fixed camera: A_i is the
+ * pose of the tool in the arm base frame, B_i the pose of the board in the
+ * camera frame, X the pose of the camera in the arm base frame and Y the
+ * pose of the board in the tool frame.
+ *
+ * The initial guess comes from the relative motions between pairs of
+ * samples (A_j A_i^-1 X = X B_j B_i^-1): the rotation aligns their rotation
+ * axes and the translation is a linear least squares. X and Y are then
+ * refined together with a Levenberg-Marquardt on the residuals of all the
+ * samples, with a Huber loss so that a few badly synchronised samples do
+ * not pull the solution.
+ */
+namespace hand_eye {
+
+    typedef std::vector<Eigen::Isometry3d,
+            Eigen::aligned_allocator<Eigen::Isometry3d> > PoseVector;
+
+    struct Solution {
+        EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+        Eigen::Isometry3d   X = Eigen::Isometry3d::Identity();
+        Eigen::Isometry3d   Y = Eigen::Isometry3d::Identity();
+        // rms of the translation (m) and rotation (rad) residuals
+        double              rms_translation = 0.0;
+        double              rms_rotation = 0.0;
+        int                 n_samples = 0;
+    };
+
+    // Angle between two rotations, rad
+    double RotationAngle(const Eigen::Matrix3d &R_1, const Eigen::Matrix3d &R_2);
+
+    // False if the samples don't have enough rotation about different axes
+    bool Solve(const PoseVector &A, const PoseVector &B,
+               Solution &solution);
+
+}
+
+
+#endif //ATAR_HANDEYESOLVER_H
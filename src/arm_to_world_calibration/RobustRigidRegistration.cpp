@@ -0,0 +1,298 @@
+//
+// Created by charm on 19/10/26.
+//
+
+#include "RobustRigidRegistration.h"
+#include <Eigen/Geometry>
+#include <algorithm>
+#include <limits>
+#include <sstream>
+
+// -----------------------------------------------------------------------------
+RobustRigidRegistration::Params RobustRigidRegistration::ReadParams(
+        const ros::NodeHandle &n) {
+
+    Params params;
+    n.param<int>("calib_samples_per_point", params.samples_per_point,
+                 params.samples_per_point);
+    n.param<double>("calib_max_sample_std", params.max_sample_std,
+                    params.max_sample_std);
+    n.param<double>("calib_inlier_threshold", params.inlier_threshold,
+                    params.inlier_threshold);
+    return params;
+}
+
+// -----------------------------------------------------------------------------
+RobustRigidRegistration::RobustRigidRegistration(
+        const std::vector<Eigen::Vector3d> &target_points,
+        const Params &params)
+        :
+        params(params),
+        target_points(target_points),
+        measured_points(target_points.size()),
+        measured(target_points.size(), false),
+        residuals(target_points.size(), -1.0),
+        inliers(target_points.size(), false)
+{ }
+
+// -----------------------------------------------------------------------------
+int RobustRigidRegistration::GetCurrentTarget() const {
+
+    for (size_t i = 0; i < measured.size(); ++i)
+        if(!measured[i])
+            return (int)i;
+    return remeasured_target;
+}
+
+// -----------------------------------------------------------------------------
+bool RobustRigidRegistration::AllMeasured() const {
+
+    return std::find(measured.begin(), measured.end(), false)
+           == measured.end();
+}
+
+// -----------------------------------------------------------------------------
+void RobustRigidRegistration::StartSampling() {
+
+    if(GetCurrentTarget() < 0)
+        return;
+    samples.clear();
+    sampling = true;
+}
+
+// -----------------------------------------------------------------------------
+bool RobustRigidRegistration::AddSample(const Eigen::Vector3d &position) {
+
+    if(!sampling)
+        return false;
+
+    samples.push_back(position);
+    if((int)samples.size() > params.samples_per_point)
+        samples.pop_front();
+    // the window slides until the tool has been still long enough
+    if((int)samples.size() < params.samples_per_point
+       || GetSampleStd() > params.max_sample_std)
+        return false;
+
+    Eigen::Vector3d mean = Eigen::Vector3d::Zero();
+    for (const auto &s : samples)
+        mean += s;
+    mean /= samples.size();
+
+    const int target = GetCurrentTarget();
+    measured_points[target] = mean;
+    measured[target] = true;
+    if(target == remeasured_target)
+        remeasured_target = -1;
+    sampling = false;
+    samples.clear();
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+double RobustRigidRegistration::GetSampleStd() const {
+
+    if(samples.empty())
+        return 0.0;
+
+    Eigen::Vector3d mean = Eigen::Vector3d::Zero();
+    for (const auto &s : samples)
+        mean += s;
+    mean /= samples.size();
+
+    double sum = 0.0;
+    for (const auto &s : samples)
+        sum += (s - mean).squaredNorm();
+    return std::sqrt(sum / samples.size());
+}
+
+// -----------------------------------------------------------------------------
+bool RobustRigidRegistration::Solve() {
+
+    std::vector<int> indices;
+    for (size_t i = 0; i < measured.size(); ++i)
+        if(measured[i])
+            indices.push_back((int)i);
+
+    has_solution = false;
+    std::fill(inliers.begin(), inliers.end(), false);
+    if(indices.size() < 3)
+        return false;
+
+    std::vector<bool> best_inliers(target_points.size(), false);
+    size_t best_count = 0;
+    double best_sum = std::numeric_limits<double>::max();
+
+    if(indices.size() < 4) {
+        // nothing to vote with, fit all the points
+        for (const int i : indices)
+            best_inliers[i] = true;
+        best_count = indices.size();
+    }
+    else {
+        // there are only a handful of points, so all the triplets are tried
+        for (size_t a = 0; a < indices.size(); ++a)
+            for (size_t b = a + 1; b < indices.size(); ++b)
+                for (size_t c = b + 1; c < indices.size(); ++c) {
+
+                    const Eigen::Vector3d &pa = target_points[indices[a]];
+                    const Eigen::Vector3d &pb = target_points[indices[b]];
+                    const Eigen::Vector3d &pc = target_points[indices[c]];
+                    // collinear targets don't fix the rotation
+                    if((pb - pa).cross(pc - pa).norm()
+                       < 0.1 * (pb - pa).norm() * (pc - pa).norm())
+                        continue;
+
+                    const Eigen::Matrix4d T = FitTransform(
+                            {pa, pb, pc},
+                            {measured_points[indices[a]],
+                             measured_points[indices[b]],
+                             measured_points[indices[c]]});
+
+                    std::vector<double> r;
+                    ComputeResiduals(T, r);
+                    size_t count = 0;
+                    double sum = 0.0;
+                    for (const int i : indices)
+                        if(r[i] < params.inlier_threshold) {
+                            count++;
+                            sum += r[i];
+                        }
+                    if(count > best_count
+                       || (count == best_count && sum < best_sum)) {
+                        best_count = count;
+                        best_sum = sum;
+                        for (const int i : indices)
+                            best_inliers[i] = r[i] < params.inlier_threshold;
+                    }
+                }
+
+        // a triplet always agrees with itself
+        if(best_count < 4) {
+            ROS_WARN("Calibration points: no consistent set of 4 points was "
+                             "found.");
+            return false;
+        }
+    }
+
+    // least squares on the inliers, then the inliers of the refined fit
+    Eigen::Matrix4d T = Eigen::Matrix4d::Identity();
+    for (int iteration = 0; iteration < 2; ++iteration) {
+        std::vector<Eigen::Vector3d> points_1, points_2;
+        for (const int i : indices)
+            if(best_inliers[i]) {
+                points_1.push_back(target_points[i]);
+                points_2.push_back(measured_points[i]);
+            }
+        T = FitTransform(points_1, points_2);
+        ComputeResiduals(T, residuals);
+        if(indices.size() < 4)
+            break;
+
+        std::vector<bool> refined(target_points.size(), false);
+        size_t count = 0;
+        for (const int i : indices)
+            if(residuals[i] < params.inlier_threshold) {
+                refined[i] = true;
+                count++;
+            }
+        if(refined == best_inliers || count < 4)
+            break;
+        best_inliers = refined;
+    }
+    inliers = best_inliers;
+
+    double sum = 0.0;
+    size_t count = 0;
+    for (const int i : indices)
+        if(inliers[i]) {
+            sum += residuals[i] * residuals[i];
+            count++;
+        }
+    rms_error = std::sqrt(sum / count);
+
+    transform.M = KDL::Rotation(T(0, 0), T(0, 1), T(0, 2),
+                                T(1, 0), T(1, 1), T(1, 2),
+                                T(2, 0), T(2, 1), T(2, 2));
+    transform.p = KDL::Vector(T(0, 3), T(1, 3), T(2, 3));
+    has_solution = true;
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+void RobustRigidRegistration::ResampleOutliers() {
+
+    if(!has_solution)
+        return;
+
+    for (size_t i = 0; i < measured.size(); ++i)
+        if(!inliers[i])
+            measured[i] = false;
+    last_remeasured = -1;
+    sampling = false;
+    samples.clear();
+}
+
+// -----------------------------------------------------------------------------
+void RobustRigidRegistration::RemeasureNext() {
+
+    if(target_points.empty())
+        return;
+    last_remeasured = (last_remeasured + 1) % (int)target_points.size();
+    remeasured_target = last_remeasured;
+    sampling = false;
+    samples.clear();
+}
+
+// -----------------------------------------------------------------------------
+size_t RobustRigidRegistration::GetNumOutliers() const {
+
+    size_t count = 0;
+    for (size_t i = 0; i < measured.size(); ++i)
+        if(measured[i] && !inliers[i])
+            count++;
+    return count;
+}
+
+// -----------------------------------------------------------------------------
+void RobustRigidRegistration::PrintReport() const {
+
+    std::stringstream report;
+    report << "Calibration points residuals (mm):";
+    for (size_t i = 0; i < residuals.size(); ++i) {
+        report << "\n  point " << i << ": ";
+        if(residuals[i] < 0)
+            report << "not measured";
+        else
+            report << residuals[i] * 1000.0
+                   << (inliers[i] ? "" : "  <- outlier");
+    }
+    if(has_solution)
+        report << "\n  rms of the inliers: " << rms_error * 1000.0;
+    ROS_INFO_STREAM(report.str());
+}
+
+// -----------------------------------------------------------------------------
+Eigen::Matrix4d RobustRigidRegistration::FitTransform(
+        const std::vector<Eigen::Vector3d> &points_1,
+        const std::vector<Eigen::Vector3d> &points_2) {
+
+    Eigen::Matrix3Xd points_1_mat(3, points_1.size());
+    Eigen::Matrix3Xd points_2_mat(3, points_2.size());
+    for (size_t i = 0; i < points_1.size(); i++) {
+        points_1_mat.col(i) = points_1[i];
+        points_2_mat.col(i) = points_2[i];
+    }
+    return Eigen::umeyama(points_1_mat, points_2_mat, false);
+}
+
+// -----------------------------------------------------------------------------
+void RobustRigidRegistration::ComputeResiduals(const Eigen::Matrix4d &T,
+                                               std::vector<double> &out) const {
+
+    out.assign(target_points.size(), -1.0);
+    for (size_t i = 0; i < target_points.size(); ++i)
+        if(measured[i])
+            out[i] = (T.block<3, 3>(0, 0) * target_points[i]
+                      + T.block<3, 1>(0, 3) - measured_points[i]).norm();
+}
@@ -0,0 +1,141 @@
+//
+// Created by charm on 19/10/26.
+//
+
+#ifndef ATAR_ROBUSTRIGIDREGISTRATION_H
+#define ATAR_ROBUSTRIGIDREGISTRATION_H
+
+#include <deque>
+#include <vector>
+#include <ros/ros.h>
+#include <kdl/frames.hpp>
+#include <Eigen/Dense>
+
+/**
+ * \class RobustRigidRegistration
+ * \brief Registration of a set of target points (e.g. on the calibration
+ * board) to the positions measured by touching them with an arm.
+ *
+ * Each target is measured from many arm positions sampled while the tool
+ * rests on it: the measurement is the mean of the last samples_per_point
+ * samples, taken once their spread is below max_sample_std, so a tool still
+ * moving is never recorded.
+ *
+ * Solve runs a RANSAC over the triplets of measured points followed by a
+ * least squares fit (umeyama) on the inliers, and gives the residual of
+ * every point. The outliers can then be measured again alone
+ * (ResampleOutliers) instead of redoing all the points. When there is no
+ * consensus the measurements are kept and the points are measured again
+ * one at a time (RemeasureNext), each new measurement replacing the old
+ * one, until Solve succeeds.
+ */
+class RobustRigidRegistration {
+public:
+
+    struct Params {
+        int     samples_per_point = 30;
+        // m, rms distance of the samples to their mean
+        double  max_sample_std = 0.0005;
+        // m, residual above which a point is an outlier
+        double  inlier_threshold = 0.002;
+    };
+
+    // The calib_samples_per_point, calib_max_sample_std and
+    // calib_inlier_threshold parameters of n, or the defaults
+    static Params ReadParams(const ros::NodeHandle &n);
+
+    explicit RobustRigidRegistration(
+            const std::vector<Eigen::Vector3d> &target_points,
+            const Params &params);
+
+    const std::vector<Eigen::Vector3d> &GetTargetPoints() const {
+        return target_points;
+    };
+
+    // Index of the first target without a measurement, or of the target
+    // being measured again (see RemeasureNext). -1 when there is nothing to
+    // measure.
+    int GetCurrentTarget() const;
+
+    bool AllMeasured() const;
+
+    // Starts, or restarts, sampling the current target
+    void StartSampling();
+
+    bool IsSampling() const { return sampling; };
+
+    // Adds an arm position while sampling. Returns true when it completes
+    // the measurement of the current target.
+    bool AddSample(const Eigen::Vector3d &position);
+
+    int GetNumSamples() const { return (int)samples.size(); };
+
+    // spread of the samples in the window, m
+    double GetSampleStd() const;
+
+    // Estimates the transformation from the target points to the measured
+    // points. False if there are not enough consistent points.
+    bool Solve();
+
+    // Forgets the measurements of the outliers of the last successful
+    // Solve, which become the next targets. Does nothing without a
+    // solution.
+    void ResampleOutliers();
+
+    // After a Solve without consensus: keeps all the measurements and makes
+    // the next point (from the first one, cyclically) the current target,
+    // whose new measurement replaces the old one.
+    void RemeasureNext();
+
+    bool HasSolution() const { return has_solution; };
+
+    // Maps the target points to the arm points
+    const KDL::Frame &GetTransform() const { return transform; };
+
+    // Distance of each transformed target to its measured point, m.
+    // Negative for the targets that are not measured.
+    const std::vector<double> &GetResiduals() const { return residuals; };
+
+    const std::vector<bool> &GetInliers() const { return inliers; };
+
+    size_t GetNumOutliers() const;
+
+    // rms of the residuals of the inliers, m
+    double GetRmsError() const { return rms_error; };
+
+    void PrintReport() const;
+
+private:
+
+    // least squares rigid transformation mapping points_1 to points_2
+    static Eigen::Matrix4d FitTransform(
+            const std::vector<Eigen::Vector3d> &points_1,
+            const std::vector<Eigen::Vector3d> &points_2);
+
+    // residuals of the measured points for the transformation T
+    void ComputeResiduals(const Eigen::Matrix4d &T,
+                          std::vector<double> &out) const;
+
+private:
+
+    Params                          params;
+    std::vector<Eigen::Vector3d>    target_points;
+    std::vector<Eigen::Vector3d>    measured_points;
+    std::vector<bool>               measured;
+    // target to measure again without consensus, -1 if none, and the last
+    // one that was asked for
+    int                             remeasured_target = -1;
+    int                             last_remeasured = -1;
+
+    bool                            sampling = false;
+    std::deque<Eigen::Vector3d>     samples;
+
+    bool                            has_solution = false;
+    KDL::Frame                      transform;
+    std::vector<double>             residuals;
+    std::vector<bool>               inliers;
+    double                          rms_error = 0.0;
+};
+
+
+#endif //ATAR_ROBUSTRIGIDREGISTRATION_H
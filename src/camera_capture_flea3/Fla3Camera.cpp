@@ -17,6 +17,8 @@ Fla3Camera::~Fla3Camera()
     delete[] capture_running;
     delete[] p_PGIdentity;
     delete[] cameras;
+    delete[] camera_mutexes;
+    delete[] raw_images;
 }
 
 
@@ -29,9 +31,11 @@ void Fla3Camera::Init()
 
     // Initialize the variable that keep track of camera connect and start
     p_osaFlea3CameraConnect = new bool[num_cams];
-    capture_running = new bool[num_cams];
+    capture_running = new std::atomic<bool>[num_cams];
     p_PGIdentity = new PGRGuid[num_cams];
     cameras = new Camera[num_cams];
+    camera_mutexes = new boost::mutex[num_cams];
+    raw_images = new Image[num_cams];
     for (int i = 0 ; i < num_cams; i++)
     {
         p_osaFlea3CameraConnect[i] = false;
@@ -303,7 +307,7 @@ double Fla3Camera::GetFrameRate(int a_cameraNum)
 
 void Fla3Camera::grabImage(uint cam_num, sensor_msgs::Image &image)
 {
-    boost::mutex::scoped_lock scopedLock(mutex_);
+    boost::mutex::scoped_lock scopedLock(camera_mutexes[cam_num]);
     if(cameras[cam_num].IsConnected() && capture_running[cam_num])
     {
 
@@ -338,6 +342,62 @@ void Fla3Camera::grabImage(uint cam_num, sensor_msgs::Image &image)
 }
 
 
+// ----------------------------------------------------------------------------
+void Fla3Camera::grabImageHalfResolution(uint cam_num, sensor_msgs::Image &image)
+{
+    boost::mutex::scoped_lock scopedLock(camera_mutexes[cam_num]);
+    if(!cameras[cam_num].IsConnected())
+        throw std::runtime_error("PointGreyCamera::grabImageHalfResolution not connected!");
+    if(!capture_running[cam_num])
+        throw std::runtime_error("PointGreyCamera::grabImageHalfResolution: camera_intrinsics is currently not running.  Please start the capture.");
+
+    // the buffer of raw_images is reused from one frame to the next
+    Image &rawImage = raw_images[cam_num];
+    Error error = cameras[cam_num].RetrieveBuffer(&rawImage);
+    HandleError("PointGreyCamera::grabImageHalfResolution Failed to retrieve buffer", error);
+
+    TimeStamp embeddedTime = rawImage.GetTimeStamp();
+    image.header.stamp.sec = embeddedTime.seconds;
+    image.header.stamp.nsec = 1000 * embeddedTime.microSeconds;
+
+    image.height = rawImage.GetRows() / 2;
+    image.width = rawImage.GetCols() / 2;
+    image.encoding = sensor_msgs::image_encodings::BGR8;
+    image.is_bigendian = 0;
+    image.step = 3 * image.width;
+    image.data.resize(image.step * image.height);
+
+    // headers only, the conversion writes straight into image.data
+    const cv::Mat bayer(rawImage.GetRows(), rawImage.GetCols(), CV_8UC1,
+                        rawImage.GetData(), rawImage.GetStride());
+    cv::Mat bgr(image.height, image.width, CV_8UC3, image.data.data(),
+                image.step);
+    half_resolution::BayerRGGBToBGR(bayer, bgr, half_resolution_method);
+}
+
+// ----------------------------------------------------------------------------
+void Fla3Camera::SetHalfResolutionMethod(half_resolution::Method method)
+{
+    half_resolution_method = method;
+}
+
+// ----------------------------------------------------------------------------
+void Fla3Camera::SetExternalTrigger(uint cam_num, bool enable)
+{
+    TriggerMode triggerMode;
+    Error error = cameras[cam_num].GetTriggerMode(&triggerMode);
+    HandleError("Fla3Camera::SetExternalTrigger Failed to get trigger mode", error);
+
+    triggerMode.onOff = enable;
+    triggerMode.mode = 0;
+    triggerMode.parameter = 0;
+    triggerMode.source = 0;     // GPIO0
+
+    error = cameras[cam_num].SetTriggerMode(&triggerMode);
+    HandleError("Fla3Camera::SetExternalTrigger Failed to set trigger mode", error);
+}
+
+
 void Fla3Camera::HandleError(const std::string &prefix, const FlyCapture2::Error &error)
 {
     if(error == PGRERROR_TIMEOUT)
@@ -5,6 +5,8 @@
 #include <sensor_msgs/Image.h>
 #include <opencv2/highgui.hpp>
 #include <boost/thread/mutex.hpp>
+#include <atomic>
+#include "src/utils/HalfResolution.h"
 
 #include "iostream"
 // ============================================================================
@@ -28,6 +30,17 @@ public:
 //    void GetImageFromCamera(int a_cameraNum, unsigned char **a_data, int *a_rowSize, int *a_colSize);
     void GetImageFromCamera(uint a_cameraNum, cv::Mat &image_out, int *a_rowSize, int *a_colSize);
     void grabImage(uint cam_num, sensor_msgs::Image &image);
+    // Grabs the next frame of the camera and writes it to image as a half
+    // resolution bgr8 image, using the method set with
+    // SetHalfResolutionMethod (FUSED by default). Nothing but image is
+    // allocated and image.data is reused if its size is right. Cameras can
+    // be grabbed concurrently from different threads.
+    void grabImageHalfResolution(uint cam_num, sensor_msgs::Image &image);
+    // Call before the capture starts
+    void SetHalfResolutionMethod(half_resolution::Method method);
+    // Makes the camera wait for a pulse on GPIO0 for each frame, so that
+    // cameras sharing the trigger line capture at the same time.
+    void SetExternalTrigger(uint cam_num, bool enable);
     sensor_msgs::ImagePtr ResizeImage(const sensor_msgs::Image &image_in);
     void HandleError(const std::string &prefix, const FlyCapture2::Error &error);
     std::vector<uint32_t> getAttachedCameras();
@@ -38,12 +51,17 @@ public:
 
 private:
     bool *p_osaFlea3CameraConnect;
-    bool *capture_running;
+    // read by the capture threads without taking the camera mutex
+    std::atomic<bool> *capture_running;
     uint num_cams;
     BusManager bus_manager;
     PGRGuid *p_PGIdentity;
     Camera *cameras;
-    boost::mutex mutex_;
+    // one per camera, so that the cameras can be read in parallel
+    boost::mutex *camera_mutexes;
+    // raw buffers reused by grabImageHalfResolution
+    Image *raw_images;
+    half_resolution::Method half_resolution_method = half_resolution::FUSED;
     uint DetermineNumberOfCameras();
 };
 
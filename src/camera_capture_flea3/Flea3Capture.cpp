@@ -0,0 +1,138 @@
+//
+// Created by charm on 19/10/26.
+//
+
+#include "Flea3Capture.h"
+#include <boost/make_shared.hpp>
+
+
+// -----------------------------------------------------------------------------
+Flea3Capture::Flea3Capture(ros::NodeHandle nh, ros::NodeHandle private_nh)
+        :
+        nh_(nh),
+        private_nh_(private_nh),
+        it_(nh),
+        running_(false)
+{ }
+
+// -----------------------------------------------------------------------------
+Flea3Capture::~Flea3Capture() {
+    Stop();
+}
+
+// -----------------------------------------------------------------------------
+void Flea3Capture::Start() {
+
+    int left_cam_serial_num;
+    bool external_trigger;
+    std::string left_frame_id, right_frame_id;
+    private_nh_.param<int>("left_cam_serial_number", left_cam_serial_num,
+                           14150439);
+    private_nh_.param<bool>("external_trigger", external_trigger, false);
+    // generic, fused or fused_scalar, see HalfResolution.h
+    std::string half_resolution_method;
+    private_nh_.param<std::string>("half_resolution_method",
+                                   half_resolution_method, "fused");
+    private_nh_.param<std::string>("left_frame_id", left_frame_id,
+                                   "left_camera");
+    private_nh_.param<std::string>("right_frame_id", right_frame_id,
+                                   "right_camera");
+
+    cameras_.SetHalfResolutionMethod(
+            half_resolution::MethodFromName(half_resolution_method));
+    cameras_.Init();
+    std::vector<uint32_t> cam_serial_nums = cameras_.getAttachedCameras();
+    num_cams_ = (uint)cam_serial_nums.size();
+    if(num_cams_ == 0) {
+        ROS_ERROR("No Flea3 camera found.");
+        return;
+    }
+
+    //determine left and right cams
+    publishers_.resize(num_cams_);
+    frame_ids_.resize(num_cams_);
+    buffer_pools_.resize(num_cams_);
+    for (uint i = 0; i < num_cams_; ++i) {
+        // only 2 cameras are expected, anything that is not the left one is
+        // taken as the right one
+        bool is_left = cam_serial_nums[i] == (uint32_t)left_cam_serial_num;
+        std::string topic_name = nh_.resolveName(
+                is_left ? "left/image_color" : "right/image_color");
+        publishers_[i] = it_.advertise(topic_name, 1);
+        frame_ids_[i] = is_left ? left_frame_id : right_frame_id;
+
+        for (size_t j = 0; j < POOL_SIZE; ++j)
+            buffer_pools_[i].push_back(
+                    boost::make_shared<sensor_msgs::Image>());
+    }
+
+    for (uint j = 0; j < num_cams_; ++j) {
+        cameras_.ConnectCamera(j);
+        cameras_.SetExternalTrigger(j, external_trigger);
+    }
+    for (uint j = 0; j < num_cams_; ++j)
+        cameras_.StartCameraCapture(j);
+
+    running_ = true;
+    for (uint j = 0; j < num_cams_; ++j)
+        threads_.emplace_back(&Flea3Capture::CaptureThread, this, j);
+
+    ROS_INFO("Capturing from %u Flea3 camera(s)%s.", num_cams_,
+             external_trigger ? " on external trigger" : "");
+}
+
+// -----------------------------------------------------------------------------
+void Flea3Capture::Stop() {
+
+    if(!running_)
+        return;
+    running_ = false;
+
+    // stopping the capture makes the blocked RetrieveBuffer calls return
+    for (uint k = 0; k < num_cams_; ++k)
+        cameras_.StopCameraCapture(k);
+    for (auto &thread : threads_)
+        thread.join();
+    threads_.clear();
+
+    for (uint k = 0; k < num_cams_; ++k)
+        cameras_.DisconnectCamera(k);
+    ROS_INFO("Flea3 capture stopped.");
+}
+
+// -----------------------------------------------------------------------------
+sensor_msgs::ImagePtr Flea3Capture::GetFreeBuffer(uint cam_num) {
+
+    for (auto &buffer : buffer_pools_[cam_num])
+        if(buffer.use_count() == 1)
+            return buffer;
+
+    // all of them are still held by subscribers, swap the oldest for a new
+    // one. Its holders keep it alive as long as they need it.
+    std::vector<sensor_msgs::ImagePtr> &pool = buffer_pools_[cam_num];
+    pool.erase(pool.begin());
+    pool.push_back(boost::make_shared<sensor_msgs::Image>());
+    return pool.back();
+}
+
+// -----------------------------------------------------------------------------
+void Flea3Capture::CaptureThread(uint cam_num) {
+
+    while(running_ && ros::ok()) {
+
+        sensor_msgs::ImagePtr image = GetFreeBuffer(cam_num);
+        try {
+            cameras_.grabImageHalfResolution(cam_num, *image);
+        }
+        catch (std::runtime_error &e) {
+            // expected when the capture is being stopped
+            if(running_) {
+                ROS_ERROR("Camera %u: %s", cam_num, e.what());
+                ros::Duration(0.1).sleep();
+            }
+            continue;
+        }
+        image->header.frame_id = frame_ids_[cam_num];
+        publishers_[cam_num].publish(image);
+    }
+}
@@ -0,0 +1,80 @@
+//
+// Created by charm on 19/10/26.
+//
+
+#ifndef ATAR_FLEA3CAPTURE_H
+#define ATAR_FLEA3CAPTURE_H
+
+#include <atomic>
+#include <vector>
+#include <ros/ros.h>
+#include <sensor_msgs/Image.h>
+#include <image_transport/image_transport.h>
+#include <boost/thread/thread.hpp>
+#include "Fla3Camera.h"
+
+/**
+ * \class Flea3Capture
+ * \brief Captures and publishes the half resolution images of all the
+ * attached Flea3 cameras, one thread per camera.
+ *
+ * Each thread blocks on its own camera and publishes a frame as soon as it
+ * is retrieved, so a slow camera does not delay the other one. The images
+ * are stamped with the embedded timestamp of the camera and, with the
+ * external_trigger parameter, the cameras expose on the same hardware
+ * trigger, so the left and right frames of a pair carry the same stamp.
+ *
+ * The frames are written directly into outgoing messages taken from a small
+ * per camera pool. A message is only reused once no subscriber holds it
+ * anymore, which is what makes it safe to publish the shared pointer itself:
+ * subscribers in the same nodelet manager get it without a copy.
+ *
+ * Parameters (private node handle):
+ *  left_cam_serial_number  serial of the left camera (default 14150439)
+ *  external_trigger        wait for the GPIO0 trigger (default false)
+ *  half_resolution_method  generic, fused (default) or fused_scalar
+ *  left_frame_id, right_frame_id
+ */
+class Flea3Capture {
+public:
+
+    Flea3Capture(ros::NodeHandle nh, ros::NodeHandle private_nh);
+
+    ~Flea3Capture();
+
+    // Connects the cameras and starts the capture threads
+    void Start();
+
+    // Stops the threads and disconnects the cameras. Called by the
+    // destructor too.
+    void Stop();
+
+private:
+
+    void CaptureThread(uint cam_num);
+
+    // A message of the pool of the camera that nobody else holds, or a new
+    // one if they are all in use
+    sensor_msgs::ImagePtr GetFreeBuffer(uint cam_num);
+
+private:
+
+    ros::NodeHandle nh_;
+    ros::NodeHandle private_nh_;
+    image_transport::ImageTransport it_;
+
+    Fla3Camera cameras_;
+    uint num_cams_ = 0;
+    std::vector<image_transport::Publisher> publishers_;
+    std::vector<std::string> frame_ids_;
+
+    // messages per camera, enough for the subscribers to hold on to a few
+    static const size_t POOL_SIZE = 4;
+    std::vector<std::vector<sensor_msgs::ImagePtr> > buffer_pools_;
+
+    std::vector<boost::thread> threads_;
+    std::atomic<bool> running_;
+};
+
+
+#endif //ATAR_FLEA3CAPTURE_H
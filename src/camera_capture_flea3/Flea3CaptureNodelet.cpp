@@ -0,0 +1,39 @@
+//
+// Created by charm on 19/10/26.
+//
+
+#include <nodelet/nodelet.h>
+#include <memory>
+#include "Flea3Capture.h"
+
+namespace atar {
+
+    // Runs Flea3Capture in a nodelet manager so that the images are passed
+    // to the nodelets of the same manager without being serialized
+    class Flea3CaptureNodelet : public nodelet::Nodelet {
+
+        std::unique_ptr<Flea3Capture> capture_;
+
+    public:
+        ~Flea3CaptureNodelet();
+
+    private:
+        virtual void onInit();
+    };
+
+    Flea3CaptureNodelet::~Flea3CaptureNodelet() {
+        if(capture_)
+            capture_->Stop();
+    }
+
+    void Flea3CaptureNodelet::onInit() {
+        capture_.reset(new Flea3Capture(getNodeHandle(),
+                                        getPrivateNodeHandle()));
+        capture_->Start();
+    }
+
+} //namespace atar
+
+#include <pluginlib/class_list_macros.h>
+PLUGINLIB_DECLARE_CLASS(atar, Flea3CaptureNodelet,
+                        atar::Flea3CaptureNodelet, nodelet::Nodelet);
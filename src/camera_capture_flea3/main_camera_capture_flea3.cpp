@@ -2,10 +2,7 @@
 #include <signal.h>
 #include <ros/ros.h>
 #include <ros/xmlrpc_manager.h>
-#include <sensor_msgs/Image.h>
-#include <image_transport/image_transport.h>
-#include <opencv2/imgproc.hpp>
-#include "Fla3Camera.h"
+#include "Flea3Capture.h"
 
 // Signal-safe flag for whether shutdown is requested
 sig_atomic_t volatile g_request_shutdown = 0;
@@ -35,33 +32,6 @@ void shutdownCallback(XmlRpc::XmlRpcValue& params, XmlRpc::XmlRpcValue& result)
 
 int main(int argc, char *argv[]){
 
-    uint left_cam_serial_num =14150439;
-
-    // camera_intrinsics related stuff
-    Fla3Camera cameras;
-    cameras.Init();
-
-//    uint num_cams = cameras.GetNumberOfCameras();
-    std::vector<uint32_t> cam_serial_nums = cameras.getAttachedCameras();
-
-    uint num_cams = (uint)cam_serial_nums.size();
-
-    for (uint j = 0; j <num_cams ; ++j) {
-        cameras.ConnectCamera(j);
-        cameras.StartCameraCapture(j);
-    }
-
-    unsigned char **imageData;
-    imageData = new unsigned char*[num_cams];
-    *imageData = NULL;
-
-//    unsigned char* imageData[num_cams];
-    int *p_rowSize;
-    int *p_colSize;
-    p_rowSize = new int[num_cams];
-    p_colSize = new int[num_cams];
-
-
     // Initialize ROS variables
 
     // Override SIGINT handler
@@ -74,52 +44,22 @@ int main(int argc, char *argv[]){
     ros::XMLRPCManager::instance()->bind("shutdown", shutdownCallback);
 
     ros::NodeHandle nh(ros::this_node::getName());
-    double ros_freq;
-    nh.param<double>("frequency", ros_freq, 30);
-
-    ros::Rate loop_rate(ros_freq);
-
-    //determine left and right cams
-    std::string img_topic_names[num_cams];
-
-    if(num_cams>0){
-        if(cam_serial_nums[0]==left_cam_serial_num){
-            img_topic_names[0] = nh.resolveName("left/image_color");
-            if(num_cams>1)
-                img_topic_names[1] = nh.resolveName("right/image_color");
-        }
-        else{
-            img_topic_names[0] = nh.resolveName("right/image_color");
-            if(num_cams>1)
-                img_topic_names[1] = nh.resolveName("left/image_color");
-        }
-    }
 
-    sensor_msgs::Image image[num_cams];
-    image_transport::ImageTransport it(nh);
-    image_transport::Publisher pub[num_cams];
-    for (int l = 0; l < num_cams; ++l) {
-       pub[l] = it.advertise(img_topic_names[l], 1);
-    }
+    // the cameras are read and published by their own threads, see
+    // Flea3Capture. The same capture can run in a nodelet manager with
+    // Flea3CaptureNodelet.
+    Flea3Capture capture(nh, nh);
+    capture.Start();
 
+    ros::Rate loop_rate(10);
     while(!g_request_shutdown){
-
-        for (uint i = 0; i < num_cams; i++) {
-            cameras.grabImage(i, image[i]);
-            pub[i].publish(cameras.ResizeImage(image[i]));
-            //pub[i].publish(image[i]);
-        }
-
+        ros::spinOnce();
         loop_rate.sleep();
     }
 
     ROS_INFO("Shutting down.");
-    for (uint k = 0; k <num_cams ; ++k) {
-        cameras.StopCameraCapture(k);
-        cameras.DisconnectCamera(k);
-    }
+    capture.Stop();
 
-    delete imageData;
     ros::shutdown();
 	return 0;
 }
@@ -8,6 +8,7 @@
 #include <ros/ros.h>
 #include <opencv2/calib3d.hpp>
 #include <opencv2/imgproc.hpp>
+#include <algorithm>
 #include "src/extrinsic_calib_aruco/BoardDetector.hpp"
 
 namespace Colors {
@@ -44,17 +45,39 @@ BoardDetector::BoardDetector(ArucoBoard board, CameraIntrinsics camera, double n
 }
 
 
+void BoardDetector::SetPyramidDetection(int pyramid_levels) {
+
+    pyramid_levels_ = std::max(0, pyramid_levels);
+    tracking_ = false;
+
+    // the corners found in the downsampled image are refined separately at
+    // full resolution
+    pyramid_detector_params_ = cv::aruco::DetectorParameters::create();
+    *pyramid_detector_params_ = *aruco_.DetectorParams;
+    pyramid_detector_params_->doCornerRefinement = false;
+}
+
+
 void BoardDetector::Detect(cv::InputOutputArray &image) {
 
+    const int64 start_ticks = cv::getTickCount();
     cv::Vec3d rotation_current, translation_current;
+    bool pose_found = false;
 
     if (image.empty())
         ROS_ERROR("Empty image received. Is an image source present?");
 
+    // set by DetectMarkersPyramid, before the prediction for the next frame
+    // overwrites tracking_
+    last_detection_tracked_ = false;
+
     // detect markers
-    cv::aruco::detectMarkers(
-            image, aruco_.Dictionary, aruco_.DetectedCorners, aruco_.DetectedMarkerIds,
-            aruco_.DetectorParams, aruco_.RejectedCorners);
+    if (pyramid_levels_ > 0)
+        DetectMarkersPyramid(image.getMat());
+    else
+        cv::aruco::detectMarkers(
+                image, aruco_.Dictionary, aruco_.DetectedCorners, aruco_.DetectedMarkerIds,
+                aruco_.DetectorParams, aruco_.RejectedCorners);
 
     // Should we try to find the other markers ?
     if (aruco_.RefindStrategy)
@@ -74,6 +97,12 @@ void BoardDetector::Detect(cv::InputOutputArray &image) {
                     camera_.camMatrix, camera_.distCoeffs,
                     rotation_current, translation_current);
             board_detected_ = (num_markers_used > 0);
+            pose_found = board_detected_;
+
+            // where to search in the next frame
+            if (pyramid_levels_ > 0 && pose_found)
+                PredictBoardRegion(rotation_current, translation_current,
+                                   image.size());
         }
         catch (const cv::Exception& e){
             ROS_ERROR("Something went wrong in cv::aruco::estimatePoseBoard");
@@ -103,6 +132,94 @@ void BoardDetector::Detect(cv::InputOutputArray &image) {
     } else
         board_detected_ = false;
 
+    // lost the board, search the whole image next time
+    if (!pose_found)
+        tracking_ = false;
+
+    last_detection_time_ms_ = 1000.0 * double(cv::getTickCount() - start_ticks)
+                              / cv::getTickFrequency();
+}
+
+
+void BoardDetector::DetectMarkersPyramid(const cv::Mat &image) {
+
+    if (image.channels() == 3)
+        cv::cvtColor(image, gray_, cv::COLOR_BGR2GRAY);
+    else
+        gray_ = image;
+
+    const cv::Rect full_image(0, 0, gray_.cols, gray_.rows);
+    cv::Rect roi = tracking_ ? (predicted_roi_ & full_image) : full_image;
+    if (roi.area() == 0)
+        roi = full_image;
+    last_detection_tracked_ = roi != full_image;
+
+    downsampled_ = gray_(roi);
+    for (int l = 0; l < pyramid_levels_; ++l)
+        cv::pyrDown(downsampled_, downsampled_);
+
+    cv::aruco::detectMarkers(
+            downsampled_, aruco_.Dictionary, aruco_.DetectedCorners,
+            aruco_.DetectedMarkerIds, pyramid_detector_params_,
+            aruco_.RejectedCorners);
+
+    // back to full resolution coordinates
+    const float scale = float(1 << pyramid_levels_);
+    auto to_full_image = [&](std::vector<std::vector<cv::Point2f>> &markers) {
+        for (auto &corners : markers)
+            for (auto &p : corners)
+                p = p * scale + cv::Point2f(float(roi.x), float(roi.y));
+    };
+    to_full_image(aruco_.DetectedCorners);
+    to_full_image(aruco_.RejectedCorners);
+
+    // refine the corners at full resolution. The search window covers the
+    // error of the downsampled detection.
+    if (!aruco_.DetectedCorners.empty()) {
+        std::vector<cv::Point2f> corners;
+        corners.reserve(4 * aruco_.DetectedCorners.size());
+        for (const auto &marker : aruco_.DetectedCorners)
+            corners.insert(corners.end(), marker.begin(), marker.end());
+
+        const int win_size = std::max(
+                aruco_.DetectorParams->cornerRefinementWinSize, int(scale) + 1);
+        cv::cornerSubPix(
+                gray_, corners, cv::Size(win_size, win_size), cv::Size(-1, -1),
+                cv::TermCriteria(
+                        cv::TermCriteria::MAX_ITER | cv::TermCriteria::EPS,
+                        aruco_.DetectorParams->cornerRefinementMaxIterations,
+                        aruco_.DetectorParams->cornerRefinementMinAccuracy));
+
+        for (size_t i = 0; i < aruco_.DetectedCorners.size(); ++i)
+            std::copy(corners.begin() + 4 * i, corners.begin() + 4 * i + 4,
+                      aruco_.DetectedCorners[i].begin());
+    }
+}
+
+
+void BoardDetector::PredictBoardRegion(const cv::Vec3d &rvec_board,
+                                       const cv::Vec3d &tvec_board,
+                                       const cv::Size &size) {
+
+    // margin around the projected board, as a fraction of its size, for the
+    // motion until the next frame
+    const double margin = 0.25;
+
+    std::vector<cv::Point3f> board_points;
+    for (const auto &marker : aruco_.Board->objPoints)
+        board_points.insert(board_points.end(), marker.begin(), marker.end());
+
+    std::vector<cv::Point2f> image_points;
+    cv::projectPoints(board_points, rvec_board, tvec_board, camera_.camMatrix,
+                      camera_.distCoeffs, image_points);
+
+    cv::Rect board = cv::boundingRect(image_points);
+    const int dx = int(margin * board.width);
+    const int dy = int(margin * board.height);
+    predicted_roi_ = cv::Rect(board.x - dx, board.y - dy,
+                              board.width + 2 * dx, board.height + 2 * dy)
+                     & cv::Rect(0, 0, size.width, size.height);
+    tracking_ = predicted_roi_.area() > 0;
 }
 
 
@@ -40,6 +40,23 @@ public:
 
     void DetectBoardAndDrawAxis(cv::InputOutputArray &image);
 
+    /**
+     * @brief
+     *  Pyramid mode for high resolution streams: the markers are searched in
+     *  an image downsampled pyramid_levels times (each level halves it) and
+     *  their corners are then refined at full resolution. Once the board is
+     *  found only the region where it is predicted to be (its projection
+     *  with the last pose, plus a margin) is searched; the whole image is
+     *  searched again only after the board is lost. Zero levels disables it.
+     * */
+    void SetPyramidDetection(int pyramid_levels);
+
+    //! Duration of the last call to Detect in milliseconds
+    double GetLastDetectionTime() const { return last_detection_time_ms_; }
+
+    //! Was the last detection done in the predicted region only ?
+    bool IsTracking() const { return last_detection_tracked_; }
+
     /**
      * @brief
      *  To avoid jitter in the position and orientation we smooth them over the last several frames.
@@ -48,6 +65,13 @@ public:
     bool Detected() const { return board_detected_; }
 
 private:
+    // detects the markers in a downsampled image of the predicted region
+    void DetectMarkersPyramid(const cv::Mat &image);
+
+    // region covered by the board with the pose rvec_board/tvec_board
+    void PredictBoardRegion(const cv::Vec3d &rvec_board,
+                            const cv::Vec3d &tvec_board, const cv::Size &size);
+
     // coppied from Aruco just to add anti-aliasing
     void drawAxisAntiAliased(
         cv::InputOutputArray _image, cv::InputArray camera_Matrix, cv::InputArray _distCoeffs,
@@ -98,6 +122,18 @@ private:
     //! Do we have a valid pose estimation ?
     bool board_detected_ = false;
 
+    //! Pyramid mode (see SetPyramidDetection)
+    int pyramid_levels_ = 0;
+    cv::Ptr<cv::aruco::DetectorParameters> pyramid_detector_params_;
+    cv::Mat gray_, downsampled_;
+    // tracking_ is for the next frame, last_detection_tracked_ for the last
+    // one
+    bool tracking_ = false;
+    bool last_detection_tracked_ = false;
+    cv::Rect predicted_roi_;
+
+    double last_detection_time_ms_ = 0.0;
+
 };
 
 
@@ -9,6 +9,7 @@
 #include <tf_conversions/tf_kdl.h>
 #include <custom_conversions/Conversions.h>
 #include <sensor_msgs/Image.h>
+#include <std_msgs/Float32MultiArray.h>
 #include <cv_bridge/cv_bridge.h>
 #include <image_transport/image_transport.h>
 #include <src/extrinsic_calib_aruco/BoardDetector.hpp>
@@ -20,6 +21,12 @@ namespace atar {
         std::shared_ptr<image_transport::ImageTransport> it_;
         image_transport::Subscriber sub_;
         ros::Publisher pub_board_to_cam_pose_;
+        // per frame [detection time (ms), latency from capture (ms),
+        // throughput (Hz), tracking (0/1)]
+        ros::Publisher pub_detection_stats_;
+        ros::Time last_frame_time_;
+        double throughput_ = 0.0;
+        int pyramid_levels_ = 0;
         //in-class initialization
         ArucoBoard board;
         BoardDetector *board_detector;
@@ -41,6 +48,8 @@ namespace atar {
 
         void ReadCameraParameters(std::string file_path);
 
+        void PublishDetectionStats(const ros::Time &image_stamp);
+
 
     private:
 
@@ -57,6 +66,7 @@ namespace atar {
         GetROSParameterValues(private_nh);
 
         board_detector = new BoardDetector(board, camera_intrinsics, 1);
+        board_detector->SetPyramidDetection(pyramid_levels_);
 
     }
 
@@ -79,9 +89,12 @@ namespace atar {
                                             board_to_cam_frame);
 
 
+            PublishDetectionStats(msg->header.stamp);
+
             if (board_detector->Detected()) {
 
                 geometry_msgs::PoseStamped board_to_cam_msg;
+                board_to_cam_msg.header.stamp = msg->header.stamp;
                 // convert pixel to meters
                 //cam_to_robot.p = cam_to_robot.p / drawings.m_to_px;
                 tf::poseKDLToMsg(board_to_cam_frame, board_to_cam_msg.pose);
@@ -122,6 +135,9 @@ namespace atar {
         bool all_required_params_found = true;
 
         n.param<bool>("draw_axes", board.draw_axes, false);
+
+        // for high resolution streams, see BoardDetector::SetPyramidDetection
+        n.param<int>("pyramid_levels", pyramid_levels_, 0);
         // load the intrinsic calibration file
         std::string cam_intrinsic_calibration_file_path;
         if (n.getParam("cam_intrinsic_calibration_file_path", cam_intrinsic_calibration_file_path)) {
@@ -177,12 +193,41 @@ namespace atar {
         ROS_INFO("Will publish board to camera pose as '%s'",
                  n.resolveName("board_to_camera").c_str());
 
+        pub_detection_stats_ = n.advertise<std_msgs::Float32MultiArray>(
+                "detection_stats", 1);
+
         if (!all_required_params_found)
             throw std::runtime_error("ERROR: some required topics are not set");
 
 
     }
 
+    void ExtrinsicArucoNodelet::PublishDetectionStats(
+            const ros::Time &image_stamp) {
+
+        const ros::Time now = ros::Time::now();
+
+        // smoothed frame rate of the processed images
+        if (!last_frame_time_.isZero()) {
+            const double dt = (now - last_frame_time_).toSec();
+            if (dt > 0.0)
+                throughput_ = (throughput_ == 0.0) ? 1.0 / dt
+                              : 0.9 * throughput_ + 0.1 / dt;
+        }
+        last_frame_time_ = now;
+
+        std_msgs::Float32MultiArray stats;
+        stats.data.push_back(float(board_detector->GetLastDetectionTime()));
+        stats.data.push_back(image_stamp.isZero() ? 0.f
+                             : float(1000.0 * (now - image_stamp).toSec()));
+        stats.data.push_back(float(throughput_));
+        stats.data.push_back(board_detector->IsTracking() ? 1.f : 0.f);
+        pub_detection_stats_.publish(stats);
+
+        ROS_DEBUG_THROTTLE(5, "Board detection: %.1f ms, %.1f Hz",
+                           board_detector->GetLastDetectionTime(), throughput_);
+    }
+
     void ExtrinsicArucoNodelet::ReadCameraParameters(std::string file_path) {
         cv::FileStorage fs(file_path, cv::FileStorage::READ);
         ROS_INFO("Reading camera intrinsic data from: '%s'" , file_path.c_str());
@@ -198,6 +198,10 @@ void RosBridge::GetROSParameterValues() {
                                         &RosBridge::TaskSTateCallback,
                                         this);
 
+    subscriber_task_loading_progress = n.subscribe(
+        "/atar/task_loading_progress", 1,
+        &RosBridge::TaskLoadingProgressCallback, this);
+
     //publisher
     publisher_control_events = n.advertise<std_msgs::Int8>
                                     ("/atar/control_events", 1);
@@ -341,6 +345,11 @@ void RosBridge::TaskSTateCallback(const custom_msgs::TaskStateConstPtr &msg){
     new_task_state_msg = true;
 }
 
+void RosBridge::TaskLoadingProgressCallback(
+    const std_msgs::Float32::ConstPtr &msg) {
+    task_loading_progress = msg->data;
+}
+
 // foot pedals
 void RosBridge::CoagFootSwitchCallback(const sensor_msgs::Joy &msg){
     clutch_pedal_pressed = (bool) msg.buttons[0];
@@ -7,6 +7,7 @@
 #include <stdio.h>
 #include <fstream>
 #include <iostream>
+#include <atomic>
 
 #include <ros/ros.h>
 #include <std_msgs/Char.h>
@@ -63,6 +64,8 @@ public:
 
     void TaskSTateCallback(const custom_msgs::TaskStateConstPtr  &msg);
 
+    void TaskLoadingProgressCallback(const std_msgs::Float32::ConstPtr &msg);
+
     void CoagFootSwitchCallback(const sensor_msgs::Joy &msg);
 
     void ClutchFootSwitchCallback(const sensor_msgs::Joy &msg);
@@ -109,6 +112,10 @@ public:
         perf_hist = perf_history;
     };
 
+    // fraction of the assets of the next task loaded by the task handler.
+    // 1 when no task is being loaded.
+    float GetTaskLoadingProgress() { return task_loading_progress; }
+
 private:
     int n_arms;
     int state_label;
@@ -117,6 +124,8 @@ private:
     int haptics_mode = 0;
     std::ofstream reporting_file;
     uint repetition_num = 1;
+    // written by the ros thread, read by the gui timer
+    std::atomic<float> task_loading_progress{1.f};
 
     std::vector<double> VectorizeData();
 
@@ -235,6 +244,7 @@ public:
     ros::Subscriber * subscriber_master_wrench;
 
     ros::Subscriber subscriber_task_state;
+    ros::Subscriber subscriber_task_loading_progress;
 
     ros::Subscriber subscriber_foot_pedal_coag;
     ros::Subscriber subscriber_foot_pedal_clutch;
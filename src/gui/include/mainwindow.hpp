@@ -49,6 +49,7 @@ private slots:
 
     void exit_clicked();
     void kill_core_clicked();
+    void cancel_loading_clicked();
     void on_stop_released();
 
     void on_record_clicked();
@@ -60,6 +60,9 @@ MainWindow::MainWindow(QWidget *parent) :
     connect(ui->pause_button, SIGNAL(released()),
             this, SLOT(pause_clicked()) );
 
+    connect(ui->button_cancel_loading, SIGNAL(released()),
+            this, SLOT(cancel_loading_clicked()) );
+
     ui->input_init_perf_1->setText("0.0");
     ui->input_init_perf_2->setText("0.0");
     ui->input_session->setText("3");
@@ -94,6 +97,14 @@ void MainWindow::onTimeout()
                       <<perf_hist[i] <<" - ";
     }
     ui->text_perf_history->setText(perf_hist_str.str().c_str());
+
+    // the bar and the cancel button are only active while the task handler
+    // is loading the assets of a task
+    const float progress = ros_obj.GetTaskLoadingProgress();
+    const bool loading = progress < 1.f;
+    ui->progress_task_loading->setValue(int(100.f * progress));
+    ui->progress_task_loading->setEnabled(loading);
+    ui->button_cancel_loading->setEnabled(loading);
 }
 
 void MainWindow::showImage(){
@@ -246,6 +257,17 @@ void MainWindow::kill_core_clicked(){
     ros_obj.publisher_control_events.publish(msg);
 
 }
+
+void MainWindow::cancel_loading_clicked(){
+
+    ROS_INFO("Canceling the loading of the task...");
+
+    std_msgs::Int8 msg;
+    msg.data =  CE_CANCEL_TASK_LOADING;
+    ros_obj.publisher_control_events.publish(msg);
+
+}
+
 void MainWindow::exit_clicked(){
 
     ROS_INFO("Exiting...");
@@ -14,7 +14,11 @@
 #include <geometry_msgs/PoseArray.h>
 
 cv::Mat image[2];
-cv::Mat stereo_image;
+// shares the buffer of the last stereo message, the two images are views on
+// its halves
+cv_bridge::CvImageConstPtr stereo_image;
+// side by side unless the stereo_layout parameter is top_bottom
+bool stereo_top_bottom = false;
 bool new_right_image = false;
 bool new_left_image = false;
 bool new_stereo_image = false;
@@ -52,6 +56,10 @@ int main(int argc, char **argv)
     ros::init(argc, argv, "stereo_view");
     ros::NodeHandle nh(ros::this_node::getName());
 
+    std::string stereo_layout;
+    nh.param<std::string>("stereo_layout", stereo_layout, "side_by_side");
+    stereo_top_bottom = stereo_layout == "top_bottom";
+
     image_transport::ImageTransport it(nh);
     image_transport::Subscriber image_subscribers[2];
 
@@ -59,7 +67,7 @@ int main(int argc, char **argv)
         //--------
         // stereo image subscriber
         ROS_INFO("[SUBSCRIBERS] Both camera images will be read from topic '%s'",
-                 left_image_topic_name.c_str());
+                 stereo_image_topic_name.c_str());
         image_subscribers[0] = it.subscribe(
                 stereo_image_topic_name, 1, ImageStereoCallback);
 
@@ -120,12 +128,18 @@ int main(int argc, char **argv)
         if(new_left_image && new_right_image || new_stereo_image) {
 
             if(num_topics==1){
-                int image_width = stereo_image.cols;
-                int image_height = stereo_image.rows;
-
-                image[0] = cv::Mat(stereo_image, cv::Rect(0, 0, image_width/2, image_height));
-                image[1] = cv::Mat(stereo_image, cv::Rect(image_width/2, 0, image_width/2, image_height));
-
+                const cv::Mat &frame = stereo_image->image;
+                int image_width = frame.cols;
+                int image_height = frame.rows;
+
+                if(stereo_top_bottom) {
+                    image[0] = cv::Mat(frame, cv::Rect(0, 0, image_width, image_height/2));
+                    image[1] = cv::Mat(frame, cv::Rect(0, image_height/2, image_width, image_height/2));
+                }
+                else {
+                    image[0] = cv::Mat(frame, cv::Rect(0, 0, image_width/2, image_height));
+                    image[1] = cv::Mat(frame, cv::Rect(image_width/2, 0, image_width/2, image_height));
+                }
             }
 
             for (int j = 0; j <2 ; ++j) {
@@ -176,7 +190,8 @@ void ImageStereoCallback(const sensor_msgs::ImageConstPtr& msg)
 {
     try
     {
-        stereo_image = cv_bridge::toCvCopy(msg, "bgr8")->image;
+        // no copy if the message is already bgr8
+        stereo_image = cv_bridge::toCvShare(msg, "bgr8");
         new_stereo_image = true;
 
     }
@@ -1,10 +1,37 @@
 //
 // Created by nima on 24/05/17.
 //
-#include <iostream>
+// Captures the frames of one or more usb cameras (typically a cheap stereo
+// rig) and publishes them with their CameraInfo, in the layout ar_core
+// expects for each camera:
+//      /<cam_name>/image_raw             (image_transport)
+//      /<cam_name>/camera_info
+// The intrinsics are read from ~/.ros/camera_info/<cam_name>_intrinsics.yaml
+// like in AugmentedCamera. If there is no such file the CameraInfo is
+// published with zeros, so that ar_core starts the intrinsic calibration.
+//
+// Parameters (private):
+//  camera_ids          [0, 1]  the video device ids. The id1 and id2
+//                      command line arguments override it.
+//  camera_names        [left_usb_cam, right_usb_cam]
+//  frame_width, frame_height, fps
+//  mjpeg_passthrough   false. If true the cameras are asked for MJPEG and
+//                      the jpeg frames are published as they are on
+//                      /<cam_name>/image_raw/compressed, without decoding
+//                      them. Subscribers must then use the compressed
+//                      transport (image_transport param of ar_core).
+//
+#include <pwd.h>
+#include <unistd.h>
 #include <ros/ros.h>
-#include <opencv2/highgui.hpp>
 #include <opencv2/core.hpp>
+#include <opencv2/videoio.hpp>
+#include <sensor_msgs/Image.h>
+#include <sensor_msgs/CameraInfo.h>
+#include <sensor_msgs/CompressedImage.h>
+#include <sensor_msgs/image_encodings.h>
+#include <image_transport/image_transport.h>
+#include <boost/make_shared.hpp>
 
 
 namespace {
@@ -14,77 +41,222 @@ namespace {
                     "{id2        |       | camera 2 id }";
 }
 
+// -----------------------------------------------------------------------------
+// Same file AugmentedCamera reads. Zeros if it is not there.
+sensor_msgs::CameraInfo ReadCameraInfo(const std::string &cam_name,
+                                       const int width, const int height) {
 
-int main(int argc, char *argv[]){
-
-    cv::CommandLineParser parser(argc, argv, keys);
-    parser.about(about);
-
-
-    std::vector<int> cam_ids;
-    std::vector<std::string> window_names;
+    sensor_msgs::CameraInfo info;
+    info.width = (uint32_t)width;
+    info.height = (uint32_t)height;
+    info.distortion_model = "plumb_bob";
+    info.R = {1., 0., 0., 0., 1., 0., 0., 0., 1.};
 
-    std::cout << "argc= " << argc << std::endl;
-    if(argc == 3){
-        cam_ids.push_back(parser.get<int>("id1"));
-        std::cout << "Using uSB cam with id " << cam_ids[0] << std::endl;
+    struct passwd *pw = getpwuid(getuid());
+    const std::string file_addr = std::string(pw->pw_dir)
+            + "/.ros/camera_info/" + cam_name + "_intrinsics.yaml";
 
-        cam_ids.push_back(parser.get<int>("id2"));
-        std::cout << "Using uSB cam with id " << cam_ids[1] << std::endl;
-    }
-    else if(argc == 2) {
-        cam_ids.push_back(parser.get<int>("id1"));
+    cv::FileStorage fs(file_addr, cv::FileStorage::READ);
+    if(!fs.isOpened()) {
+        ROS_WARN("No intrinsics file '%s', publishing an empty camera_info.",
+                 file_addr.c_str());
+        return info;
     }
-    else{
-        parser.printMessage();
-        return 0;
+
+    cv::Mat camera_matrix, camera_distortion;
+    fs["camera_matrix"] >> camera_matrix;
+    fs["distortion_coefficients"] >> camera_distortion;
+    if(camera_matrix.empty()) {
+        ROS_WARN("camera_matrix not found in '%s'.", file_addr.c_str());
+        return info;
     }
+    camera_matrix.convertTo(camera_matrix, CV_64F);
+    camera_distortion.convertTo(camera_distortion, CV_64F);
+
+    for (int i = 0; i < 9; ++i)
+        info.K[i] = camera_matrix.at<double>(i / 3, i % 3);
+    info.D.assign(camera_distortion.begin<double>(),
+                  camera_distortion.end<double>());
+    for (int r = 0; r < 3; ++r)
+        for (int c = 0; c < 3; ++c)
+            info.P[4 * r + c] = info.K[3 * r + c];
+    return info;
+}
 
+// -----------------------------------------------------------------------------
+bool IsJpeg(const cv::Mat &frame) {
+    return frame.rows == 1 && frame.type() == CV_8UC1 && frame.cols > 2
+           && frame.data[0] == 0xFF && frame.data[1] == 0xD8;
+}
 
-    for (int i = 0; i < cam_ids.size(); ++i) {
-        std::stringstream win_name;
-        win_name << "cam " << cam_ids[i];
-        window_names.push_back(win_name.str());
-    }
 
+int main(int argc, char *argv[]){
 
     ros::init(argc, argv, "usb_cam_publisher");
-    std::string ros_node_name = ros::this_node::getName();
-    ros::NodeHandle n(ros_node_name);
+    ros::NodeHandle n("~");
 
+    // ------------------------------------------ parameters
+    std::vector<int> cam_ids;
+    n.param("camera_ids", cam_ids, std::vector<int>({0, 1}));
+
+    cv::CommandLineParser parser(argc, argv, keys);
+    parser.about(about);
+    if(parser.has("id1")) {
+        cam_ids = {parser.get<int>("id1")};
+        if(parser.has("id2"))
+            cam_ids.push_back(parser.get<int>("id2"));
+    }
+    const size_t n_cams = cam_ids.size();
 
-    ros::Rate loop_rate(1);
+    std::vector<std::string> cam_names;
+    n.param("camera_names", cam_names,
+            std::vector<std::string>({"left_usb_cam", "right_usb_cam"}));
+    if(cam_names.size() < n_cams) {
+        ROS_ERROR("Expecting %zu camera_names.", n_cams);
+        return 1;
+    }
 
-    cv::VideoCapture inputVideo[cam_ids.size()];
-    int waitTime;
+    int frame_width, frame_height;
+    double fps;
+    bool mjpeg_passthrough;
+    n.param("frame_width", frame_width, 640);
+    n.param("frame_height", frame_height, 480);
+    n.param("fps", fps, 30.0);
+    n.param("mjpeg_passthrough", mjpeg_passthrough, false);
 
+    // ------------------------------------------ cameras
+    std::vector<cv::VideoCapture> captures(n_cams);
+    for (size_t i = 0; i < n_cams; ++i) {
+        if(!captures[i].open(cam_ids[i])) {
+            ROS_ERROR("Could not open usb camera %d.", cam_ids[i]);
+            return 1;
+        }
+        // MJPEG is what lets most usb cameras reach their full frame rate
+        captures[i].set(cv::CAP_PROP_FOURCC,
+                        cv::VideoWriter::fourcc('M', 'J', 'P', 'G'));
+        captures[i].set(cv::CAP_PROP_FRAME_WIDTH, frame_width);
+        captures[i].set(cv::CAP_PROP_FRAME_HEIGHT, frame_height);
+        captures[i].set(cv::CAP_PROP_FPS, fps);
+        // only take the latest frame, not a queue of old ones
+        captures[i].set(cv::CAP_PROP_BUFFERSIZE, 1);
+        if(mjpeg_passthrough)
+            captures[i].set(cv::CAP_PROP_CONVERT_RGB, 0);
+    }
 
-    for (int i = 0; i < cam_ids.size(); ++i) {
-        inputVideo[i].open(cam_ids[i]);
+    // the first frames tell the actual size and whether the backend really
+    // hands out the jpeg data
+    std::vector<cv::Mat> frames(n_cams);
+    for (size_t i = 0; i < n_cams; ++i) {
+        if(!captures[i].read(frames[i])) {
+            ROS_ERROR("Could not read from usb camera %d.", cam_ids[i]);
+            return 1;
+        }
+        if(mjpeg_passthrough && !IsJpeg(frames[i])) {
+            ROS_WARN("Camera %d does not give jpeg frames with this OpenCV "
+                             "backend, publishing decoded images instead.",
+                     cam_ids[i]);
+            mjpeg_passthrough = false;
+        }
     }
+    if(!mjpeg_passthrough)
+        for (size_t i = 0; i < n_cams; ++i) {
+            captures[i].set(cv::CAP_PROP_CONVERT_RGB, 1);
+            captures[i].read(frames[i]);
+        }
 
+    // ------------------------------------------ publishers
+    image_transport::ImageTransport it(n);
+    std::vector<image_transport::CameraPublisher> pub_cameras(n_cams);
+    std::vector<ros::Publisher> pub_compressed(n_cams);
+    std::vector<ros::Publisher> pub_camera_infos(n_cams);
+    std::vector<sensor_msgs::CameraInfo> camera_infos(n_cams);
 
+    for (size_t i = 0; i < n_cams; ++i) {
+        const std::string image_topic = "/" + cam_names[i] + "/image_raw";
 
-    while(ros::ok() ){
+        int width = (int)captures[i].get(cv::CAP_PROP_FRAME_WIDTH);
+        int height = (int)captures[i].get(cv::CAP_PROP_FRAME_HEIGHT);
+        if(!mjpeg_passthrough) {
+            width = frames[i].cols;
+            height = frames[i].rows;
+        }
+        camera_infos[i] = ReadCameraInfo(cam_names[i], width, height);
+        camera_infos[i].header.frame_id = cam_names[i];
 
-        for (int i = 0; i < cam_ids.size(); ++i) {
-            inputVideo[i].grab();
-            cv::Mat image;
-            inputVideo[i].retrieve(image);
+        if(mjpeg_passthrough) {
+            pub_compressed[i] = n.advertise<sensor_msgs::CompressedImage>(
+                    image_topic + "/compressed", 1);
+            pub_camera_infos[i] = n.advertise<sensor_msgs::CameraInfo>(
+                    "/" + cam_names[i] + "/camera_info", 1);
+        }
+        else
+            pub_cameras[i] = it.advertiseCamera(image_topic, 1);
 
-            imshow(window_names[i], image);
-            loop_rate.sleep();
+        ROS_INFO("Publishing usb camera %d on %s%s (%dx%d).", cam_ids[i],
+                 image_topic.c_str(), mjpeg_passthrough ? "/compressed" : "",
+                 width, height);
+    }
 
+    // ------------------------------------------ capture loop
+    // grab blocks until the next frame, so the loop runs at the frame rate
+    // of the cameras.
+    while(ros::ok()){
 
+        // grab all the cameras back to back before decoding anything, to
+        // keep the time between the frames of a pair minimal
+        bool grabbed = true;
+        for (size_t i = 0; i < n_cams; ++i)
+            grabbed &= captures[i].grab();
+        const ros::Time stamp = ros::Time::now();
+        if(!grabbed) {
+            ROS_WARN_THROTTLE(1, "Failed to grab a frame.");
+            continue;
         }
 
-        char key = (char)cv::waitKey(1);
-        if(key == 27) break;
+        for (size_t i = 0; i < n_cams; ++i) {
+            camera_infos[i].header.stamp = stamp;
 
+            if(mjpeg_passthrough) {
+                sensor_msgs::CompressedImagePtr msg =
+                        boost::make_shared<sensor_msgs::CompressedImage>();
+                captures[i].retrieve(frames[i]);
+                msg->header = camera_infos[i].header;
+                msg->format = "bgr8; jpeg compressed bgr8";
+                msg->data.assign(frames[i].data,
+                                 frames[i].data + frames[i].total());
+                pub_compressed[i].publish(msg);
+                pub_camera_infos[i].publish(camera_infos[i]);
+            }
+            else {
+                // retrieve into a header on the buffer of the message. The
+                // backend still decodes into its own frame, retrieve then
+                // copies that once into the message, with no intermediate
+                // cv::Mat and no cv_bridge copy.
+                sensor_msgs::ImagePtr msg =
+                        boost::make_shared<sensor_msgs::Image>();
+                msg->header = camera_infos[i].header;
+                msg->height = (uint32_t)frames[i].rows;
+                msg->width = (uint32_t)frames[i].cols;
+                msg->encoding = sensor_msgs::image_encodings::BGR8;
+                msg->step = 3 * msg->width;
+                msg->data.resize(msg->step * msg->height);
+                cv::Mat image(frames[i].rows, frames[i].cols, CV_8UC3,
+                              msg->data.data(), msg->step);
+                captures[i].retrieve(image);
+                if(image.data != msg->data.data()) {
+                    // the camera changed resolution
+                    ROS_WARN_THROTTLE(1, "Camera %d changed resolution.",
+                                      cam_ids[i]);
+                    frames[i] = image;
+                    continue;
+                }
+                pub_cameras[i].publish(msg, boost::make_shared<
+                        sensor_msgs::CameraInfo>(camera_infos[i]));
+            }
+        }
 
         ros::spinOnce();
-        loop_rate.sleep();
     }
 
-
+    return 0;
 }
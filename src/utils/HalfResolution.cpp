@@ -0,0 +1,189 @@
+//
+// Created by charm on 19/10/26.
+//
+
+#include "HalfResolution.h"
+#include <opencv2/imgproc.hpp>
+#include <stdexcept>
+#include <cstdint>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HALF_RESOLUTION_AVX2
+#include <immintrin.h>
+#endif
+
+namespace half_resolution {
+
+namespace {
+
+// -----------------------------------------------------------------------------
+// One output row from two bayer rows: R G R G ... over G B G B ...
+void RGGBRowScalar(const uint8_t *row0, const uint8_t *row1,
+                   uint8_t *out, int x_begin, int out_cols) {
+
+    for (int x = x_begin; x < out_cols; ++x) {
+        out[3 * x]     = row1[2 * x + 1];
+        out[3 * x + 1] = (uint8_t)((row0[2 * x + 1] + row1[2 * x] + 1) >> 1);
+        out[3 * x + 2] = row0[2 * x];
+    }
+}
+
+#ifdef HALF_RESOLUTION_AVX2
+
+// pshufb masks interleaving 16 b, g and r bytes into 48 bgr bytes:
+// SHUFFLE[chunk][channel] places the bytes of channel in the 16 byte chunk
+// of the output, the other bytes are zeroed (0x80)
+struct ShuffleMasks {
+    uint8_t mask[3][3][16];
+    ShuffleMasks() {
+        for (int chunk = 0; chunk < 3; ++chunk)
+            for (int channel = 0; channel < 3; ++channel)
+                for (int j = 0; j < 16; ++j) {
+                    const int k = 16 * chunk + j;
+                    mask[chunk][channel][j] =
+                            uint8_t(k % 3 == channel ? k / 3 : 0x80);
+                }
+    }
+};
+const ShuffleMasks SHUFFLE;
+
+// -----------------------------------------------------------------------------
+// Even and odd bytes of the 64 bytes at p, in order
+__attribute__((target("avx2")))
+inline void Deinterleave(const uint8_t *p, __m256i &even, __m256i &odd) {
+
+    const __m256i a = _mm256_loadu_si256((const __m256i *)p);
+    const __m256i b = _mm256_loadu_si256((const __m256i *)(p + 32));
+    const __m256i low_bytes = _mm256_set1_epi16(0x00FF);
+
+    // packus works per 128 bit lane, the permute puts the quadwords back
+    // in order
+    even = _mm256_permute4x64_epi64(
+            _mm256_packus_epi16(_mm256_and_si256(a, low_bytes),
+                                _mm256_and_si256(b, low_bytes)), 0xD8);
+    odd = _mm256_permute4x64_epi64(
+            _mm256_packus_epi16(_mm256_srli_epi16(a, 8),
+                                _mm256_srli_epi16(b, 8)), 0xD8);
+}
+
+// -----------------------------------------------------------------------------
+__attribute__((target("avx2")))
+inline __m256i Interleave(const __m256i &b, const __m256i &g,
+                          const __m256i &r, const int chunk) {
+
+    const __m256i mb = _mm256_broadcastsi128_si256(
+            _mm_loadu_si128((const __m128i *)SHUFFLE.mask[chunk][0]));
+    const __m256i mg = _mm256_broadcastsi128_si256(
+            _mm_loadu_si128((const __m128i *)SHUFFLE.mask[chunk][1]));
+    const __m256i mr = _mm256_broadcastsi128_si256(
+            _mm_loadu_si128((const __m128i *)SHUFFLE.mask[chunk][2]));
+    return _mm256_or_si256(
+            _mm256_or_si256(_mm256_shuffle_epi8(b, mb),
+                            _mm256_shuffle_epi8(g, mg)),
+            _mm256_shuffle_epi8(r, mr));
+}
+
+// -----------------------------------------------------------------------------
+// 32 output pixels per iteration, the rest of the row is left to the scalar
+// loop. Returns the number of pixels written.
+__attribute__((target("avx2")))
+int RGGBRowAVX2(const uint8_t *row0, const uint8_t *row1,
+                uint8_t *out, int out_cols) {
+
+    int x = 0;
+    for (; x + 32 <= out_cols; x += 32) {
+        __m256i r, g0, g1, b;
+        Deinterleave(row0 + 2 * x, r, g0);
+        Deinterleave(row1 + 2 * x, g1, b);
+        // (a + b + 1) >> 1, same rounding as the scalar loop
+        const __m256i g = _mm256_avg_epu8(g0, g1);
+
+        // the low lanes hold pixels 0-15 and the high lanes 16-31, so the
+        // low lanes of c0, c1, c2 are the first 48 output bytes
+        const __m256i c0 = Interleave(b, g, r, 0);
+        const __m256i c1 = Interleave(b, g, r, 1);
+        const __m256i c2 = Interleave(b, g, r, 2);
+
+        uint8_t *dst = out + 3 * x;
+        _mm256_storeu_si256((__m256i *)dst,
+                            _mm256_permute2x128_si256(c0, c1, 0x20));
+        _mm256_storeu_si256((__m256i *)(dst + 32),
+                            _mm256_permute2x128_si256(c2, c0, 0x30));
+        _mm256_storeu_si256((__m256i *)(dst + 64),
+                            _mm256_permute2x128_si256(c1, c2, 0x31));
+    }
+    return x;
+}
+
+#endif
+
+// -----------------------------------------------------------------------------
+void Fused(const cv::Mat &bayer, cv::Mat &bgr, const bool use_avx2) {
+
+    const int out_cols = bgr.cols;
+    for (int y = 0; y < bgr.rows; ++y) {
+        const uint8_t *row0 = bayer.ptr<uint8_t>(2 * y);
+        const uint8_t *row1 = bayer.ptr<uint8_t>(2 * y + 1);
+        uint8_t *out = bgr.ptr<uint8_t>(y);
+
+        int x = 0;
+#ifdef HALF_RESOLUTION_AVX2
+        if(use_avx2)
+            x = RGGBRowAVX2(row0, row1, out, out_cols);
+#endif
+        RGGBRowScalar(row0, row1, out, x, out_cols);
+    }
+}
+
+}
+
+// -----------------------------------------------------------------------------
+Method MethodFromName(const std::string &name) {
+
+    if(name == "generic")
+        return GENERIC;
+    if(name == "fused")
+        return FUSED;
+    if(name == "fused_scalar")
+        return FUSED_SCALAR;
+    throw std::runtime_error("Unknown half resolution method: " + name);
+}
+
+// -----------------------------------------------------------------------------
+bool HasAVX2() {
+#ifdef HALF_RESOLUTION_AVX2
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+    return has_avx2;
+#else
+    return false;
+#endif
+}
+
+// -----------------------------------------------------------------------------
+void BayerRGGBToBGR(const cv::Mat &bayer, cv::Mat &bgr,
+                    const Method method) {
+
+    CV_Assert(bayer.type() == CV_8UC1);
+    bgr.create(bayer.rows / 2, bayer.cols / 2, CV_8UC3);
+
+    switch (method) {
+        case GENERIC: {
+            // one intermediate image per thread, reused between frames
+            thread_local cv::Mat full_resolution;
+            // OpenCV names bayer patterns after the second row, so RGGB is
+            // BayerBG
+            cv::cvtColor(bayer, full_resolution, cv::COLOR_BayerBG2BGR);
+            cv::resize(full_resolution, bgr, bgr.size(), 0, 0,
+                       cv::INTER_AREA);
+            break;
+        }
+        case FUSED:
+            Fused(bayer, bgr, HasAVX2());
+            break;
+        case FUSED_SCALAR:
+            Fused(bayer, bgr, false);
+            break;
+    }
+}
+
+}
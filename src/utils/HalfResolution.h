@@ -0,0 +1,47 @@
+//
+// Created by charm on 19/10/26.
+//
+
+#ifndef ATAR_HALFRESOLUTION_H
+#define ATAR_HALFRESOLUTION_H
+
+#include <string>
+#include <opencv2/core.hpp>
+
+/**
+ * Conversion of the raw RGGB bayer frames of the capture nodes to half
+ * resolution bgr images.
+ *
+ * GENERIC is the previous two step path: full resolution debayering with
+ * cv::cvtColor, then cv::resize with INTER_AREA. FUSED reads each 2x2 bayer
+ * cell once and writes one bgr pixel (the two greens are averaged), so there
+ * is no full resolution intermediate image. It uses AVX2 when the cpu has
+ * it, and a scalar loop otherwise. FUSED_SCALAR forces the scalar loop and
+ * is there for the benchmark.
+ *
+ * See benchmark_half_resolution for the timings of the three.
+ */
+namespace half_resolution {
+
+    enum Method {
+        GENERIC,
+        FUSED,
+        FUSED_SCALAR
+    };
+
+    // "generic", "fused" or "fused_scalar". Throws for anything else.
+    Method MethodFromName(const std::string &name);
+
+    // True if FUSED runs the AVX2 kernel
+    bool HasAVX2();
+
+    // bayer is a CV_8UC1 RGGB image with even dimensions. bgr is resized to
+    // half of it (CV_8UC3) unless it already has the right size and type,
+    // so it can wrap the buffer of an outgoing message.
+    void BayerRGGBToBGR(const cv::Mat &bayer, cv::Mat &bgr,
+                        const Method method = FUSED);
+
+}
+
+
+#endif //ATAR_HALFRESOLUTION_H